@@ -0,0 +1,219 @@
+#include "Autosave.hpp"
+#include "CatalogIndex.hpp"
+#include "KeyFilter.hpp"
+#include "Utf8.hpp"
+#include <filesystem>
+#include <fstream>
+#include <utility>
+#include <windows.h>
+
+HeadphonesList::SerializeResult write_file_atomically(
+    const std::string& filename,
+    const std::function<HeadphonesList::SerializeResult(std::ostream&)>& write
+)
+{
+    const auto open_err = "Не получается создать временный файл для сохранения.";
+    const auto io_err = "Ошибка ввода-вывода при записи файла";
+    const auto sync_err = "Не получается сбросить временный файл на диск.";
+    const auto rename_err = "Не получается заменить файл сохранения временным файлом.";
+    const auto path = utf8_path(filename).wstring();
+    const auto temp_path = utf8_path(filename + ".tmp").wstring();
+
+    {
+        std::ofstream file(std::filesystem::path(temp_path), std::ios::out | std::ios::binary);
+        if (!file.is_open())
+        {
+            return HeadphonesList::SerializeError(open_err);
+        }
+
+        auto result = write(file);
+        if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+        {
+            return result;
+        }
+
+        file.close();
+        if (file.fail())
+        {
+            return HeadphonesList::SerializeError(io_err);
+        }
+    }
+
+    HANDLE handle = CreateFileW(
+        temp_path.c_str(),
+        GENERIC_WRITE,
+        0,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return HeadphonesList::SerializeError(sync_err);
+    }
+    BOOL is_synced = FlushFileBuffers(handle);
+    CloseHandle(handle);
+    if (!is_synced)
+    {
+        return HeadphonesList::SerializeError(sync_err);
+    }
+
+    if (!MoveFileExW(
+            temp_path.c_str(),
+            path.c_str(),
+            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+        )
+    )
+    {
+        return HeadphonesList::SerializeError(rename_err);
+    }
+
+    return std::monostate();
+}
+
+HeadphonesList::SerializeResult save_snapshot_atomically(
+    const HeadphonesList::Snapshot& snapshot,
+    const std::string& filename
+)
+{
+    std::vector<std::uint64_t> offsets;
+    auto result = write_file_atomically(
+        filename,
+        [&](std::ostream& os)
+        {
+            return HeadphonesList::serialize(os, snapshot, offsets);
+        }
+    );
+    if (std::holds_alternative<std::monostate>(result))
+    {
+        // The catalog is saved either way; an index or filter that could not
+        // be written is found stale on next use and rebuilt then.
+        write_catalog_index(filename, snapshot, offsets);
+        write_catalog_filter(filename, KeyFilter::build(snapshot));
+    }
+    return result;
+}
+
+Autosave::Autosave(
+    std::string filename,
+    std::chrono::milliseconds interval
+) :
+    m_filename(filename),
+    m_interval(interval),
+    m_pending(std::nullopt),
+    m_is_saving(false),
+    m_is_flushing(false),
+    m_is_stopping(false),
+    m_error(std::nullopt),
+    m_thread(&Autosave::run, this)
+{}
+
+Autosave::~Autosave()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_is_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+std::chrono::milliseconds Autosave::interval()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_interval;
+}
+
+void Autosave::set_interval(std::chrono::milliseconds interval)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_interval = interval;
+    }
+    m_wake.notify_all();
+}
+
+void Autosave::notify(const PersistentList& version)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pending)
+        {
+            m_pending_since = std::chrono::steady_clock::now();
+        }
+        m_pending = version;
+    }
+    m_wake.notify_all();
+}
+
+void Autosave::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_is_flushing = true;
+    m_wake.notify_all();
+    m_idle.wait(lock, [this] { return !m_pending && !m_is_saving; });
+    m_is_flushing = false;
+}
+
+void Autosave::cancel()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pending = std::nullopt;
+    m_idle.wait(lock, [this] { return !m_is_saving; });
+}
+
+std::optional<std::string> Autosave::take_error()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::exchange(m_error, std::nullopt);
+}
+
+void Autosave::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this] { return m_is_stopping || m_pending; });
+        if (m_is_stopping)
+        {
+            return;
+        }
+
+        while (
+            !m_is_stopping
+            && !m_is_flushing
+            && m_pending
+            && std::chrono::steady_clock::now() < m_pending_since + m_interval
+        )
+        {
+            m_wake.wait_until(lock, m_pending_since + m_interval);
+        }
+        if (m_is_stopping)
+        {
+            return;
+        }
+        if (!m_pending)
+        {
+            m_idle.notify_all();
+            continue;
+        }
+
+        PersistentList version = std::move(*m_pending);
+        m_pending = std::nullopt;
+        m_is_saving = true;
+        lock.unlock();
+
+        auto snapshot = version.snapshot();
+        auto result = save_snapshot_atomically(snapshot, m_filename);
+        snapshot.clear();
+
+        lock.lock();
+        m_is_saving = false;
+        if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+        {
+            m_error = std::get<HeadphonesList::SerializeError>(result).message;
+        }
+        m_idle.notify_all();
+    }
+}
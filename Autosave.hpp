@@ -0,0 +1,59 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include "PersistentList.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Writes to "<filename>.tmp", flushes it to disk and renames it over filename,
+// so an interrupted save never leaves a half-written catalog behind.
+HeadphonesList::SerializeResult write_file_atomically(
+    const std::string& filename,
+    const std::function<HeadphonesList::SerializeResult(std::ostream&)>& write
+);
+HeadphonesList::SerializeResult save_snapshot_atomically(
+    const HeadphonesList::Snapshot& snapshot,
+    const std::string& filename
+);
+
+class Autosave {
+public:
+    Autosave(std::string filename, std::chrono::milliseconds interval);
+    ~Autosave();
+
+    Autosave(const Autosave& autosave) = delete;
+    Autosave& operator=(const Autosave& autosave) = delete;
+
+    std::chrono::milliseconds interval();
+    void set_interval(std::chrono::milliseconds interval);
+
+    // Every version handed in within one interval is coalesced into a single
+    // write. Versions share structure, so this costs the caller O(1); the list
+    // is only walked on the saving thread.
+    void notify(const PersistentList& version);
+    void flush();
+    void cancel();
+
+    std::optional<std::string> take_error();
+private:
+    std::string m_filename;
+    std::chrono::milliseconds m_interval;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::optional<PersistentList> m_pending;
+    std::chrono::steady_clock::time_point m_pending_since;
+    bool m_is_saving;
+    bool m_is_flushing;
+    bool m_is_stopping;
+    std::optional<std::string> m_error;
+
+    std::thread m_thread;
+
+    void run();
+};
@@ -0,0 +1,318 @@
+#include "CatalogAggregate.hpp"
+#include "CatalogMerge.hpp"
+#include "HeadphonesSchema.hpp"
+#include "Stopwatch.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <utility>
+
+namespace
+{
+    // Splitting a short list among threads costs more than it saves.
+    const std::uintptr_t min_rows_per_thread = 1 << 14;
+
+    const std::string& equalizer_mode_name(EqualizerMode mode)
+    {
+        static const std::array<std::string, EqualizerModeEncoding::choices.size()> names {
+            equalizer_mode_to_string(EqualizerModeEncoding::choices[0]),
+            equalizer_mode_to_string(EqualizerModeEncoding::choices[1]),
+            equalizer_mode_to_string(EqualizerModeEncoding::choices[2]),
+            equalizer_mode_to_string(EqualizerModeEncoding::choices[3])
+        };
+        return names[(std::size_t)mode];
+    }
+
+    bool ranks_above(const TopRecord& a, const TopRecord& b)
+    {
+        return a.price > b.price || (a.price == b.price && a.position < b.position);
+    }
+}
+
+GroupStats::GroupStats(
+    std::string key
+) :
+    key(std::move(key)),
+    count(0),
+    volume_sum(0.0),
+    priced_count(0),
+    min_price(std::numeric_limits<double>::infinity()),
+    max_price(-std::numeric_limits<double>::infinity())
+{}
+
+double GroupStats::average_volume() const
+{
+    return count == 0 ? 0.0 : volume_sum / count;
+}
+
+CatalogAggregator::CatalogAggregator(
+    GroupKey group_key,
+    std::size_t top_count
+) :
+    m_group_key(group_key),
+    m_top_count(top_count),
+    m_rows(0),
+    m_groups(),
+    m_group_hashes(),
+    m_slots(16, 0),
+    m_top()
+{
+    m_top.reserve(top_count);
+}
+
+void CatalogAggregator::add(const Headphones& value, std::uint64_t position)
+{
+    m_rows++;
+    auto& stats = group(key_of(value));
+    stats.count++;
+    stats.volume_sum += value.get_volume();
+
+    auto price = parse_price(value.get_price());
+    if (!price)
+    {
+        return;
+    }
+    stats.priced_count++;
+    stats.min_price = std::min(stats.min_price, *price);
+    stats.max_price = std::max(stats.max_price, *price);
+    offer(*price, position, value);
+}
+
+void CatalogAggregator::merge(CatalogAggregator& other)
+{
+    m_rows += other.m_rows;
+    for (const auto& other_stats : other.m_groups)
+    {
+        auto& stats = group(other_stats.key);
+        stats.count += other_stats.count;
+        stats.volume_sum += other_stats.volume_sum;
+        stats.priced_count += other_stats.priced_count;
+        stats.min_price = std::min(stats.min_price, other_stats.min_price);
+        stats.max_price = std::max(stats.max_price, other_stats.max_price);
+    }
+    for (auto& top : other.m_top)
+    {
+        offer(std::move(top));
+    }
+    other.m_top.clear();
+}
+
+std::uintptr_t CatalogAggregator::rows() const
+{
+    return m_rows;
+}
+
+std::vector<GroupStats> CatalogAggregator::groups() const
+{
+    auto groups = m_groups;
+    std::sort(
+        groups.begin(),
+        groups.end(),
+        [](const GroupStats& a, const GroupStats& b) { return a.key < b.key; }
+    );
+    return groups;
+}
+
+std::vector<TopRecord> CatalogAggregator::take_top()
+{
+    auto top = std::move(m_top);
+    m_top.clear();
+    std::sort(top.begin(), top.end(), ranks_above);
+    return top;
+}
+
+std::string_view CatalogAggregator::key_of(const Headphones& value) const
+{
+    switch (m_group_key)
+    {
+    case GroupKey::Producer:
+        return value.get_producer_name();
+    case GroupKey::EqualizerMode:
+        return equalizer_mode_name(value.get_equalizer_mode());
+    default:
+        return std::string_view();
+    }
+}
+
+GroupStats& CatalogAggregator::group(std::string_view key)
+{
+    std::size_t hash = std::hash<std::string_view>()(key);
+    std::size_t mask = m_slots.size() - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        std::uint32_t slot = m_slots[i];
+        if (slot == 0)
+        {
+            // Kept at most half full, so probes stay short.
+            if ((m_groups.size() + 1) * 2 > m_slots.size())
+            {
+                grow();
+                return group(key);
+            }
+            m_groups.emplace_back(std::string(key));
+            m_group_hashes.push_back(hash);
+            m_slots[i] = (std::uint32_t)m_groups.size();
+            return m_groups.back();
+        }
+        if (m_group_hashes[slot - 1] == hash && m_groups[slot - 1].key == key)
+        {
+            return m_groups[slot - 1];
+        }
+    }
+}
+
+void CatalogAggregator::grow()
+{
+    m_slots.assign(m_slots.size() * 2, 0);
+    std::size_t mask = m_slots.size() - 1;
+    for (std::size_t group = 0; group < m_groups.size(); group++)
+    {
+        std::size_t i = m_group_hashes[group] & mask;
+        while (m_slots[i] != 0)
+        {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = (std::uint32_t)(group + 1);
+    }
+}
+
+void CatalogAggregator::offer(double price, std::uint64_t position, const Headphones& value)
+{
+    // The record is only copied once it is known to make the cut.
+    if (m_top_count == 0)
+    {
+        return;
+    }
+    if (m_top.size() == m_top_count)
+    {
+        const auto& lowest = m_top.front();
+        if (price < lowest.price || (price == lowest.price && position > lowest.position))
+        {
+            return;
+        }
+    }
+    TopRecord top {price, position, Headphones()};
+    HeadphonesSchema::assign(top.record, value);
+    offer(std::move(top));
+}
+
+void CatalogAggregator::offer(TopRecord&& top)
+{
+    if (m_top_count == 0)
+    {
+        return;
+    }
+    // A min-heap under ranks_above: the front is the one to drop next.
+    if (m_top.size() < m_top_count)
+    {
+        m_top.push_back(std::move(top));
+        std::push_heap(m_top.begin(), m_top.end(), ranks_above);
+        return;
+    }
+    if (!ranks_above(top, m_top.front()))
+    {
+        return;
+    }
+    std::pop_heap(m_top.begin(), m_top.end(), ranks_above);
+    m_top.back() = std::move(top);
+    std::push_heap(m_top.begin(), m_top.end(), ranks_above);
+}
+
+AggregateReport::AggregateReport() :
+    groups(),
+    top(),
+    rows(0),
+    seconds(0.0)
+{}
+
+AggregateReport aggregate(const HeadphonesList& list, GroupKey group_key, std::size_t top_count)
+{
+    auto start = Clock::now();
+
+    auto& pool = ThreadPool::shared();
+    std::uintptr_t thread_count = pool.thread_count();
+    thread_count = std::max<std::uintptr_t>(1, std::min(thread_count, list.count() / min_rows_per_thread));
+    std::uintptr_t rows_per_thread = (list.count() + thread_count - 1) / thread_count;
+
+    // Where each thread starts, found in a walk that does nothing else, so
+    // that the expensive part runs in parallel. One thread needs no walk.
+    std::vector<HeadphonesList::ConstRecordIterator> starts;
+    if (thread_count == 1)
+    {
+        starts.push_back(list.cbegin());
+    }
+    else
+    {
+        std::uintptr_t row = 0;
+        for (auto it = list.cbegin(); it != list.cend(); ++it, ++row)
+        {
+            if (row % rows_per_thread == 0)
+            {
+                starts.push_back(it);
+            }
+        }
+    }
+    starts.push_back(list.cend());
+
+    std::vector<CatalogAggregator> partials;
+    partials.reserve(starts.size());
+    for (std::size_t i = 0; i < std::max<std::size_t>(1, starts.size() - 1); i++)
+    {
+        partials.emplace_back(group_key, top_count);
+    }
+    auto run = [&](std::size_t part)
+    {
+        std::uint64_t position = part * rows_per_thread;
+        for (auto it = starts[part]; it != starts[part + 1]; ++it)
+        {
+            partials[part].add(*it, position++);
+        }
+    };
+
+    pool.parallel_for(0, starts.size() - 1, 1, [&](std::size_t first, std::size_t last)
+    {
+        for (auto part = first; part < last; part++)
+        {
+            run(part);
+        }
+    });
+    for (std::size_t part = 1; part < partials.size(); part++)
+    {
+        partials[0].merge(partials[part]);
+    }
+
+    AggregateReport report;
+    report.groups = partials[0].groups();
+    report.top = partials[0].take_top();
+    report.rows = partials[0].rows();
+    report.seconds = seconds_since(start);
+    return report;
+}
+
+AggregateResult aggregate_stream(std::istream& is, GroupKey group_key, std::size_t top_count)
+{
+    auto start = Clock::now();
+    CatalogAggregator aggregator(group_key, top_count);
+    for (std::uint64_t position = 0;; position++)
+    {
+        auto result = HeadphonesList::deserialize_record(is);
+        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+        {
+            return std::get<HeadphonesList::DeserializeError>(result);
+        }
+        auto& node = std::get<HeadphonesList::Node::node_ptr>(result);
+        if (!node)
+        {
+            break;
+        }
+        aggregator.add(node->cvalue(), position);
+    }
+
+    AggregateReport report;
+    report.groups = aggregator.groups();
+    report.top = aggregator.take_top();
+    report.rows = aggregator.rows();
+    report.seconds = seconds_since(start);
+    return AggregateResult(std::move(report));
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+enum class GroupKey {
+    Producer,
+    EqualizerMode
+};
+
+class GroupStats {
+public:
+    std::string key;
+    std::uintptr_t count;
+    double volume_sum;
+    // Prices are free text; only those parse_price can read are counted.
+    std::uintptr_t priced_count;
+    double min_price;
+    double max_price;
+
+    GroupStats(std::string key);
+    double average_volume() const;
+};
+
+class TopRecord {
+public:
+    double price;
+    // Place in the input, which breaks ties in favour of the earlier record.
+    std::uint64_t position;
+    Headphones record;
+};
+
+// Accumulates group statistics and the top_count most expensive records one
+// record at a time, so it serves a list, a stream or one slice of either.
+// Groups live in an open-addressing table; the top records in a min-heap
+// bounded to top_count, so most records are turned away after a comparison.
+class CatalogAggregator {
+public:
+    CatalogAggregator(GroupKey group_key, std::size_t top_count);
+
+    void add(const Headphones& value, std::uint64_t position);
+    // Folds the partial results of another aggregator into this one.
+    void merge(CatalogAggregator& other);
+
+    std::uintptr_t rows() const;
+    // Sorted by key.
+    std::vector<GroupStats> groups() const;
+    // Most expensive first; leaves the aggregator without top records.
+    std::vector<TopRecord> take_top();
+private:
+    GroupKey m_group_key;
+    std::size_t m_top_count;
+    std::uintptr_t m_rows;
+    std::vector<GroupStats> m_groups;
+    std::vector<std::size_t> m_group_hashes;
+    // Group index plus one, zero marking a free slot.
+    std::vector<std::uint32_t> m_slots;
+    std::vector<TopRecord> m_top;
+
+    std::string_view key_of(const Headphones& value) const;
+    GroupStats& group(std::string_view key);
+    void grow();
+    void offer(double price, std::uint64_t position, const Headphones& value);
+    void offer(TopRecord&& top);
+};
+
+class AggregateReport {
+public:
+    std::vector<GroupStats> groups;
+    std::vector<TopRecord> top;
+    std::uintptr_t rows;
+    double seconds;
+
+    AggregateReport();
+};
+
+using AggregateResult = std::variant<AggregateReport, HeadphonesList::DeserializeError>;
+
+// Splits the list among the threads of the shared pool, each part with its
+// own aggregator, and merges the partial results at the end.
+AggregateReport aggregate(const HeadphonesList& list, GroupKey group_key, std::size_t top_count);
+// Aggregates a serialized catalog record by record without loading it.
+AggregateResult aggregate_stream(std::istream& is, GroupKey group_key, std::size_t top_count);
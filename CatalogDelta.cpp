@@ -0,0 +1,641 @@
+#include "CatalogDelta.hpp"
+#include "Autosave.hpp"
+#include "CatalogMerge.hpp"
+#include "HeadphonesSchema.hpp"
+#include "KeyTable.hpp"
+#include "PipelinedLoader.hpp"
+#include "Stopwatch.hpp"
+#include "Utf8.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    const char delta_magic[4] = {'H', 'P', 'D', 'L'};
+    const std::uint32_t delta_version = 1;
+
+    const char copy_op = 'C';
+    const char update_op = 'U';
+    const char insert_op = 'I';
+    const char end_op = 'E';
+
+    // Changed fields are marked in one byte.
+    static_assert(HeadphonesSchema::field_count <= 8, "field mask no longer fits in a byte");
+
+    const std::uint32_t no_record = std::numeric_limits<std::uint32_t>::max();
+
+    class DeltaHeader {
+    public:
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t base_count;
+        std::uint64_t base_digest;
+        std::uint64_t target_count;
+        std::uint64_t target_digest;
+    };
+
+    // Order matters, so that a moved record changes the digest.
+    std::uint64_t fold_digest(std::uint64_t digest, std::uint64_t fingerprint)
+    {
+        return (digest ^ fingerprint) * 0x100000001B3ull;
+    }
+
+    void put_varint(std::string& out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out += (char)(value | 0x80);
+            value >>= 7;
+        }
+        out += (char)value;
+    }
+
+    bool get_varint(const char*& it, const char* last, std::uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && it != last; shift += 7)
+        {
+            auto byte = (unsigned char)*it++;
+            value |= (std::uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs usually start a little after the previous one, so the offset is
+    // written zigzag-encoded to keep small negative ones short.
+    std::uint64_t zigzag(std::int64_t value)
+    {
+        return ((std::uint64_t)value << 1) ^ (std::uint64_t)(value >> 63);
+    }
+
+    std::int64_t unzigzag(std::uint64_t value)
+    {
+        return (std::int64_t)(value >> 1) ^ -(std::int64_t)(value & 1);
+    }
+
+    std::uint8_t changed_fields(const Headphones& from, const Headphones& to)
+    {
+        std::uint8_t mask = 0;
+        std::size_t i = 0;
+        HeadphonesSchema::for_each_field(
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                if (!(Field::get(from) == Field::get(to)))
+                {
+                    mask |= (std::uint8_t)(1 << i);
+                }
+                i++;
+            }
+        );
+        return mask;
+    }
+
+    void assign_fields(Headphones& to, const Headphones& from, std::uint8_t mask)
+    {
+        std::size_t i = 0;
+        HeadphonesSchema::for_each_field(
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                if (mask & (1 << i))
+                {
+                    Field::get(to) = Field::get(from);
+                }
+                i++;
+            }
+        );
+    }
+
+    // Every key of the old version with its records, linked in order through
+    // next_same, so that each record of the new version takes the first of
+    // them not yet taken.
+    class KeyEntry {
+    public:
+        std::uint32_t first_untaken;
+        std::uint32_t last;
+    };
+
+    class BaseKeys {
+    public:
+        BaseKeys(const std::vector<const Headphones*>& records) :
+            m_records(records),
+            m_entries(),
+            m_entry_of(records.size(), 0),
+            m_next_same(records.size(), no_record),
+            m_table(records.size())
+        {
+            for (std::uint32_t i = 0; i < (std::uint32_t)records.size(); i++)
+            {
+                auto& slot = find(*records[i]);
+                if (slot.entry == 0)
+                {
+                    m_entries.push_back(KeyEntry {i, i});
+                    slot.entry = (std::uint32_t)m_entries.size();
+                    m_entry_of[i] = slot.entry - 1;
+                    continue;
+                }
+                auto& entry = m_entries[slot.entry - 1];
+                m_next_same[entry.last] = i;
+                entry.last = i;
+                m_entry_of[i] = slot.entry - 1;
+            }
+        }
+
+        // Most records follow the one before them in both versions, so the
+        // record after the previous match is tried before the hash table.
+        std::uint32_t take(const Headphones& value, std::uint64_t expected)
+        {
+            if (expected < m_records.size())
+            {
+                auto& entry = m_entries[m_entry_of[expected]];
+                if (entry.first_untaken == expected && KeyTable::has_same_key(*m_records[expected], value))
+                {
+                    entry.first_untaken = m_next_same[expected];
+                    return (std::uint32_t)expected;
+                }
+            }
+
+            auto& slot = find(value);
+            if (slot.entry == 0)
+            {
+                return no_record;
+            }
+            auto& entry = m_entries[slot.entry - 1];
+            auto taken = entry.first_untaken;
+            if (taken != no_record)
+            {
+                entry.first_untaken = m_next_same[taken];
+            }
+            return taken;
+        }
+    private:
+        const std::vector<const Headphones*>& m_records;
+        std::vector<KeyEntry> m_entries;
+        std::vector<std::uint32_t> m_entry_of;
+        std::vector<std::uint32_t> m_next_same;
+        KeyTable m_table;
+
+        KeyTable::Slot& find(const Headphones& value)
+        {
+            return m_table.find(
+                key_fingerprint(value.get_producer_name(), value.get_model_name()),
+                value,
+                [this](std::uint32_t entry) -> const Headphones&
+                {
+                    return *m_records[m_entries[entry].last];
+                }
+            );
+        }
+    };
+
+    // A patch read in full and checked before the list is changed.
+    class DeltaOp {
+    public:
+        char kind;
+        std::uint64_t start;
+        std::uint64_t count;
+        std::uint8_t mask;
+        // The inserted record, or the new values of the updated fields.
+        HeadphonesList::Node::node_ptr record;
+    };
+}
+
+DeltaReport::DeltaReport() :
+    copied(0),
+    inserted(0),
+    updated(0),
+    removed(0),
+    moved(0),
+    patch_bytes(0),
+    seconds(0.0)
+{}
+
+HeadphonesList::SerializeResult write_delta(
+    const HeadphonesList& base,
+    const HeadphonesList& target,
+    std::ostream& os,
+    DeltaReport& report
+)
+{
+    const auto io_err = "Ошибка ввода-вывода при записи патча.";
+    const auto size_err = "Каталог слишком велик для патча.";
+
+    auto start = Clock::now();
+    report = DeltaReport();
+    if (base.count() >= no_record)
+    {
+        return HeadphonesList::SerializeError(size_err);
+    }
+
+    std::string scratch;
+    DeltaHeader header {};
+    std::memcpy(header.magic, delta_magic, sizeof(delta_magic));
+    header.version = delta_version;
+
+    std::vector<const Headphones*> base_records;
+    base_records.reserve(base.count());
+    for (const auto& value : base)
+    {
+        base_records.push_back(&value);
+        header.base_digest = fold_digest(header.base_digest, record_fingerprint(value));
+    }
+    header.base_count = base_records.size();
+    BaseKeys table(base_records);
+
+    std::string block;
+    std::uint64_t cursor = 0;
+    std::uint64_t run_start = 0;
+    std::uint64_t run_count = 0;
+    auto flush_run = [&]()
+    {
+        if (run_count == 0)
+        {
+            return;
+        }
+        block += copy_op;
+        put_varint(block, zigzag((std::int64_t)run_start - (std::int64_t)cursor));
+        put_varint(block, run_count);
+        if (run_start < cursor)
+        {
+            report.moved++;
+        }
+        cursor = run_start + run_count;
+        run_count = 0;
+    };
+
+    for (const auto& value : target)
+    {
+        header.target_count++;
+        header.target_digest = fold_digest(header.target_digest, record_fingerprint(value));
+
+        auto taken = table.take(value, run_count > 0 ? run_start + run_count : cursor);
+        if (taken == no_record)
+        {
+            flush_run();
+            block += insert_op;
+            HeadphonesList::serialize_record(block, value);
+            report.inserted++;
+            continue;
+        }
+
+        report.copied++;
+        if (run_count > 0 && taken == run_start + run_count)
+        {
+            run_count++;
+        }
+        else
+        {
+            flush_run();
+            run_start = taken;
+            run_count = 1;
+        }
+
+        auto mask = changed_fields(*base_records[taken], value);
+        if (mask == 0)
+        {
+            continue;
+        }
+        flush_run();
+        block += update_op;
+        block += (char)mask;
+        std::size_t i = 0;
+        HeadphonesSchema::for_each_field(
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                if (mask & (1 << i++))
+                {
+                    scratch.clear();
+                    Field::encoding::encode(Field::get(value), scratch);
+                    put_varint(block, scratch.size());
+                    block += scratch;
+                }
+            }
+        );
+        report.updated++;
+    }
+    flush_run();
+    block += end_op;
+
+    os.write((const char*)&header, sizeof(header));
+    os.write(block.data(), block.size());
+    if (!os)
+    {
+        return HeadphonesList::SerializeError(io_err);
+    }
+    report.removed = base_records.size() - report.copied;
+    report.patch_bytes = sizeof(header) + block.size();
+    report.seconds = seconds_since(start);
+    return std::monostate();
+}
+
+DeltaApplyResult apply_delta(HeadphonesList& list, std::istream& is, DeltaReport& report)
+{
+    const auto io_err = "Ошибка ввода-вывода при чтении патча.";
+    const auto ill_err = "Файл патча повреждён или записан некорректно.";
+    const auto base_err = "Патч составлен для другой версии каталога.";
+    const auto target_err = "Результат применения патча не совпадает с каталогом, из которого он составлен.";
+
+    auto start = Clock::now();
+    report = DeltaReport();
+
+    std::string patch;
+    try
+    {
+        patch.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        return HeadphonesList::DeserializeError(io_err);
+    }
+    if (is.bad())
+    {
+        return HeadphonesList::DeserializeError(io_err);
+    }
+
+    DeltaHeader header;
+    if (patch.size() < sizeof(header))
+    {
+        return HeadphonesList::DeserializeError(ill_err);
+    }
+    std::memcpy(&header, patch.data(), sizeof(header));
+    if (std::memcmp(header.magic, delta_magic, sizeof(delta_magic)) != 0 || header.version != delta_version)
+    {
+        return HeadphonesList::DeserializeError(ill_err);
+    }
+    if (header.base_count != list.count())
+    {
+        return HeadphonesList::DeserializeError(base_err);
+    }
+
+    std::vector<HeadphonesList::Node::node_ptr> base_nodes;
+    std::vector<std::uint64_t> base_fingerprints;
+    base_nodes.reserve(list.count());
+    base_fingerprints.reserve(list.count());
+    std::uint64_t base_digest = 0;
+    for (auto it = list.head(); *it; ++it)
+    {
+        base_nodes.push_back(*it);
+        base_fingerprints.push_back(record_fingerprint((*it)->cvalue()));
+        base_digest = fold_digest(base_digest, base_fingerprints.back());
+    }
+    if (base_digest != header.base_digest)
+    {
+        return HeadphonesList::DeserializeError(base_err);
+    }
+
+    // Decodes the whole patch and works out the digest of the result, so that
+    // nothing is changed unless all of it applies.
+    std::vector<DeltaOp> ops;
+    std::vector<bool> is_taken(base_nodes.size(), false);
+    std::uint64_t target_count = 0;
+    std::uint64_t target_digest = 0;
+    // The last record copied or inserted, which an update applies to.
+    std::uint64_t last_fingerprint = 0;
+    bool has_last = false;
+    std::uint64_t cursor = 0;
+
+    const char* it = patch.data() + sizeof(header);
+    const char* last = patch.data() + patch.size();
+    auto commit_last = [&]()
+    {
+        if (has_last)
+        {
+            target_count++;
+            target_digest = fold_digest(target_digest, last_fingerprint);
+        }
+    };
+    while (true)
+    {
+        if (it == last)
+        {
+            return HeadphonesList::DeserializeError(ill_err);
+        }
+        char kind = *it++;
+        if (kind == end_op)
+        {
+            commit_last();
+            break;
+        }
+
+        DeltaOp op {kind, 0, 0, 0, nullptr};
+        if (kind == copy_op)
+        {
+            std::uint64_t offset;
+            if (!get_varint(it, last, offset) || !get_varint(it, last, op.count) || op.count == 0)
+            {
+                return HeadphonesList::DeserializeError(ill_err);
+            }
+            op.start = cursor + (std::uint64_t)unzigzag(offset);
+            if (op.start >= base_nodes.size() || op.count > base_nodes.size() - op.start)
+            {
+                return HeadphonesList::DeserializeError(ill_err);
+            }
+            for (std::uint64_t i = op.start; i < op.start + op.count; i++)
+            {
+                if (is_taken[i])
+                {
+                    return HeadphonesList::DeserializeError(ill_err);
+                }
+                is_taken[i] = true;
+                commit_last();
+                last_fingerprint = base_fingerprints[i];
+                has_last = true;
+            }
+            if (op.start < cursor)
+            {
+                report.moved++;
+            }
+            cursor = op.start + op.count;
+            report.copied += op.count;
+        }
+        else if (kind == insert_op)
+        {
+            auto result = HeadphonesList::deserialize_record(it, last, (std::uint64_t)(it - patch.data()), patch.data());
+            if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+            {
+                return std::get<HeadphonesList::DeserializeError>(result);
+            }
+            op.record = std::get<HeadphonesList::Node::node_ptr>(result);
+            if (!op.record)
+            {
+                return HeadphonesList::DeserializeError(ill_err);
+            }
+            commit_last();
+            last_fingerprint = record_fingerprint(op.record->cvalue());
+            has_last = true;
+            report.inserted++;
+        }
+        else if (kind == update_op)
+        {
+            if (it == last || !has_last || ops.back().kind == update_op)
+            {
+                return HeadphonesList::DeserializeError(ill_err);
+            }
+            op.mask = (std::uint8_t)*it++;
+            op.record = std::make_shared<HeadphonesList::Node>();
+            bool is_valid = op.mask != 0 && op.mask < (1 << HeadphonesSchema::field_count);
+            std::size_t i = 0;
+            HeadphonesSchema::all_fields(
+                [&](const auto& field)
+                {
+                    using Field = std::decay_t<decltype(field)>;
+                    if (!(op.mask & (1 << i++)))
+                    {
+                        return true;
+                    }
+                    std::uint64_t len;
+                    if (!get_varint(it, last, len) || len > (std::uint64_t)(last - it))
+                    {
+                        is_valid = false;
+                        return false;
+                    }
+                    std::string text(it, (std::size_t)len);
+                    it += len;
+                    is_valid = is_valid && Field::encoding::decode(std::move(text), Field::get(op.record->value()));
+                    return is_valid;
+                }
+            );
+            if (!is_valid)
+            {
+                return HeadphonesList::DeserializeError(ill_err);
+            }
+
+            // The fingerprint of the updated record, before any node changes.
+            const auto& updated = ops.back().kind == copy_op
+                ? base_nodes[ops.back().start + ops.back().count - 1]->cvalue()
+                : ops.back().record->cvalue();
+            Headphones value;
+            HeadphonesSchema::assign(value, updated);
+            assign_fields(value, op.record->cvalue(), op.mask);
+            last_fingerprint = record_fingerprint(value);
+            report.updated++;
+        }
+        else
+        {
+            return HeadphonesList::DeserializeError(ill_err);
+        }
+        ops.push_back(std::move(op));
+    }
+    if (target_count != header.target_count || target_digest != header.target_digest)
+    {
+        return HeadphonesList::DeserializeError(target_err);
+    }
+
+    std::vector<HeadphonesList::Node::node_ptr> nodes;
+    nodes.reserve(target_count);
+    for (auto& op : ops)
+    {
+        switch (op.kind)
+        {
+        case copy_op:
+            nodes.insert(nodes.end(), base_nodes.begin() + op.start, base_nodes.begin() + op.start + op.count);
+            break;
+        case insert_op:
+            nodes.push_back(std::move(op.record));
+            break;
+        case update_op:
+        {
+            // The base node may be held by a snapshot, so it is replaced by
+            // an updated copy rather than changed.
+            auto copy = std::make_shared<HeadphonesList::Node>();
+            HeadphonesSchema::assign(copy->value(), nodes.back()->cvalue());
+            assign_fields(copy->value(), op.record->cvalue(), op.mask);
+            nodes.back() = std::move(copy);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    list.clear();
+    list.insert_range(HeadphonesList::Iterator(nullptr), nodes.begin(), nodes.end());
+
+    report.removed = base_nodes.size() - report.copied;
+    report.patch_bytes = patch.size();
+    report.seconds = seconds_since(start);
+    return std::monostate();
+}
+
+HeadphonesList::SerializeResult diff_catalog_files(
+    const std::string& base_filename,
+    const std::string& target_filename,
+    const std::string& patch_filename,
+    DeltaReport& report
+)
+{
+    const auto open_err = "Не получается открыть файл каталога.";
+
+    HeadphonesList lists[2];
+    const std::string* filenames[2] = {&base_filename, &target_filename};
+    for (std::size_t i = 0; i < 2; i++)
+    {
+        PipelinedLoader loader(*filenames[i]);
+        if (!loader.is_open())
+        {
+            return HeadphonesList::SerializeError(open_err);
+        }
+        auto result = loader.load();
+        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+        {
+            return HeadphonesList::SerializeError(std::get<HeadphonesList::DeserializeError>(result).message);
+        }
+        lists[i] = std::move(std::get<HeadphonesList>(result));
+    }
+
+    return write_file_atomically(
+        patch_filename,
+        [&](std::ostream& os)
+        {
+            return write_delta(lists[0], lists[1], os, report);
+        }
+    );
+}
+
+DeltaApplyResult apply_delta_file(
+    const std::string& catalog_filename,
+    const std::string& patch_filename,
+    DeltaReport& report
+)
+{
+    const auto open_err = "Не получается открыть файл каталога.";
+    const auto patch_open_err = "Не получается открыть файл патча.";
+
+    std::ifstream patch(utf8_path(patch_filename), std::ios::in | std::ios::binary);
+    if (!patch.is_open())
+    {
+        return HeadphonesList::DeserializeError(patch_open_err);
+    }
+    PipelinedLoader loader(catalog_filename);
+    if (!loader.is_open())
+    {
+        return HeadphonesList::DeserializeError(open_err);
+    }
+    auto loaded = loader.load();
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(loaded))
+    {
+        return std::get<HeadphonesList::DeserializeError>(loaded);
+    }
+
+    auto& list = std::get<HeadphonesList>(loaded);
+    auto result = apply_delta(list, patch, report);
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+    {
+        return result;
+    }
+    auto saved = save_snapshot_atomically(list.snapshot(), catalog_filename);
+    if (std::holds_alternative<HeadphonesList::SerializeError>(saved))
+    {
+        return HeadphonesList::DeserializeError(std::get<HeadphonesList::SerializeError>(saved).message);
+    }
+    return std::monostate();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <variant>
+
+// A patch turns one version of a catalog into another. Records are matched
+// on (producer, model), the n-th record with a key in the new version with
+// the n-th one in the old, and the new version is described in order as:
+//
+//   copy    a run of old records, named by where it starts relative to the
+//           end of the previous run, so that records left in place cost
+//           nothing and a moved block costs one run;
+//   update  changed fields of the record just copied;
+//   insert  a record in catalog format.
+//
+// Old records that are never copied are removed. The header carries the
+// record count and a digest of both versions, so a patch is only ever
+// applied to the catalog it was made from, and the result is checked before
+// the list is touched.
+class DeltaReport {
+public:
+    std::uintptr_t copied;
+    std::uintptr_t inserted;
+    std::uintptr_t updated;
+    std::uintptr_t removed;
+    // Runs copied out of the old order.
+    std::uintptr_t moved;
+    std::uint64_t patch_bytes;
+    double seconds;
+
+    DeltaReport();
+};
+
+using DeltaApplyResult = std::variant<std::monostate, HeadphonesList::DeserializeError>;
+
+// One pass over each list with a hash table of the old keys.
+HeadphonesList::SerializeResult write_delta(
+    const HeadphonesList& base,
+    const HeadphonesList& target,
+    std::ostream& os,
+    DeltaReport& report
+);
+// Updated records get new nodes, since snapshots may hold the old ones; the
+// list is left as it was on error.
+DeltaApplyResult apply_delta(HeadphonesList& list, std::istream& is, DeltaReport& report);
+
+// File versions; the patch and the patched catalog are written atomically.
+HeadphonesList::SerializeResult diff_catalog_files(
+    const std::string& base_filename,
+    const std::string& target_filename,
+    const std::string& patch_filename,
+    DeltaReport& report
+);
+DeltaApplyResult apply_delta_file(
+    const std::string& catalog_filename,
+    const std::string& patch_filename,
+    DeltaReport& report
+);
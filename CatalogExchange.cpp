@@ -0,0 +1,985 @@
+#include "CatalogExchange.hpp"
+#include "HeadphonesSchema.hpp"
+#include "Stopwatch.hpp"
+#include "Utf8.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HEADPHONES_HAS_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    const std::size_t read_chunk_size = 1 << 20;
+    const std::size_t write_block_size = 1 << 20;
+    const char utf8_bom[] = "\xEF\xBB\xBF";
+    const std::size_t utf8_bom_size = 3;
+
+    const char* io_read_err = "Ошибка ввода-вывода при чтении файла.";
+    const char* io_write_err = "Ошибка ввода-вывода при записи файла";
+
+#ifdef HEADPHONES_HAS_SSE2
+    unsigned count_trailing_zeros(unsigned mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (unsigned)index;
+#else
+        return (unsigned)__builtin_ctz(mask);
+#endif
+    }
+#endif
+
+    // The structural scanner: returns the first of the three bytes in [p, end),
+    // or end. Cell and string contents are skipped 16 bytes at a time.
+    const char* find_any_of(const char* p, const char* end, char a, char b, char c)
+    {
+#ifdef HEADPHONES_HAS_SSE2
+        const __m128i match_a = _mm_set1_epi8(a);
+        const __m128i match_b = _mm_set1_epi8(b);
+        const __m128i match_c = _mm_set1_epi8(c);
+        while (end - p >= 16)
+        {
+            __m128i block = _mm_loadu_si128((const __m128i*)p);
+            __m128i hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, match_a), _mm_cmpeq_epi8(block, match_b)),
+                _mm_cmpeq_epi8(block, match_c)
+            );
+            unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+            if (mask != 0)
+            {
+                return p + count_trailing_zeros(mask);
+            }
+            p += 16;
+        }
+#endif
+        for (; p < end; p++)
+        {
+            if (*p == a || *p == b || *p == c)
+            {
+                return p;
+            }
+        }
+        return end;
+    }
+
+    // A window over the input that grows a chunk at a time. Parsers work on
+    // [position(), end()) and call read_more() when a record is cut off.
+    class ChunkedInput {
+    public:
+        ChunkedInput(std::istream& is) :
+            m_is(is),
+            m_buffer(),
+            m_position(0),
+            m_is_at_eof(false),
+            m_has_failed(false)
+        {}
+
+        const char* position() const
+        {
+            return m_buffer.data() + m_position;
+        }
+        const char* end() const
+        {
+            return m_buffer.data() + m_buffer.size();
+        }
+        bool is_at_eof() const
+        {
+            return m_is_at_eof;
+        }
+        bool has_failed() const
+        {
+            return m_has_failed;
+        }
+        void consume(const char* p)
+        {
+            m_position = (std::size_t)(p - m_buffer.data());
+        }
+
+        // Drops the consumed bytes and appends the next chunk; pointers into
+        // the window are invalidated. Returns false once nothing is left.
+        bool read_more()
+        {
+            if (m_is_at_eof)
+            {
+                return false;
+            }
+            m_buffer.erase(0, m_position);
+            m_position = 0;
+
+            std::size_t size = m_buffer.size();
+            m_buffer.resize(size + read_chunk_size);
+            try
+            {
+                m_is.read(m_buffer.data() + size, read_chunk_size);
+            }
+            catch (const std::ios_base::failure& e) {}
+
+            auto read = (std::size_t)m_is.gcount();
+            m_buffer.resize(size + read);
+            if (m_is.bad())
+            {
+                m_has_failed = true;
+            }
+            if (m_is.bad() || m_is.eof() || read < read_chunk_size)
+            {
+                m_is_at_eof = true;
+            }
+            return read != 0;
+        }
+
+        void skip_bom()
+        {
+            if ((std::size_t)(end() - position()) >= utf8_bom_size
+                && std::memcmp(position(), utf8_bom, utf8_bom_size) == 0)
+            {
+                consume(position() + utf8_bom_size);
+            }
+        }
+    private:
+        std::istream& m_is;
+        std::string m_buffer;
+        std::size_t m_position;
+        bool m_is_at_eof;
+        bool m_has_failed;
+    };
+
+    // Collects the output of one export and hands it to the stream in blocks.
+    class BlockWriter {
+    public:
+        BlockWriter(std::ostream& os) :
+            m_os(os),
+            m_block()
+        {
+            m_block.reserve(write_block_size + 4096);
+        }
+
+        std::string& block()
+        {
+            return m_block;
+        }
+        bool flush_if_full()
+        {
+            return m_block.size() < write_block_size || flush();
+        }
+        bool flush()
+        {
+            try
+            {
+                m_os.write(m_block.data(), m_block.size());
+            }
+            catch (const std::ios_base::failure& e)
+            {
+                return false;
+            }
+            m_block.clear();
+            return (bool)m_os;
+        }
+    private:
+        std::ostream& m_os;
+        std::string m_block;
+    };
+
+    // Decodes text into the field at field_index. Empty text is an empty
+    // string in a text field and leaves any other field at its default.
+    bool decode_field(std::size_t field_index, std::string& text, Headphones& value)
+    {
+        if (!is_valid_utf8(text.data(), text.size()))
+        {
+            return false;
+        }
+        bool is_decoded = false;
+        HeadphonesSchema::visit_field(
+            field_index,
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                if (text.empty() && !std::is_same_v<typename Field::encoding, TextEncoding>)
+                {
+                    is_decoded = true;
+                    return;
+                }
+                is_decoded = Field::encoding::decode(std::move(text), Field::get(value));
+            }
+        );
+        return is_decoded;
+    }
+
+    std::string field_key(std::size_t field_index)
+    {
+        std::string key;
+        HeadphonesSchema::visit_field(field_index, [&](const auto& field) { key = field.key; });
+        return key;
+    }
+
+    enum class RowStatus {
+        Complete,
+        Incomplete,
+        Malformed
+    };
+
+    // Splits the CSV row at p into cells and moves p past its line break. A
+    // row cut off by the end of the window is incomplete unless the input has
+    // ended, in which case a missing final line break is fine.
+    RowStatus parse_csv_row(const char*& p, const char* end, char delimiter, bool is_at_eof, std::vector<std::string>& cells)
+    {
+        const char* q = p;
+        std::size_t count = 0;
+        while (true)
+        {
+            if (count == cells.size())
+            {
+                cells.emplace_back();
+            }
+            std::string& cell = cells[count++];
+            cell.clear();
+
+            if (q < end && *q == '"')
+            {
+                q++;
+                while (true)
+                {
+                    const char* quote = find_any_of(q, end, '"', '"', '"');
+                    if (quote == end)
+                    {
+                        return is_at_eof ? RowStatus::Malformed : RowStatus::Incomplete;
+                    }
+                    cell.append(q, quote);
+                    if (quote + 1 == end && !is_at_eof)
+                    {
+                        return RowStatus::Incomplete;
+                    }
+                    if (quote + 1 < end && quote[1] == '"')
+                    {
+                        cell += '"';
+                        q = quote + 2;
+                        continue;
+                    }
+                    q = quote + 1;
+                    break;
+                }
+            }
+            else
+            {
+                const char* stop = find_any_of(q, end, delimiter, '\n', '\r');
+                if (stop == end && !is_at_eof)
+                {
+                    return RowStatus::Incomplete;
+                }
+                cell.append(q, stop);
+                q = stop;
+            }
+
+            if (q == end)
+            {
+                break;
+            }
+            if (*q == delimiter)
+            {
+                q++;
+                continue;
+            }
+            if (*q == '\r')
+            {
+                if (q + 1 == end && !is_at_eof)
+                {
+                    return RowStatus::Incomplete;
+                }
+                q++;
+                if (q < end && *q == '\n')
+                {
+                    q++;
+                }
+                break;
+            }
+            if (*q == '\n')
+            {
+                q++;
+                break;
+            }
+            // Text between a closing quote and the next delimiter.
+            return RowStatus::Malformed;
+        }
+
+        cells.resize(count);
+        p = q;
+        return RowStatus::Complete;
+    }
+
+    // Returns nullopt once the input is exhausted.
+    std::optional<RowStatus> read_csv_row(ChunkedInput& input, char delimiter, std::vector<std::string>& cells)
+    {
+        while (true)
+        {
+            const char* p = input.position();
+            if (p == input.end())
+            {
+                if (!input.read_more())
+                {
+                    return std::nullopt;
+                }
+                continue;
+            }
+
+            auto status = parse_csv_row(p, input.end(), delimiter, input.is_at_eof(), cells);
+            if (status != RowStatus::Incomplete)
+            {
+                input.consume(p);
+                return status;
+            }
+            input.read_more();
+        }
+    }
+
+    bool needs_csv_quotes(const char* p, const char* end)
+    {
+        return find_any_of(p, end, ',', '"', '\n') != end || std::memchr(p, '\r', end - p) != nullptr;
+    }
+
+    // Quotes the cell that starts at block[start] if it has to be.
+    void quote_csv_cell(std::string& block, std::size_t start)
+    {
+        if (!needs_csv_quotes(block.data() + start, block.data() + block.size()))
+        {
+            return;
+        }
+        std::string cell = block.substr(start);
+        block.resize(start);
+        block += '"';
+        for (char ch : cell)
+        {
+            if (ch == '"')
+            {
+                block += '"';
+            }
+            block += ch;
+        }
+        block += '"';
+    }
+
+    void skip_json_whitespace(const char*& p, const char* end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        {
+            p++;
+        }
+    }
+
+    // Skips whitespace, reading more input as needed. Returns false at the end
+    // of the input.
+    bool skip_json_whitespace(ChunkedInput& input)
+    {
+        while (true)
+        {
+            const char* p = input.position();
+            skip_json_whitespace(p, input.end());
+            input.consume(p);
+            if (p != input.end())
+            {
+                return true;
+            }
+            if (!input.read_more())
+            {
+                return false;
+            }
+        }
+    }
+
+    // Finds the '}' closing the flat object at p, or returns end if the
+    // object is cut off.
+    const char* find_json_object_end(const char* p, const char* end)
+    {
+        bool is_in_string = false;
+        while (p < end)
+        {
+            if (is_in_string)
+            {
+                p = find_any_of(p, end, '"', '\\', '\\');
+                if (p == end)
+                {
+                    return end;
+                }
+                if (*p == '\\')
+                {
+                    p += 2;
+                    continue;
+                }
+                is_in_string = false;
+                p++;
+            }
+            else
+            {
+                p = find_any_of(p, end, '"', '}', '}');
+                if (p == end || *p == '}')
+                {
+                    return p;
+                }
+                is_in_string = true;
+                p++;
+            }
+        }
+        return end;
+    }
+
+    bool parse_hex4(const char*& p, const char* end, char32_t& value)
+    {
+        if (end - p < 4)
+        {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char ch = *p++;
+            value <<= 4;
+            if (ch >= '0' && ch <= '9')
+            {
+                value |= ch - '0';
+            }
+            else if (ch >= 'a' && ch <= 'f')
+            {
+                value |= ch - 'a' + 10;
+            }
+            else if (ch >= 'A' && ch <= 'F')
+            {
+                value |= ch - 'A' + 10;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // p points at the opening quote.
+    bool parse_json_string(const char*& p, const char* end, std::string& out)
+    {
+        out.clear();
+        p++;
+        while (true)
+        {
+            const char* stop = find_any_of(p, end, '"', '\\', '\\');
+            out.append(p, stop);
+            if (stop == end)
+            {
+                return false;
+            }
+            p = stop + 1;
+            if (*stop == '"')
+            {
+                return true;
+            }
+
+            if (p == end)
+            {
+                return false;
+            }
+            switch (*p++)
+            {
+            case '"':
+                out += '"';
+                break;
+            case '\\':
+                out += '\\';
+                break;
+            case '/':
+                out += '/';
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u':
+            {
+                char32_t code_point;
+                if (!parse_hex4(p, end, code_point))
+                {
+                    return false;
+                }
+                if (code_point >= 0xD800 && code_point <= 0xDBFF)
+                {
+                    char32_t low;
+                    if (end - p < 2 || p[0] != '\\' || p[1] != 'u')
+                    {
+                        return false;
+                    }
+                    p += 2;
+                    if (!parse_hex4(p, end, low) || low < 0xDC00 || low > 0xDFFF)
+                    {
+                        return false;
+                    }
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                }
+                else if (code_point >= 0xDC00 && code_point <= 0xDFFF)
+                {
+                    return false;
+                }
+                append_utf8(code_point, out);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+    }
+
+    // Reads a scalar as the text its field encoding expects: strings
+    // unescaped, numbers as written and true/false as 1/0. null sets is_null.
+    bool parse_json_scalar(const char*& p, const char* end, std::string& text, bool& is_null)
+    {
+        is_null = false;
+        if (p == end)
+        {
+            return false;
+        }
+        if (*p == '"')
+        {
+            return parse_json_string(p, end, text);
+        }
+
+        auto take_literal = [&](const char* literal, const char* value)
+        {
+            std::size_t length = std::strlen(literal);
+            if ((std::size_t)(end - p) < length || std::memcmp(p, literal, length) != 0)
+            {
+                return false;
+            }
+            p += length;
+            text = value;
+            return true;
+        };
+        if (*p == 't')
+        {
+            return take_literal("true", "1");
+        }
+        if (*p == 'f')
+        {
+            return take_literal("false", "0");
+        }
+        if (*p == 'n')
+        {
+            is_null = true;
+            return take_literal("null", "");
+        }
+
+        const char* start = p;
+        while (p < end && (std::isdigit((unsigned char)*p) || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E'))
+        {
+            p++;
+        }
+        text.assign(start, p);
+        return p != start;
+    }
+
+    // Parses the object spanning [p, object_end] into value.
+    std::optional<std::string> parse_json_object(const char* p, const char* object_end, Headphones& value)
+    {
+        const auto ill_err = "некорректный объект JSON";
+        std::string key;
+        std::string text;
+        bool is_null = false;
+
+        p++;
+        skip_json_whitespace(p, object_end);
+        if (*p == '}')
+        {
+            return std::nullopt;
+        }
+        while (true)
+        {
+            if (*p != '"' || !parse_json_string(p, object_end, key))
+            {
+                return std::string(ill_err);
+            }
+            skip_json_whitespace(p, object_end);
+            if (*p != ':')
+            {
+                return std::string(ill_err);
+            }
+            p++;
+            skip_json_whitespace(p, object_end);
+            if (!parse_json_scalar(p, object_end, text, is_null))
+            {
+                return std::string(ill_err);
+            }
+
+            // null, like a missing key, leaves the field at its default.
+            auto field_index = HeadphonesSchema::find_field(key);
+            if (field_index && !is_null && !decode_field(*field_index, text, value))
+            {
+                return "некорректное значение поля \"" + key + "\"";
+            }
+
+            skip_json_whitespace(p, object_end);
+            if (*p == '}')
+            {
+                return std::nullopt;
+            }
+            if (*p != ',')
+            {
+                return std::string(ill_err);
+            }
+            p++;
+            skip_json_whitespace(p, object_end);
+        }
+    }
+
+    void append_json_string(std::string& block, const std::string& text)
+    {
+        const char* hex = "0123456789abcdef";
+        block += '"';
+        for (char ch : text)
+        {
+            switch (ch)
+            {
+            case '"':
+                block += "\\\"";
+                break;
+            case '\\':
+                block += "\\\\";
+                break;
+            case '\n':
+                block += "\\n";
+                break;
+            case '\r':
+                block += "\\r";
+                break;
+            case '\t':
+                block += "\\t";
+                break;
+            default:
+                if ((unsigned char)ch < 0x20)
+                {
+                    block += "\\u00";
+                    block += hex[(unsigned char)ch >> 4];
+                    block += hex[(unsigned char)ch & 0x0F];
+                }
+                else
+                {
+                    block += ch;
+                }
+            }
+        }
+        block += '"';
+    }
+}
+
+ExchangeReport::ExchangeReport() :
+    rows(0),
+    seconds(0.0)
+{}
+
+double ExchangeReport::rows_per_second() const
+{
+    return seconds > 0.0 ? rows / seconds : 0.0;
+}
+
+HeadphonesList::DeserializeResult import_csv(std::istream& is, ExchangeReport& report)
+{
+    auto start = Clock::now();
+    report = ExchangeReport();
+    HeadphonesList list {};
+
+    ChunkedInput input(is);
+    input.read_more();
+    input.skip_bom();
+
+    // Excel in a Russian locale separates cells with semicolons.
+    const char* header_end = find_any_of(input.position(), input.end(), '\n', '\n', '\n');
+    auto commas = std::count(input.position(), header_end, ',');
+    auto semicolons = std::count(input.position(), header_end, ';');
+    char delimiter = semicolons > commas ? ';' : ',';
+
+    std::vector<std::string> cells;
+    auto header = read_csv_row(input, delimiter, cells);
+    if (input.has_failed())
+    {
+        return HeadphonesList::DeserializeError(io_read_err);
+    }
+    if (!header || *header != RowStatus::Complete)
+    {
+        return HeadphonesList::DeserializeError("В файле CSV нет строки заголовка.");
+    }
+
+    std::vector<std::optional<std::size_t>> columns;
+    bool has_known_column = false;
+    for (auto& name : cells)
+    {
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        columns.push_back(HeadphonesSchema::find_field(name));
+        has_known_column = has_known_column || columns.back().has_value();
+    }
+    if (!has_known_column)
+    {
+        return HeadphonesList::DeserializeError("В заголовке CSV нет ни одного известного столбца.");
+    }
+
+    while (true)
+    {
+        auto status = read_csv_row(input, delimiter, cells);
+        if (input.has_failed())
+        {
+            return HeadphonesList::DeserializeError(io_read_err);
+        }
+        if (!status)
+        {
+            break;
+        }
+
+        auto row = std::to_string(report.rows + 1);
+        if (*status == RowStatus::Malformed)
+        {
+            return HeadphonesList::DeserializeError("Запись " + row + ": некорректная строка CSV.");
+        }
+        if (cells.size() == 1 && cells[0].empty())
+        {
+            continue;
+        }
+        if (cells.size() != columns.size())
+        {
+            return HeadphonesList::DeserializeError(
+                "Запись " + row + ": ожидалось столбцов: " + std::to_string(columns.size())
+                + ", найдено: " + std::to_string(cells.size()) + "."
+            );
+        }
+
+        auto node = std::make_shared<HeadphonesList::Node>();
+        for (std::size_t i = 0; i < cells.size(); i++)
+        {
+            if (columns[i] && !decode_field(*columns[i], cells[i], node->value()))
+            {
+                return HeadphonesList::DeserializeError(
+                    "Запись " + row + ": некорректное значение в столбце \"" + field_key(*columns[i]) + "\"."
+                );
+            }
+        }
+        list.insert_after(list.tail(), node);
+        report.rows++;
+    }
+
+    report.seconds = seconds_since(start);
+    return HeadphonesList::DeserializeResult(std::move(list));
+}
+
+HeadphonesList::DeserializeResult import_json(std::istream& is, ExchangeReport& report)
+{
+    const auto eof_err = "Файл JSON неожиданно обрывается.";
+    auto start = Clock::now();
+    report = ExchangeReport();
+    HeadphonesList list {};
+
+    ChunkedInput input(is);
+    input.read_more();
+    input.skip_bom();
+    if (!skip_json_whitespace(input) || *input.position() != '[')
+    {
+        return HeadphonesList::DeserializeError(
+            input.has_failed() ? io_read_err : "Файл JSON должен содержать массив объектов."
+        );
+    }
+    input.consume(input.position() + 1);
+
+    bool is_first = true;
+    while (true)
+    {
+        if (!skip_json_whitespace(input))
+        {
+            return HeadphonesList::DeserializeError(input.has_failed() ? io_read_err : eof_err);
+        }
+        if (is_first && *input.position() == ']')
+        {
+            break;
+        }
+        is_first = false;
+
+        auto row = std::to_string(report.rows + 1);
+        if (*input.position() != '{')
+        {
+            return HeadphonesList::DeserializeError("Запись " + row + ": ожидался объект JSON.");
+        }
+        const char* object_end = find_json_object_end(input.position(), input.end());
+        while (object_end == input.end())
+        {
+            if (!input.read_more())
+            {
+                return HeadphonesList::DeserializeError(input.has_failed() ? io_read_err : eof_err);
+            }
+            object_end = find_json_object_end(input.position(), input.end());
+        }
+
+        auto node = std::make_shared<HeadphonesList::Node>();
+        if (auto error = parse_json_object(input.position(), object_end, node->value()))
+        {
+            return HeadphonesList::DeserializeError("Запись " + row + ": " + *error + ".");
+        }
+        list.insert_after(list.tail(), node);
+        report.rows++;
+        input.consume(object_end + 1);
+
+        if (!skip_json_whitespace(input))
+        {
+            return HeadphonesList::DeserializeError(input.has_failed() ? io_read_err : eof_err);
+        }
+        if (*input.position() == ']')
+        {
+            break;
+        }
+        if (*input.position() != ',')
+        {
+            return HeadphonesList::DeserializeError("Запись " + row + ": после объекта ожидалась запятая.");
+        }
+        input.consume(input.position() + 1);
+    }
+
+    report.seconds = seconds_since(start);
+    return HeadphonesList::DeserializeResult(std::move(list));
+}
+
+HeadphonesList::SerializeResult export_csv(std::ostream& os, const HeadphonesList& list, ExchangeReport& report)
+{
+    auto start = Clock::now();
+    report = ExchangeReport();
+    BlockWriter writer(os);
+    auto& block = writer.block();
+
+    // Without the mark Excel reads the file in the ANSI code page.
+    block.append(utf8_bom, utf8_bom_size);
+    bool is_first = true;
+    HeadphonesSchema::for_each_field(
+        [&](const auto& field)
+        {
+            if (!is_first)
+            {
+                block += ',';
+            }
+            is_first = false;
+            block += field.key;
+        }
+    );
+    block += "\r\n";
+
+    for (const auto& value : list)
+    {
+        is_first = true;
+        HeadphonesSchema::for_each_field(
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                if (!is_first)
+                {
+                    block += ',';
+                }
+                is_first = false;
+                std::size_t cell_start = block.size();
+                Field::encoding::encode(Field::get(value), block);
+                quote_csv_cell(block, cell_start);
+            }
+        );
+        block += "\r\n";
+        report.rows++;
+        if (!writer.flush_if_full())
+        {
+            return HeadphonesList::SerializeError(io_write_err);
+        }
+    }
+    if (!writer.flush())
+    {
+        return HeadphonesList::SerializeError(io_write_err);
+    }
+
+    report.seconds = seconds_since(start);
+    return std::monostate();
+}
+
+HeadphonesList::SerializeResult export_json(std::ostream& os, const HeadphonesList& list, ExchangeReport& report)
+{
+    auto start = Clock::now();
+    report = ExchangeReport();
+    BlockWriter writer(os);
+    auto& block = writer.block();
+    std::string text;
+
+    block += '[';
+    for (const auto& value : list)
+    {
+        block += report.rows == 0 ? "\n  {" : ",\n  {";
+        bool is_first = true;
+        HeadphonesSchema::for_each_field(
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                using Encoding = typename Field::encoding;
+                const auto& field_value = Field::get(value);
+                if (!is_first)
+                {
+                    block += ", ";
+                }
+                is_first = false;
+                block += '"';
+                block += field.key;
+                block += "\": ";
+
+                if constexpr (std::is_same_v<Encoding, FlagEncoding>)
+                {
+                    block += field_value ? "true" : "false";
+                }
+                else if constexpr (std::is_same_v<Encoding, NumberEncoding>)
+                {
+                    if (std::isfinite(field_value))
+                    {
+                        Encoding::encode(field_value, block);
+                    }
+                    else
+                    {
+                        block += "null";
+                    }
+                }
+                else
+                {
+                    text.clear();
+                    Encoding::encode(field_value, text);
+                    append_json_string(block, text);
+                }
+            }
+        );
+        block += '}';
+        report.rows++;
+        if (!writer.flush_if_full())
+        {
+            return HeadphonesList::SerializeError(io_write_err);
+        }
+    }
+    block += report.rows == 0 ? "]\n" : "\n]\n";
+    if (!writer.flush())
+    {
+        return HeadphonesList::SerializeError(io_write_err);
+    }
+
+    report.seconds = seconds_since(start);
+    return std::monostate();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+// Import and export of price lists in CSV and JSON. Columns and keys are the
+// field keys of HeadphonesSchema; CSV also accepts the Russian labels in the
+// header. CSV is RFC 4180 with a comma or a semicolon as the delimiter. JSON
+// is an array of flat objects, booleans may be given as true/false.
+//
+// Input is read and output written in large blocks, so both directions
+// stream: nothing but the list itself grows with the size of the file.
+class ExchangeReport {
+public:
+    std::uintptr_t rows;
+    double seconds;
+
+    ExchangeReport();
+    double rows_per_second() const;
+};
+
+HeadphonesList::DeserializeResult import_csv(std::istream& is, ExchangeReport& report);
+HeadphonesList::DeserializeResult import_json(std::istream& is, ExchangeReport& report);
+
+HeadphonesList::SerializeResult export_csv(std::ostream& os, const HeadphonesList& list, ExchangeReport& report);
+HeadphonesList::SerializeResult export_json(std::ostream& os, const HeadphonesList& list, ExchangeReport& report);
@@ -0,0 +1,382 @@
+#include "CatalogIndex.hpp"
+#include "Autosave.hpp"
+#include "CatalogMerge.hpp"
+#include "KeyFilter.hpp"
+#include "Utf8.hpp"
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <system_error>
+#include <utility>
+#include <windows.h>
+
+namespace
+{
+    const char index_magic[4] = {'H', 'P', 'I', 'X'};
+    const std::uint32_t index_version = 1;
+
+    class IndexHeader {
+    public:
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t catalog_size;
+        std::int64_t catalog_time;
+        std::uint64_t count;
+        // Where the end mark of the catalog starts.
+        std::uint64_t end_offset;
+    };
+
+    CatalogIndexEntry entry_of(const Headphones& value, std::uint64_t offset)
+    {
+        return CatalogIndexEntry {
+            offset,
+            key_fingerprint(value.get_producer_name(), value.get_model_name()),
+            parse_price(value.get_price()).value_or(std::numeric_limits<double>::quiet_NaN())
+        };
+    }
+
+    HeadphonesList::SerializeResult write_index(
+        const std::string& catalog_filename,
+        const CatalogStamp& stamp,
+        const std::vector<CatalogIndexEntry>& entries,
+        std::uint64_t end_offset
+    )
+    {
+        return write_file_atomically(
+            catalog_index_filename(catalog_filename),
+            [&](std::ostream& os) -> HeadphonesList::SerializeResult
+            {
+                IndexHeader header {};
+                std::memcpy(header.magic, index_magic, sizeof(index_magic));
+                header.version = index_version;
+                header.catalog_size = stamp.size;
+                header.catalog_time = stamp.time;
+                header.count = entries.size();
+                header.end_offset = end_offset;
+
+                os.write((const char*)&header, sizeof(header));
+                os.write((const char*)entries.data(), entries.size() * sizeof(CatalogIndexEntry));
+                if (!os)
+                {
+                    return HeadphonesList::SerializeError("Ошибка ввода-вывода при записи индекса каталога");
+                }
+                return std::monostate();
+            }
+        );
+    }
+}
+
+std::optional<CatalogStamp> catalog_stamp(const std::string& catalog_filename)
+{
+    const auto path = utf8_path(catalog_filename);
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        return std::nullopt;
+    }
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error)
+    {
+        return std::nullopt;
+    }
+    return CatalogStamp {(std::uint64_t)size, (std::int64_t)time.time_since_epoch().count()};
+}
+
+std::string catalog_index_filename(const std::string& catalog_filename)
+{
+    return catalog_filename + ".idx";
+}
+
+HeadphonesList::SerializeResult write_catalog_index(
+    const std::string& catalog_filename,
+    const HeadphonesList::Snapshot& snapshot,
+    const std::vector<std::uint64_t>& offsets
+)
+{
+    auto stamp = catalog_stamp(catalog_filename);
+    if (!stamp || offsets.size() != snapshot.size() + 1)
+    {
+        return HeadphonesList::SerializeError("Не получается построить индекс каталога.");
+    }
+
+    std::vector<CatalogIndexEntry> entries;
+    entries.reserve(snapshot.size());
+    for (std::size_t i = 0; i < snapshot.size(); i++)
+    {
+        entries.push_back(entry_of(snapshot[i]->cvalue(), offsets[i]));
+    }
+    return write_index(catalog_filename, *stamp, entries, offsets.back());
+}
+
+HeadphonesList::SerializeResult rebuild_catalog_index(const std::string& catalog_filename)
+{
+    const auto open_err = "Не получается открыть файл каталога.";
+
+    auto stamp = catalog_stamp(catalog_filename);
+    std::ifstream file(utf8_path(catalog_filename), std::ios::in | std::ios::binary);
+    if (!stamp || !file.is_open())
+    {
+        return HeadphonesList::SerializeError(open_err);
+    }
+
+    std::vector<CatalogIndexEntry> entries;
+    while (true)
+    {
+        auto offset = (std::uint64_t)(std::streamoff)file.tellg();
+        auto result = HeadphonesList::deserialize_record(file);
+        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+        {
+            return HeadphonesList::SerializeError(std::get<HeadphonesList::DeserializeError>(result).message);
+        }
+        auto& node = std::get<HeadphonesList::Node::node_ptr>(result);
+        if (!node)
+        {
+            return write_index(catalog_filename, *stamp, entries, offset);
+        }
+        entries.push_back(entry_of(node->cvalue(), offset));
+    }
+}
+
+CatalogView::CatalogView(
+    std::string filename
+) :
+    m_filename(std::move(filename)),
+    m_catalog(),
+    m_index_file(INVALID_HANDLE_VALUE),
+    m_index_mapping(nullptr),
+    m_index_view(nullptr),
+    m_entries(nullptr),
+    m_count(0),
+    m_filter(std::nullopt)
+{}
+
+CatalogView::~CatalogView()
+{
+    close();
+}
+
+const std::string& CatalogView::filename() const
+{
+    return m_filename;
+}
+
+CatalogView::OpenResult CatalogView::open()
+{
+    const auto open_err = "Не получается открыть файл каталога.";
+    const auto index_err = "Не получается прочитать индекс каталога.";
+
+    close();
+    m_catalog.open(utf8_path(m_filename), std::ios::in | std::ios::binary);
+    if (!m_catalog.is_open())
+    {
+        return HeadphonesList::DeserializeError(open_err);
+    }
+    if (!map_index())
+    {
+        auto result = rebuild_catalog_index(m_filename);
+        if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+        {
+            close();
+            return HeadphonesList::DeserializeError(std::get<HeadphonesList::SerializeError>(result).message);
+        }
+        if (!map_index())
+        {
+            close();
+            return HeadphonesList::DeserializeError(index_err);
+        }
+    }
+    load_filter();
+    return std::monostate();
+}
+
+void CatalogView::close()
+{
+    unmap_index();
+    m_filter.reset();
+    if (m_catalog.is_open())
+    {
+        m_catalog.close();
+    }
+    m_catalog.clear();
+}
+
+void CatalogView::unmap_index()
+{
+    if (m_index_view)
+    {
+        UnmapViewOfFile(m_index_view);
+    }
+    if (m_index_mapping)
+    {
+        CloseHandle(m_index_mapping);
+    }
+    if (m_index_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_index_file);
+    }
+    m_index_file = INVALID_HANDLE_VALUE;
+    m_index_mapping = nullptr;
+    m_index_view = nullptr;
+    m_entries = nullptr;
+    m_count = 0;
+}
+
+std::uint64_t CatalogView::count() const
+{
+    return m_count;
+}
+
+const CatalogIndexEntry& CatalogView::entry(std::uint64_t index) const
+{
+    return m_entries[index];
+}
+
+CatalogView::RecordResult CatalogView::read(std::uint64_t index)
+{
+    const auto range_err = "Нет записи с таким номером.";
+    const auto stale_err = "Файл каталога изменился после построения индекса.";
+
+    if (index >= m_count)
+    {
+        return HeadphonesList::DeserializeError(range_err);
+    }
+
+    m_catalog.clear();
+    m_catalog.seekg((std::streamoff)m_entries[index].offset);
+    auto result = HeadphonesList::deserialize_record(m_catalog);
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+    {
+        return std::get<HeadphonesList::DeserializeError>(result);
+    }
+    auto& node = std::get<HeadphonesList::Node::node_ptr>(result);
+    if (!node || entry_of(node->cvalue(), 0).key != m_entries[index].key)
+    {
+        return HeadphonesList::DeserializeError(stale_err);
+    }
+    return node;
+}
+
+bool CatalogView::may_contain(const std::string& producer, const std::string& model) const
+{
+    return !m_filter || m_filter->may_contain(producer, model);
+}
+
+std::optional<std::uint64_t> CatalogView::find(const std::string& producer, const std::string& model)
+{
+    auto key = key_fingerprint(producer, model);
+    if (m_filter && !m_filter->may_contain(key))
+    {
+        return std::nullopt;
+    }
+    for (std::uint64_t i = 0; i < m_count; i++)
+    {
+        if (m_entries[i].key != key)
+        {
+            continue;
+        }
+        auto result = read(i);
+        if (std::holds_alternative<HeadphonesList::Node::node_ptr>(result))
+        {
+            const auto& value = std::get<HeadphonesList::Node::node_ptr>(result)->cvalue();
+            if (value.get_producer_name() == producer && value.get_model_name() == model)
+            {
+                return i;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<std::uint64_t> CatalogView::find_by_price(double min_price, double max_price) const
+{
+    std::vector<std::uint64_t> found;
+    for (std::uint64_t i = 0; i < m_count; i++)
+    {
+        // NaN fails both comparisons, so records without a price never match.
+        if (m_entries[i].price >= min_price && m_entries[i].price <= max_price)
+        {
+            found.push_back(i);
+        }
+    }
+    return found;
+}
+
+bool CatalogView::map_index()
+{
+    auto stamp = catalog_stamp(m_filename);
+    if (!stamp)
+    {
+        return false;
+    }
+
+    HANDLE file = CreateFileW(
+        utf8_path(catalog_index_filename(m_filename)).wstring().c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    m_index_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || (std::uint64_t)size.QuadPart < sizeof(IndexHeader))
+    {
+        unmap_index();
+        return false;
+    }
+
+    m_index_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_index_mapping)
+    {
+        m_index_view = MapViewOfFile(m_index_mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (!m_index_view)
+    {
+        unmap_index();
+        return false;
+    }
+
+    const auto* header = (const IndexHeader*)m_index_view;
+    std::uint64_t entries_size = (std::uint64_t)size.QuadPart - sizeof(IndexHeader);
+    if (std::memcmp(header->magic, index_magic, sizeof(index_magic)) != 0
+        || header->version != index_version
+        || header->catalog_size != stamp->size
+        || header->catalog_time != stamp->time
+        || header->end_offset >= stamp->size
+        || entries_size / sizeof(CatalogIndexEntry) != header->count
+        || entries_size % sizeof(CatalogIndexEntry) != 0
+    )
+    {
+        unmap_index();
+        return false;
+    }
+
+    m_entries = (const CatalogIndexEntry*)(header + 1);
+    m_count = header->count;
+    return true;
+}
+
+void CatalogView::load_filter()
+{
+    m_filter = read_catalog_filter(m_filename);
+    if (m_filter)
+    {
+        return;
+    }
+
+    // Rebuilt from the key column of the index rather than from the catalog.
+    KeyFilter filter(m_count);
+    for (std::uint64_t i = 0; i < m_count; i++)
+    {
+        filter.insert(m_entries[i].key);
+    }
+    write_catalog_filter(m_filename, filter);
+    m_filter = std::move(filter);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include "KeyFilter.hpp"
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+// A sidecar "<catalog>.idx" next to a catalog file: the byte offset of every
+// record, plus a few key columns, so that a single record can be found and
+// decoded without loading the catalog. The index remembers the size and write
+// time of the catalog it was built for; when they no longer match it is
+// rebuilt from the catalog.
+//
+// Entries are fixed-size and stored in the byte order of the machine, right
+// after a small header, so the file can be mapped and used as an array.
+class CatalogIndexEntry {
+public:
+    std::uint64_t offset;
+    // key_fingerprint of the producer and model.
+    std::uint64_t key;
+    // parse_price of the price, NaN when it has no number in it.
+    double price;
+};
+
+// Size and write time of a catalog file; sidecar files built from the
+// catalog record it and are rebuilt when it no longer matches.
+class CatalogStamp {
+public:
+    std::uint64_t size;
+    std::int64_t time;
+};
+
+std::optional<CatalogStamp> catalog_stamp(const std::string& catalog_filename);
+
+std::string catalog_index_filename(const std::string& catalog_filename);
+
+// offsets are as filled in by HeadphonesList::serialize; call this once the
+// catalog is in place, since the index takes its size and write time.
+HeadphonesList::SerializeResult write_catalog_index(
+    const std::string& catalog_filename,
+    const HeadphonesList::Snapshot& snapshot,
+    const std::vector<std::uint64_t>& offsets
+);
+HeadphonesList::SerializeResult rebuild_catalog_index(const std::string& catalog_filename);
+
+// Read-only access to a catalog file through its index, which is mapped into
+// memory while the view is open.
+class CatalogView {
+public:
+    using OpenResult = std::variant<std::monostate, HeadphonesList::DeserializeError>;
+    using RecordResult = std::variant<HeadphonesList::Node::node_ptr, HeadphonesList::DeserializeError>;
+
+    CatalogView(std::string filename);
+    ~CatalogView();
+
+    CatalogView(const CatalogView& view) = delete;
+    CatalogView& operator=(const CatalogView& view) = delete;
+
+    const std::string& filename() const;
+    // Rebuilds the index first if it is missing or stale.
+    OpenResult open();
+    void close();
+
+    std::uint64_t count() const;
+    const CatalogIndexEntry& entry(std::uint64_t index) const;
+    // Seeks to the record and decodes just that one.
+    RecordResult read(std::uint64_t index);
+
+    // Answered by the key filter alone; false means the key is not there.
+    bool may_contain(const std::string& producer, const std::string& model) const;
+    // Both scan the mapped key columns and only touch the catalog for hits;
+    // find turns away keys the filter rules out without a scan.
+    std::optional<std::uint64_t> find(const std::string& producer, const std::string& model);
+    std::vector<std::uint64_t> find_by_price(double min_price, double max_price) const;
+private:
+    std::string m_filename;
+    std::ifstream m_catalog;
+    void* m_index_file;
+    void* m_index_mapping;
+    const void* m_index_view;
+    const CatalogIndexEntry* m_entries;
+    std::uint64_t m_count;
+    std::optional<KeyFilter> m_filter;
+
+    // Maps the index if it matches the catalog on disk.
+    bool map_index();
+    void unmap_index();
+    // Reads the filter, or builds it from the mapped keys if it is stale.
+    void load_filter();
+};
@@ -0,0 +1,459 @@
+#include "CatalogMerge.hpp"
+#include "HeadphonesSchema.hpp"
+#include "KeyTable.hpp"
+#include "Stopwatch.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <system_error>
+#include <type_traits>
+
+namespace
+{
+    const std::size_t write_block_size = 1 << 20;
+    // Sorting runs shorter than this in parallel costs more than it saves.
+    const std::size_t min_rows_per_sort_run = 1 << 14;
+
+    // MurmurHash64A.
+    std::uint64_t hash_bytes(const char* data, std::size_t size, std::uint64_t seed)
+    {
+        const std::uint64_t m = 0xC6A4A7935BD1E995ull;
+        const int r = 47;
+        std::uint64_t hash = seed ^ (size * m);
+
+        const char* p = data;
+        const char* end = p + (size & ~(std::size_t)7);
+        for (; p != end; p += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, p, 8);
+            word *= m;
+            word ^= word >> r;
+            word *= m;
+            hash ^= word;
+            hash *= m;
+        }
+        if (size & 7)
+        {
+            std::uint64_t tail = 0;
+            std::memcpy(&tail, p, size & 7);
+            hash ^= tail;
+            hash *= m;
+        }
+
+        hash ^= hash >> r;
+        hash *= m;
+        hash ^= hash >> r;
+        return hash;
+    }
+
+    std::uint64_t hash_bytes(const std::string& bytes, std::uint64_t seed)
+    {
+        return hash_bytes(bytes.data(), bytes.size(), seed);
+    }
+
+    // Field values for record_fingerprint. Values that compare equal hash
+    // equal, so zero is taken without its sign and every NaN is the same.
+    std::uint64_t hash_value(double value, std::uint64_t seed)
+    {
+        if (value == 0.0)
+        {
+            value = 0.0;
+        }
+        if (value != value)
+        {
+            value = std::numeric_limits<double>::quiet_NaN();
+        }
+        return hash_bytes((const char*)&value, sizeof(value), seed);
+    }
+
+    template<class T>
+    std::uint64_t hash_value(const T& value, std::uint64_t seed)
+    {
+        if constexpr (std::is_same_v<T, std::string>)
+        {
+            return hash_bytes(value, seed);
+        }
+        else
+        {
+            auto number = (std::uint64_t)value;
+            return hash_bytes((const char*)&number, sizeof(number), seed);
+        }
+    }
+
+    std::uint64_t fingerprint_of(const Headphones& value)
+    {
+        return key_fingerprint(value.get_producer_name(), value.get_model_name());
+    }
+
+    int compare_keys(const Headphones& a, const Headphones& b)
+    {
+        int result = a.get_producer_name().compare(b.get_producer_name());
+        if (result != 0)
+        {
+            return result;
+        }
+        return a.get_model_name().compare(b.get_model_name());
+    }
+
+    // Whether candidate, read after chosen, takes its place.
+    bool replaces(const Headphones& candidate, const Headphones& chosen, MergePolicy policy)
+    {
+        switch (policy)
+        {
+        case MergePolicy::KeepLeft:
+            return false;
+        case MergePolicy::KeepNewest:
+            return true;
+        case MergePolicy::KeepLowestPrice:
+        {
+            const double unknown = std::numeric_limits<double>::infinity();
+            return parse_price(candidate.get_price()).value_or(unknown)
+                < parse_price(chosen.get_price()).value_or(unknown);
+        }
+        default:
+            return false;
+        }
+    }
+}
+
+MergeReport::MergeReport() :
+    rows_read(0),
+    rows_written(0),
+    duplicates(0),
+    seconds(0.0)
+{}
+
+std::uint64_t key_fingerprint(const std::string& producer, const std::string& model)
+{
+    return hash_bytes(model, hash_bytes(producer, 0));
+}
+
+std::uint64_t record_fingerprint(const Headphones& value)
+{
+    std::uint64_t hash = 0;
+    HeadphonesSchema::for_each_field(
+        [&](const auto& field)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            hash = hash_value(Field::get(value), hash);
+        }
+    );
+    return hash;
+}
+
+std::optional<double> parse_price(const std::string& price)
+{
+    std::size_t i = 0;
+    while (i < price.size() && !std::isdigit((unsigned char)price[i]))
+    {
+        i++;
+    }
+
+    // Commas are kept until the whole number is read: they are decimal
+    // commas, unless a point in the number already marks the fraction.
+    char digits[64];
+    std::size_t length = 0;
+    std::size_t points = 0;
+    std::size_t commas = 0;
+    for (; i < price.size(); i++)
+    {
+        char ch = price[i];
+        if (std::isdigit((unsigned char)ch) || ch == ',' || ch == '.')
+        {
+            if (length == sizeof(digits))
+            {
+                return std::nullopt;
+            }
+            digits[length++] = ch;
+            points += ch == '.';
+            commas += ch == ',';
+        }
+        else if (ch == ' ' || ch == '\'')
+        {
+            continue;
+        }
+        else if ((unsigned char)ch == 0xC2 && i + 1 < price.size() && (unsigned char)price[i + 1] == 0xA0)
+        {
+            // No-break space between thousands.
+            i++;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    char separator = points > 0 ? '.' : ',';
+    if ((points > 0 ? points : commas) > 1)
+    {
+        return std::nullopt;
+    }
+
+    // Up to 15 digits fit in a double exactly, and so does a power of ten up
+    // to 1e22, so one division gives the correctly rounded value; this is the
+    // path every real price takes. Longer numbers go through from_chars.
+    static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    std::uint64_t mantissa = 0;
+    std::size_t digit_count = 0;
+    std::size_t fraction_digits = 0;
+    bool is_fraction = false;
+    std::size_t cleaned = 0;
+    for (std::size_t j = 0; j < length; j++)
+    {
+        char ch = digits[j];
+        if (ch == separator)
+        {
+            is_fraction = true;
+            digits[cleaned++] = '.';
+        }
+        else if (ch != ',')
+        {
+            mantissa = mantissa * 10 + (ch - '0');
+            digit_count++;
+            fraction_digits += is_fraction;
+            digits[cleaned++] = ch;
+        }
+    }
+    if (digit_count == 0)
+    {
+        return std::nullopt;
+    }
+    if (digit_count <= 15)
+    {
+        return (double)mantissa / powers_of_ten[fraction_digits];
+    }
+
+    double value;
+    auto result = std::from_chars(digits, digits + cleaned, value);
+    if (result.ec != std::errc() || result.ptr != digits + cleaned)
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+HeadphonesList merge_catalogs(
+    const std::vector<const HeadphonesList*>& inputs,
+    MergePolicy policy,
+    MergeReport& report
+)
+{
+    auto start = Clock::now();
+    report = MergeReport();
+
+    std::size_t total = 0;
+    for (const auto* input : inputs)
+    {
+        total += input->count();
+    }
+    // The surviving node of each key, in the order keys were first seen.
+    std::vector<const HeadphonesList::Node*> chosen;
+    chosen.reserve(total);
+    KeyTable table(total);
+    auto record_of = [&chosen](std::uint32_t entry) -> const Headphones&
+    {
+        return chosen[entry]->cvalue();
+    };
+
+    for (const auto* input : inputs)
+    {
+        for (auto it = input->cbegin(); it != input->cend(); it++)
+        {
+            const HeadphonesList::Node* node = it.node();
+            report.rows_read++;
+
+            auto& slot = table.find(fingerprint_of(node->cvalue()), node->cvalue(), record_of);
+            if (slot.entry == 0)
+            {
+                chosen.push_back(node);
+                slot.entry = (std::uint32_t)chosen.size();
+                continue;
+            }
+
+            report.duplicates++;
+            auto& entry = chosen[slot.entry - 1];
+            if (replaces(node->cvalue(), entry->cvalue(), policy))
+            {
+                entry = node;
+            }
+        }
+    }
+
+    HeadphonesList merged {};
+    for (const auto* node : chosen)
+    {
+        auto copy = std::make_shared<HeadphonesList::Node>();
+        HeadphonesSchema::assign(copy->value(), node->cvalue());
+        merged.insert_after(merged.tail(), copy);
+    }
+    report.rows_written = chosen.size();
+    report.seconds = seconds_since(start);
+    return merged;
+}
+
+HeadphonesList::SerializeResult merge_sorted_catalogs(
+    const std::vector<std::istream*>& inputs,
+    std::ostream& os,
+    MergePolicy policy,
+    MergeReport& report
+)
+{
+    const auto io_err = "Ошибка ввода-вывода при записи файла";
+    auto start = Clock::now();
+    report = MergeReport();
+
+    std::vector<HeadphonesList::Node::node_ptr> current(inputs.size());
+    auto advance = [&](std::size_t input) -> std::optional<HeadphonesList::SerializeError>
+    {
+        auto result = HeadphonesList::deserialize_record(*inputs[input]);
+        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+        {
+            return HeadphonesList::SerializeError(
+                "Каталог " + std::to_string(input + 1) + ": " + std::get<HeadphonesList::DeserializeError>(result).message
+            );
+        }
+        auto next = std::get<HeadphonesList::Node::node_ptr>(result);
+        if (next)
+        {
+            report.rows_read++;
+            if (current[input] && compare_keys(next->cvalue(), current[input]->cvalue()) < 0)
+            {
+                return HeadphonesList::SerializeError(
+                    "Каталог " + std::to_string(input + 1) + " не отсортирован по производителю и модели."
+                );
+            }
+        }
+        current[input] = next;
+        return std::nullopt;
+    };
+
+    // Equal keys leave the heap in input order, so "newest" means the later
+    // input, and within one input the later record.
+    auto comes_after = [&current](std::size_t a, std::size_t b)
+    {
+        int order = compare_keys(current[a]->cvalue(), current[b]->cvalue());
+        return order > 0 || (order == 0 && a > b);
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(comes_after)> heap(comes_after);
+
+    for (std::size_t i = 0; i < inputs.size(); i++)
+    {
+        if (auto error = advance(i))
+        {
+            return *error;
+        }
+        if (current[i])
+        {
+            heap.push(i);
+        }
+    }
+
+    std::string block;
+    block.reserve(write_block_size + 4096);
+    try
+    {
+        while (!heap.empty())
+        {
+            std::size_t input = heap.top();
+            heap.pop();
+            auto chosen = current[input];
+            if (auto error = advance(input))
+            {
+                return *error;
+            }
+            if (current[input])
+            {
+                heap.push(input);
+            }
+
+            while (!heap.empty() && KeyTable::has_same_key(current[heap.top()]->cvalue(), chosen->cvalue()))
+            {
+                input = heap.top();
+                heap.pop();
+                report.duplicates++;
+                if (replaces(current[input]->cvalue(), chosen->cvalue(), policy))
+                {
+                    chosen = current[input];
+                }
+                if (auto error = advance(input))
+                {
+                    return *error;
+                }
+                if (current[input])
+                {
+                    heap.push(input);
+                }
+            }
+
+            HeadphonesList::serialize_record(block, chosen->cvalue());
+            report.rows_written++;
+            if (block.size() >= write_block_size)
+            {
+                if (!os.write(block.data(), block.size()))
+                {
+                    return HeadphonesList::SerializeError(io_err);
+                }
+                block.clear();
+            }
+        }
+
+        block += HeadphonesList::end_symbol;
+        if (!os.write(block.data(), block.size()))
+        {
+            return HeadphonesList::SerializeError(io_err);
+        }
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        return HeadphonesList::SerializeError(io_err);
+    }
+
+    report.seconds = seconds_since(start);
+    return std::monostate();
+}
+
+void sort_by_key(HeadphonesList::Snapshot& snapshot)
+{
+    auto less = [](const auto& a, const auto& b) { return compare_keys(a->cvalue(), b->cvalue()) < 0; };
+    auto& pool = ThreadPool::shared();
+    std::size_t run_count = std::min(pool.thread_count(), snapshot.size() / min_rows_per_sort_run);
+    if (run_count <= 1)
+    {
+        std::stable_sort(snapshot.begin(), snapshot.end(), less);
+        return;
+    }
+
+    // Sorts one run per thread, then merges neighbouring runs in rounds,
+    // which keeps equal keys in their original order.
+    std::vector<std::size_t> bounds(run_count + 1);
+    for (std::size_t i = 0; i <= run_count; i++)
+    {
+        bounds[i] = snapshot.size() * i / run_count;
+    }
+    auto first = snapshot.begin();
+    pool.parallel_for(0, run_count, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (auto run = begin; run < end; run++)
+        {
+            std::stable_sort(first + bounds[run], first + bounds[run + 1], less);
+        }
+    });
+    for (std::size_t width = 1; width < run_count; width *= 2)
+    {
+        pool.parallel_for(0, (run_count + 2 * width - 1) / (2 * width), 1, [&](std::size_t begin, std::size_t end)
+        {
+            for (auto pair = begin; pair < end; pair++)
+            {
+                auto left = pair * 2 * width;
+                auto middle = std::min(left + width, run_count);
+                auto right = std::min(left + 2 * width, run_count);
+                std::inplace_merge(first + bounds[left], first + bounds[middle], first + bounds[right], less);
+            }
+        });
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Which of two records with the same (producer, model) survives a merge.
+// Inputs are taken to be ordered from oldest to newest.
+enum class MergePolicy {
+    KeepLeft,
+    KeepNewest,
+    KeepLowestPrice
+};
+
+class MergeReport {
+public:
+    std::uintptr_t rows_read;
+    std::uintptr_t rows_written;
+    std::uintptr_t duplicates;
+    double seconds;
+
+    MergeReport();
+};
+
+// 64-bit fingerprint of (producer, model), the key records are merged on.
+std::uint64_t key_fingerprint(const std::string& producer, const std::string& model);
+
+// 64-bit fingerprint of every field of a record; records that compare equal
+// field by field have the same one.
+std::uint64_t record_fingerprint(const Headphones& value);
+
+// Reads a price such as "1 299,90 руб." as a number.
+std::optional<double> parse_price(const std::string& price);
+
+// Deduplicates records of all inputs by a 64-bit fingerprint of (producer,
+// model) in one linear pass. The result keeps the order in which keys were
+// first seen and holds copies, so the inputs are left untouched.
+HeadphonesList merge_catalogs(
+    const std::vector<const HeadphonesList*>& inputs,
+    MergePolicy policy,
+    MergeReport& report
+);
+
+// k-way merge of serialized catalogs that are each sorted by (producer,
+// model). Only one record per input is held in memory at a time.
+HeadphonesList::SerializeResult merge_sorted_catalogs(
+    const std::vector<std::istream*>& inputs,
+    std::ostream& os,
+    MergePolicy policy,
+    MergeReport& report
+);
+
+// Orders a snapshot by (producer, model), as merge_sorted_catalogs expects.
+void sort_by_key(HeadphonesList::Snapshot& snapshot);
@@ -0,0 +1,218 @@
+#include "CatalogProtocol.hpp"
+#include "HeadphonesSchema.hpp"
+#include "Utf8.hpp"
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <winsock2.h>
+
+void append_frame(std::string& out, const std::string& payload)
+{
+    std::uint32_t length = (std::uint32_t)payload.size();
+    for (int i = 0; i < 4; i++)
+    {
+        out += (char)((length >> (8 * i)) & 0xFF);
+    }
+    out += payload;
+}
+
+std::size_t extract_frame(const char* data, std::size_t size, std::string& payload)
+{
+    if (size < 4)
+    {
+        return 0;
+    }
+
+    std::uint32_t length = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        length |= (std::uint32_t)(unsigned char)data[i] << (8 * i);
+    }
+    if (length > max_catalog_frame_size)
+    {
+        return SIZE_MAX;
+    }
+    if (size - 4 < length)
+    {
+        return 0;
+    }
+
+    payload.assign(data + 4, length);
+    return 4 + (std::size_t)length;
+}
+
+PayloadWriter::PayloadWriter() :
+    m_bytes()
+{}
+
+void PayloadWriter::put_u8(std::uint8_t value)
+{
+    m_bytes += (char)value;
+}
+
+void PayloadWriter::put_u64(std::uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        m_bytes += (char)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void PayloadWriter::put_string(const std::string& value)
+{
+    put_u64(value.size());
+    m_bytes += value;
+}
+
+void PayloadWriter::put_record(const Headphones& value)
+{
+    HeadphonesSchema::for_each_field(
+        [&](const auto& field)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            put_value(Field::get(value));
+        }
+    );
+}
+
+const std::string& PayloadWriter::bytes() const
+{
+    return m_bytes;
+}
+
+void PayloadWriter::put_value(const std::string& value)
+{
+    put_string(value);
+}
+
+void PayloadWriter::put_value(double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put_u64(bits);
+}
+
+void PayloadWriter::put_value(bool value)
+{
+    put_u8(value);
+}
+
+void PayloadWriter::put_value(EqualizerMode value)
+{
+    put_u8((std::uint8_t)value);
+}
+
+PayloadReader::PayloadReader(
+    const std::string& bytes
+) :
+    m_bytes(bytes),
+    m_offset(0)
+{}
+
+bool PayloadReader::get_u8(std::uint8_t& value)
+{
+    if (m_bytes.size() - m_offset < 1)
+    {
+        return false;
+    }
+    value = (std::uint8_t)m_bytes[m_offset++];
+    return true;
+}
+
+bool PayloadReader::get_u64(std::uint64_t& value)
+{
+    if (m_bytes.size() - m_offset < 8)
+    {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= (std::uint64_t)(unsigned char)m_bytes[m_offset++] << (8 * i);
+    }
+    return true;
+}
+
+bool PayloadReader::get_string(std::string& value)
+{
+    std::uint64_t length;
+    if (!get_u64(length) || m_bytes.size() - m_offset < length)
+    {
+        return false;
+    }
+    if (!is_valid_utf8(m_bytes.data() + m_offset, (std::size_t)length))
+    {
+        return false;
+    }
+    value.assign(m_bytes, m_offset, (std::size_t)length);
+    m_offset += (std::size_t)length;
+    return true;
+}
+
+bool PayloadReader::get_record(HeadphonesList::Node::node_ptr& node)
+{
+    auto record = std::make_shared<HeadphonesList::Node>();
+    auto& value = record->value();
+    bool is_read = HeadphonesSchema::all_fields(
+        [&](const auto& field)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            return get_value(Field::get(value));
+        }
+    );
+    if (!is_read)
+    {
+        return false;
+    }
+    node = std::move(record);
+    return true;
+}
+
+bool PayloadReader::is_at_end() const
+{
+    return m_offset == m_bytes.size();
+}
+
+bool PayloadReader::get_value(std::string& value)
+{
+    return get_string(value);
+}
+
+bool PayloadReader::get_value(double& value)
+{
+    std::uint64_t bits;
+    if (!get_u64(bits))
+    {
+        return false;
+    }
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+bool PayloadReader::get_value(bool& value)
+{
+    std::uint8_t byte;
+    if (!get_u8(byte))
+    {
+        return false;
+    }
+    value = byte != 0;
+    return true;
+}
+
+bool PayloadReader::get_value(EqualizerMode& value)
+{
+    std::uint8_t byte;
+    if (!get_u8(byte) || byte > (std::uint8_t)EqualizerMode::Vocal)
+    {
+        return false;
+    }
+    value = (EqualizerMode)byte;
+    return true;
+}
+
+bool startup_sockets()
+{
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+}
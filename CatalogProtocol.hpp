@@ -0,0 +1,75 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Every message is a frame: a little-endian u32 payload length followed by
+// the payload. A request payload starts with an opcode byte, a response
+// payload starts with a status byte. Several frames may be pipelined on one
+// connection; responses come back in request order.
+enum class CatalogOpcode : std::uint8_t {
+    Count = 'c',
+    Get = 'g',
+    Index = 'x',
+    Query = 'q',
+    Insert = 'i',
+    Update = 'u',
+    Remove = 'r',
+    Save = 's'
+};
+
+enum class CatalogStatus : std::uint8_t {
+    Ok = 0,
+    Error = 1
+};
+
+const char* const catalog_socket_path = "headphones.sock";
+const std::size_t max_catalog_frame_size = 16 * 1024 * 1024;
+
+void append_frame(std::string& out, const std::string& payload);
+// Returns the size of the frame at the front of data, or 0 if it is not
+// complete yet. Frames larger than max_catalog_frame_size yield SIZE_MAX.
+std::size_t extract_frame(const char* data, std::size_t size, std::string& payload);
+
+class PayloadWriter {
+public:
+    PayloadWriter();
+
+    void put_u8(std::uint8_t value);
+    void put_u64(std::uint64_t value);
+    void put_string(const std::string& value);
+    void put_record(const Headphones& value);
+
+    const std::string& bytes() const;
+private:
+    std::string m_bytes;
+
+    // One per field type of HeadphonesSchema.
+    void put_value(const std::string& value);
+    void put_value(double value);
+    void put_value(bool value);
+    void put_value(EqualizerMode value);
+};
+
+class PayloadReader {
+public:
+    PayloadReader(const std::string& bytes);
+
+    bool get_u8(std::uint8_t& value);
+    bool get_u64(std::uint64_t& value);
+    bool get_string(std::string& value);
+    bool get_record(HeadphonesList::Node::node_ptr& node);
+    bool is_at_end() const;
+private:
+    const std::string& m_bytes;
+    std::size_t m_offset;
+
+    // One per field type of HeadphonesSchema.
+    bool get_value(std::string& value);
+    bool get_value(double& value);
+    bool get_value(bool& value);
+    bool get_value(EqualizerMode& value);
+};
+
+bool startup_sockets();
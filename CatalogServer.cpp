@@ -0,0 +1,479 @@
+#include "CatalogServer.hpp"
+#include "CatalogProtocol.hpp"
+#include "Autosave.hpp"
+#include "KeyFilter.hpp"
+#include "PipelinedLoader.hpp"
+#include <afunix.h>
+#include <ws2tcpip.h>
+
+namespace
+{
+    std::string error_response(const std::string& message)
+    {
+        PayloadWriter writer;
+        writer.put_u8((std::uint8_t)CatalogStatus::Error);
+        writer.put_string(message);
+        return writer.bytes();
+    }
+
+    bool set_non_blocking(SOCKET socket)
+    {
+        u_long mode = 1;
+        return ioctlsocket(socket, FIONBIO, &mode) == 0;
+    }
+}
+
+CatalogServer::CatalogServer(
+    std::string filename
+) :
+    m_filename(filename),
+    m_list(),
+    m_positions(),
+    m_filter(),
+    m_listeners(),
+    m_connections(),
+    m_is_stopping(false)
+{}
+
+CatalogServer::~CatalogServer()
+{
+    for (auto& connection : m_connections)
+    {
+        closesocket(connection.socket);
+    }
+    for (auto listener : m_listeners)
+    {
+        closesocket(listener);
+    }
+}
+
+HeadphonesList::DeserializeResult CatalogServer::load()
+{
+    PipelinedLoader loader(m_filename);
+    if (!loader.is_open())
+    {
+        return HeadphonesList::DeserializeError("Не получается открыть файл каталога.");
+    }
+
+    auto result = loader.load();
+    if (std::holds_alternative<HeadphonesList>(result))
+    {
+        m_list = std::move(std::get<HeadphonesList>(result));
+        auto nodes = m_list.snapshot();
+        m_positions.assign(nodes);
+        m_filter = KeyFilter::build(nodes);
+    }
+    return result;
+}
+
+bool CatalogServer::listen_unix(const std::string& path)
+{
+    sockaddr_un address {};
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, path.size());
+
+    SOCKET listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET)
+    {
+        return false;
+    }
+    DeleteFileA(path.c_str());
+    if (bind(listener, (const sockaddr*)&address, sizeof(address)) == SOCKET_ERROR
+        || listen(listener, SOMAXCONN) == SOCKET_ERROR
+        || !set_non_blocking(listener))
+    {
+        closesocket(listener);
+        return false;
+    }
+
+    add_listener(listener);
+    return true;
+}
+
+bool CatalogServer::listen_tcp(std::uint16_t port)
+{
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET)
+    {
+        return false;
+    }
+    BOOL reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    if (bind(listener, (const sockaddr*)&address, sizeof(address)) == SOCKET_ERROR
+        || listen(listener, SOMAXCONN) == SOCKET_ERROR
+        || !set_non_blocking(listener))
+    {
+        closesocket(listener);
+        return false;
+    }
+
+    add_listener(listener);
+    return true;
+}
+
+bool CatalogServer::run()
+{
+    const int poll_timeout_ms = 100;
+    std::vector<WSAPOLLFD> fds;
+
+    while (!m_is_stopping)
+    {
+        fds.clear();
+        for (auto listener : m_listeners)
+        {
+            fds.push_back({listener, POLLRDNORM, 0});
+        }
+        for (const auto& connection : m_connections)
+        {
+            short events = POLLRDNORM;
+            if (connection.output_offset < connection.output.size())
+            {
+                events |= POLLWRNORM;
+            }
+            fds.push_back({connection.socket, events, 0});
+        }
+
+        int ready = WSAPoll(fds.data(), (u_long)fds.size(), poll_timeout_ms);
+        if (ready == SOCKET_ERROR)
+        {
+            return false;
+        }
+        if (ready == 0)
+        {
+            continue;
+        }
+
+        std::size_t connection_count = m_connections.size();
+        for (std::size_t i = 0; i < connection_count; i++)
+        {
+            auto& connection = m_connections[i];
+            short revents = fds[m_listeners.size() + i].revents;
+            if (revents & (POLLRDNORM | POLLHUP))
+            {
+                read_connection(connection);
+            }
+            if (revents & (POLLERR | POLLNVAL))
+            {
+                connection.is_closing = true;
+            }
+            if (!connection.is_closing && connection.output_offset < connection.output.size())
+            {
+                write_connection(connection);
+            }
+        }
+
+        for (std::size_t i = 0; i < m_listeners.size(); i++)
+        {
+            if (fds[i].revents & POLLRDNORM)
+            {
+                accept_connections(m_listeners[i]);
+            }
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < m_connections.size(); i++)
+        {
+            if (m_connections[i].is_closing)
+            {
+                closesocket(m_connections[i].socket);
+                continue;
+            }
+            if (kept != i)
+            {
+                m_connections[kept] = std::move(m_connections[i]);
+            }
+            kept++;
+        }
+        m_connections.resize(kept);
+    }
+    return true;
+}
+
+void CatalogServer::stop()
+{
+    m_is_stopping = true;
+}
+
+void CatalogServer::add_listener(SOCKET listener)
+{
+    m_listeners.push_back(listener);
+}
+
+void CatalogServer::accept_connections(SOCKET listener)
+{
+    while (true)
+    {
+        SOCKET socket = accept(listener, nullptr, nullptr);
+        if (socket == INVALID_SOCKET)
+        {
+            return;
+        }
+        if (!set_non_blocking(socket))
+        {
+            closesocket(socket);
+            continue;
+        }
+        BOOL no_delay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+
+        Connection connection {};
+        connection.socket = socket;
+        connection.output_offset = 0;
+        connection.is_closing = false;
+        m_connections.push_back(std::move(connection));
+    }
+}
+
+void CatalogServer::read_connection(Connection& connection)
+{
+    char buffer[64 * 1024];
+    while (true)
+    {
+        int received = recv(connection.socket, buffer, sizeof(buffer), 0);
+        if (received > 0)
+        {
+            connection.input.append(buffer, received);
+            continue;
+        }
+        if (received == 0 || WSAGetLastError() != WSAEWOULDBLOCK)
+        {
+            connection.is_closing = true;
+        }
+        break;
+    }
+
+    // All requests that arrived together are answered with a single send.
+    std::size_t offset = 0;
+    std::string request;
+    while (true)
+    {
+        std::size_t frame_size = extract_frame(
+            connection.input.data() + offset,
+            connection.input.size() - offset,
+            request
+        );
+        if (frame_size == SIZE_MAX)
+        {
+            connection.is_closing = true;
+            break;
+        }
+        if (frame_size == 0)
+        {
+            break;
+        }
+        offset += frame_size;
+        append_frame(connection.output, handle_request(request));
+    }
+    connection.input.erase(0, offset);
+}
+
+void CatalogServer::write_connection(Connection& connection)
+{
+    while (connection.output_offset < connection.output.size())
+    {
+        int sent = send(
+            connection.socket,
+            connection.output.data() + connection.output_offset,
+            (int)(connection.output.size() - connection.output_offset),
+            0
+        );
+        if (sent == SOCKET_ERROR)
+        {
+            if (WSAGetLastError() != WSAEWOULDBLOCK)
+            {
+                connection.is_closing = true;
+            }
+            return;
+        }
+        connection.output_offset += sent;
+    }
+    connection.output.clear();
+    connection.output_offset = 0;
+}
+
+std::string CatalogServer::handle_request(const std::string& request)
+{
+    const auto ill_err = "Некорректный запрос.";
+    const auto index_err = "Индекс превышает количество записей.";
+    const auto missing_err = "Запись не найдена.";
+
+    PayloadReader reader(request);
+    PayloadWriter writer;
+    writer.put_u8((std::uint8_t)CatalogStatus::Ok);
+
+    std::uint8_t opcode;
+    if (!reader.get_u8(opcode))
+    {
+        return error_response(ill_err);
+    }
+
+    std::uint64_t index;
+    HeadphonesList::Node::node_ptr node;
+    switch ((CatalogOpcode)opcode)
+    {
+    case CatalogOpcode::Count:
+        if (!reader.is_at_end())
+        {
+            return error_response(ill_err);
+        }
+        writer.put_u64(m_list.count());
+        return writer.bytes();
+    case CatalogOpcode::Get:
+    {
+        if (!reader.get_u64(index) || !reader.is_at_end())
+        {
+            return error_response(ill_err);
+        }
+        auto it = node_at(index);
+        if (!*it)
+        {
+            return error_response(index_err);
+        }
+        writer.put_record((*it)->cvalue());
+        return writer.bytes();
+    }
+    case CatalogOpcode::Index:
+    {
+        std::string producer_name;
+        std::string model_name;
+        if (!reader.get_string(producer_name) || !reader.get_string(model_name) || !reader.is_at_end())
+        {
+            return error_response(ill_err);
+        }
+        if (!m_filter.may_contain(producer_name, model_name))
+        {
+            return error_response(missing_err);
+        }
+        auto position = m_positions.find(producer_name, model_name);
+        if (!position)
+        {
+            return error_response(missing_err);
+        }
+        writer.put_u64(*position);
+        return writer.bytes();
+    }
+    case CatalogOpcode::Query:
+    {
+        std::string producer_name;
+        std::string model_part;
+        std::uint64_t limit;
+        if (!reader.get_string(producer_name)
+            || !reader.get_string(model_part)
+            || !reader.get_u64(limit)
+            || !reader.is_at_end())
+        {
+            return error_response(ill_err);
+        }
+        PayloadWriter matches;
+        std::uint64_t match_count = 0;
+        std::uint64_t i = 0;
+        for (auto it = m_list.cbegin(); it != m_list.cend() && match_count < limit; ++it, ++i)
+        {
+            const auto& value = *it;
+            if ((producer_name.empty() || value.get_producer_name() == producer_name)
+                && value.get_model_name().find(model_part) != std::string::npos)
+            {
+                matches.put_u64(i);
+                matches.put_record(value);
+                match_count++;
+            }
+        }
+        writer.put_u64(match_count);
+        return writer.bytes() + matches.bytes();
+    }
+    case CatalogOpcode::Insert:
+        if (!reader.get_u64(index) || !reader.get_record(node) || !reader.is_at_end())
+        {
+            return error_response(ill_err);
+        }
+        if (index > m_list.count())
+        {
+            return error_response(index_err);
+        }
+        if (index == m_list.count())
+        {
+            m_list.insert_after(m_list.tail(), node);
+        }
+        else
+        {
+            m_list.insert_before(node_at(index), node);
+        }
+        m_positions.insert(index, node);
+        add_key(node->cvalue());
+        writer.put_u64(index);
+        return writer.bytes();
+    case CatalogOpcode::Update:
+    {
+        if (!reader.get_u64(index) || !reader.get_record(node) || !reader.is_at_end())
+        {
+            return error_response(ill_err);
+        }
+        auto it = node_at(index);
+        if (!*it)
+        {
+            return error_response(index_err);
+        }
+        m_list.insert_after(it, node);
+        m_list.remove(it);
+        m_positions.set(index, node);
+        add_key(node->cvalue());
+        return writer.bytes();
+    }
+    case CatalogOpcode::Remove:
+    {
+        if (!reader.get_u64(index) || !reader.is_at_end())
+        {
+            return error_response(ill_err);
+        }
+        auto it = node_at(index);
+        if (!*it)
+        {
+            return error_response(index_err);
+        }
+        m_list.remove(it);
+        m_positions.erase(index);
+        return writer.bytes();
+    }
+    case CatalogOpcode::Save:
+    {
+        if (!reader.is_at_end())
+        {
+            return error_response(ill_err);
+        }
+        auto result = save_snapshot_atomically(m_positions.snapshot(), m_filename);
+        if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+        {
+            return error_response(std::get<HeadphonesList::SerializeError>(result).message);
+        }
+        return writer.bytes();
+    }
+    default:
+        return error_response(ill_err);
+    }
+}
+
+HeadphonesList::Iterator CatalogServer::node_at(std::uint64_t index)
+{
+    return HeadphonesList::Iterator(std::const_pointer_cast<HeadphonesList::Node>(m_positions.at(index)));
+}
+
+void CatalogServer::add_key(const Headphones& value)
+{
+    // Past twice its capacity the filter lets through too many misses; it
+    // is sized afresh, which also drops the bits of removed records.
+    if (m_filter.key_count() >= 2 * m_filter.capacity())
+    {
+        m_filter = KeyFilter::build(m_positions.snapshot());
+        return;
+    }
+    m_filter.insert(value);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include "KeyFilter.hpp"
+#include "PositionIndex.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <winsock2.h>
+
+// Owns one catalog and serves it to other local processes over a Unix domain
+// socket and optionally loopback TCP, using a single-threaded non-blocking
+// poll loop. See CatalogProtocol.hpp for the wire format.
+class CatalogServer {
+public:
+    CatalogServer(std::string filename);
+    ~CatalogServer();
+
+    CatalogServer(const CatalogServer& server) = delete;
+    CatalogServer& operator=(const CatalogServer& server) = delete;
+
+    HeadphonesList::DeserializeResult load();
+    bool listen_unix(const std::string& path);
+    bool listen_tcp(std::uint16_t port);
+    // Returns false if polling the sockets fails; WSAGetLastError says why.
+    bool run();
+    void stop();
+private:
+    class Connection {
+    public:
+        SOCKET socket;
+        std::string input;
+        std::string output;
+        std::size_t output_offset;
+        bool is_closing;
+    };
+
+    std::string m_filename;
+    HeadphonesList m_list;
+    // The nodes of m_list by position and by key.
+    PositionIndex m_positions;
+    // Answers most lookups of keys that are not in the catalog.
+    KeyFilter m_filter;
+    std::vector<SOCKET> m_listeners;
+    std::vector<Connection> m_connections;
+    std::atomic<bool> m_is_stopping;
+
+    void add_listener(SOCKET listener);
+    void accept_connections(SOCKET listener);
+    void read_connection(Connection& connection);
+    void write_connection(Connection& connection);
+    std::string handle_request(const std::string& request);
+    HeadphonesList::Iterator node_at(std::uint64_t index);
+    void add_key(const Headphones& value);
+};
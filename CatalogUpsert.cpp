@@ -0,0 +1,115 @@
+#include "CatalogUpsert.hpp"
+#include "CatalogMerge.hpp"
+#include "HeadphonesSchema.hpp"
+#include "KeyTable.hpp"
+#include "Stopwatch.hpp"
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    std::uint64_t key_of(const Headphones& value)
+    {
+        return key_fingerprint(value.get_producer_name(), value.get_model_name());
+    }
+
+    // The last row of the feed with a key, and whether the list has it.
+    class FeedEntry {
+    public:
+        const HeadphonesList::Node* row;
+        bool is_matched;
+    };
+}
+
+UpsertReport::UpsertReport() :
+    rows(0),
+    updated(0),
+    unchanged(0),
+    inserted(0),
+    duplicates(0),
+    seconds(0.0)
+{}
+
+UpsertReport upsert_prices(HeadphonesList& list, HeadphonesList&& feed)
+{
+    auto start = Clock::now();
+    UpsertReport report;
+    if (feed.is_empty())
+    {
+        return report;
+    }
+
+    std::vector<FeedEntry> entries;
+    entries.reserve(feed.count());
+    KeyTable table(feed.count());
+    auto find = [&](const Headphones& value) -> KeyTable::Slot&
+    {
+        return table.find(
+            key_of(value),
+            value,
+            [&entries](std::uint32_t entry) -> const Headphones&
+            {
+                return entries[entry].row->cvalue();
+            }
+        );
+    };
+
+    for (auto it = feed.cbegin(); it != feed.cend(); ++it)
+    {
+        auto& slot = find(*it);
+        if (slot.entry == 0)
+        {
+            entries.push_back(FeedEntry {it.node(), false});
+            slot.entry = (std::uint32_t)entries.size();
+        }
+        else
+        {
+            entries[slot.entry - 1].row = it.node();
+            report.duplicates++;
+        }
+        report.rows++;
+    }
+
+    for (auto it = list.head(); *it; ++it)
+    {
+        const auto& value = (*it)->cvalue();
+        auto& slot = find(value);
+        if (slot.entry == 0)
+        {
+            continue;
+        }
+        auto& entry = entries[slot.entry - 1];
+        entry.is_matched = true;
+        const auto& price = entry.row->cvalue().get_price();
+        if (value.get_price() == price)
+        {
+            report.unchanged++;
+            continue;
+        }
+
+        // Snapshots may share the node, so it is replaced by a copy with the
+        // new price rather than changed.
+        auto copy = std::make_shared<HeadphonesList::Node>();
+        HeadphonesSchema::assign(copy->value(), value);
+        copy->value().set_price(price);
+        auto replaced = it;
+        it = list.insert_after(it, std::move(copy));
+        list.remove(replaced);
+        report.updated++;
+    }
+
+    // What is left of the feed are the last rows of keys the list lacks.
+    feed.erase_if(
+        [&](const HeadphonesList::Node* node)
+        {
+            const auto& entry = entries[find(node->cvalue()).entry - 1];
+            return entry.row != node || entry.is_matched;
+        }
+    );
+    report.inserted = feed.count();
+    list.splice(HeadphonesList::Iterator(nullptr), feed);
+
+    report.seconds = seconds_since(start);
+    return report;
+}
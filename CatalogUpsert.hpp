@@ -0,0 +1,30 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstdint>
+
+class UpsertReport {
+public:
+    std::uintptr_t rows;
+    // Records of the list whose price changed, and those that already had it.
+    std::uintptr_t updated;
+    std::uintptr_t unchanged;
+    std::uintptr_t inserted;
+    // Rows of the feed overridden by a later row with the same key.
+    std::uintptr_t duplicates;
+    double seconds;
+
+    UpsertReport();
+};
+
+// Applies a price feed, such as one read by import_csv, to list. Records are
+// keyed on (producer, model); when the feed names a key more than once, the
+// last row wins. Every record of the list with a key from the feed and a
+// different price is replaced by a copy with the feed's price, since
+// snapshots may share its node; rows with keys the list does not have are
+// moved to its tail in feed order, with whatever other fields the feed gave
+// them.
+//
+// The hash table is built over the feed rather than the list, so memory
+// grows with the feed only, and the list is walked once whether the feed is
+// sorted or not. feed is left empty.
+UpsertReport upsert_prices(HeadphonesList& list, HeadphonesList&& feed);
@@ -0,0 +1,229 @@
+#include "CatalogWorkspace.hpp"
+#include "CatalogMerge.hpp"
+#include "HeadphonesSchema.hpp"
+#include "PipelinedLoader.hpp"
+#include "Stopwatch.hpp"
+#include "ThreadPool.hpp"
+#include "Utf8.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <system_error>
+#include <utility>
+#include <variant>
+
+namespace
+{
+    // Runs task(0) .. task(task_count - 1) on the shared pool. The calling
+    // thread starts on task 0, while idle threads steal from the other end.
+    template <class Task>
+    void run_tasks(std::size_t task_count, Task task)
+    {
+        ThreadPool::shared().parallel_for(0, task_count, 1, [&](std::size_t first, std::size_t last)
+        {
+            for (auto i = first; i < last; i++)
+            {
+                task(i);
+            }
+        });
+    }
+
+    // Matches of every catalog, found in parallel and joined in catalog order.
+    template <class Predicate>
+    std::vector<WorkspaceMatch> collect_matches(
+        const std::vector<WorkspaceCatalog>& catalogs,
+        Predicate predicate,
+        std::size_t limit
+    )
+    {
+        std::vector<std::vector<WorkspaceMatch>> partials(catalogs.size());
+        run_tasks(catalogs.size(), [&](std::size_t index)
+        {
+            std::uintptr_t position = 0;
+            for (auto it = catalogs[index].list.cbegin(); it != catalogs[index].list.cend(); ++it, ++position)
+            {
+                if (partials[index].size() >= limit)
+                {
+                    break;
+                }
+                if (predicate(*it))
+                {
+                    WorkspaceMatch match { index, position, Headphones() };
+                    HeadphonesSchema::assign(match.record, *it);
+                    partials[index].push_back(std::move(match));
+                }
+            }
+        });
+
+        std::vector<WorkspaceMatch> matches;
+        for (auto& partial : partials)
+        {
+            for (auto& match : partial)
+            {
+                if (matches.size() >= limit)
+                {
+                    return matches;
+                }
+                matches.push_back(std::move(match));
+            }
+        }
+        return matches;
+    }
+}
+
+WorkspaceLoadReport::WorkspaceLoadReport() :
+    loaded(0),
+    records(0),
+    errors(),
+    seconds(0.0),
+    longest_seconds(0.0)
+{}
+
+CatalogWorkspace::CatalogWorkspace() :
+    m_catalogs()
+{}
+
+WorkspaceLoadReport CatalogWorkspace::load(const std::vector<std::string>& filenames)
+{
+    auto start = Clock::now();
+
+    std::vector<std::uint64_t> file_bytes(filenames.size(), 0);
+    for (std::size_t i = 0; i < filenames.size(); i++)
+    {
+        std::error_code error;
+        auto size = std::filesystem::file_size(utf8_path(filenames[i]), error);
+        file_bytes[i] = error ? 0 : size;
+    }
+
+    // Largest first, so that no large file is left to start last.
+    std::vector<std::size_t> order(filenames.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+    {
+        return file_bytes[a] > file_bytes[b];
+    });
+
+    std::vector<HeadphonesList::DeserializeResult> results(filenames.size());
+    std::vector<double> load_seconds(filenames.size(), 0.0);
+    run_tasks(order.size(), [&](std::size_t task)
+    {
+        auto index = order[task];
+        auto file_start = Clock::now();
+        PipelinedLoader loader(filenames[index]);
+        results[index] = loader.load();
+        load_seconds[index] = seconds_since(file_start);
+    });
+
+    WorkspaceLoadReport report;
+    for (std::size_t i = 0; i < filenames.size(); i++)
+    {
+        report.longest_seconds = std::max(report.longest_seconds, load_seconds[i]);
+        if (std::holds_alternative<HeadphonesList::DeserializeError>(results[i]))
+        {
+            report.errors.push_back({
+                filenames[i],
+                std::get<HeadphonesList::DeserializeError>(results[i]).message
+            });
+            continue;
+        }
+
+        auto& list = std::get<HeadphonesList>(results[i]);
+        report.loaded++;
+        report.records += list.count();
+        auto existing = std::find_if(m_catalogs.begin(), m_catalogs.end(), [&](const WorkspaceCatalog& catalog)
+        {
+            return catalog.filename == filenames[i];
+        });
+        if (existing == m_catalogs.end())
+        {
+            m_catalogs.push_back({ filenames[i], std::move(list), file_bytes[i], load_seconds[i] });
+            continue;
+        }
+        existing->list = std::move(list);
+        existing->file_bytes = file_bytes[i];
+        existing->load_seconds = load_seconds[i];
+    }
+    report.seconds = seconds_since(start);
+    return report;
+}
+
+void CatalogWorkspace::clear()
+{
+    m_catalogs.clear();
+}
+
+std::size_t CatalogWorkspace::size() const
+{
+    return m_catalogs.size();
+}
+
+const WorkspaceCatalog& CatalogWorkspace::catalog(std::size_t index) const
+{
+    return m_catalogs[index];
+}
+
+std::uintptr_t CatalogWorkspace::count() const
+{
+    std::uintptr_t count = 0;
+    for (const auto& catalog : m_catalogs)
+    {
+        count += catalog.list.count();
+    }
+    return count;
+}
+
+std::vector<WorkspaceMatch> CatalogWorkspace::find(const std::string& producer, const std::string& model) const
+{
+    return collect_matches(m_catalogs, [&](const Headphones& value)
+    {
+        return value.get_producer_name() == producer && value.get_model_name() == model;
+    }, std::numeric_limits<std::size_t>::max());
+}
+
+std::vector<WorkspaceMatch> CatalogWorkspace::find_by_price(double min_price, double max_price, std::size_t limit) const
+{
+    return collect_matches(m_catalogs, [&](const Headphones& value)
+    {
+        auto price = parse_price(value.get_price());
+        return price && *price >= min_price && *price <= max_price;
+    }, limit);
+}
+
+AggregateReport CatalogWorkspace::aggregate(GroupKey group_key, std::size_t top_count) const
+{
+    auto start = Clock::now();
+
+    // Positions run on across catalogs, so ties go to the earlier catalog.
+    std::vector<std::uint64_t> first_positions(m_catalogs.size(), 0);
+    for (std::size_t i = 1; i < m_catalogs.size(); i++)
+    {
+        first_positions[i] = first_positions[i - 1] + m_catalogs[i - 1].list.count();
+    }
+
+    std::vector<CatalogAggregator> partials;
+    partials.reserve(std::max<std::size_t>(1, m_catalogs.size()));
+    for (std::size_t i = 0; i < std::max<std::size_t>(1, m_catalogs.size()); i++)
+    {
+        partials.emplace_back(group_key, top_count);
+    }
+    run_tasks(m_catalogs.size(), [&](std::size_t index)
+    {
+        auto position = first_positions[index];
+        for (auto it = m_catalogs[index].list.cbegin(); it != m_catalogs[index].list.cend(); ++it)
+        {
+            partials[index].add(*it, position++);
+        }
+    });
+    for (std::size_t i = 1; i < partials.size(); i++)
+    {
+        partials[0].merge(partials[i]);
+    }
+
+    AggregateReport report;
+    report.groups = partials[0].groups();
+    report.top = partials[0].take_top();
+    report.rows = partials[0].rows();
+    report.seconds = seconds_since(start);
+    return report;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "CatalogAggregate.hpp"
+#include "HeadphonesList.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class WorkspaceCatalog {
+public:
+    std::string filename;
+    HeadphonesList list;
+    std::uint64_t file_bytes;
+    double load_seconds;
+};
+
+class WorkspaceLoadError {
+public:
+    std::string filename;
+    std::string message;
+};
+
+class WorkspaceLoadReport {
+public:
+    std::uintptr_t loaded;
+    std::uintptr_t records;
+    std::vector<WorkspaceLoadError> errors;
+    double seconds;
+    // The longest single load, which bounds the whole on enough threads.
+    double longest_seconds;
+
+    WorkspaceLoadReport();
+};
+
+class WorkspaceMatch {
+public:
+    std::size_t catalog;
+    std::uintptr_t position;
+    Headphones record;
+};
+
+// A set of catalog files, each kept as its own list, that can be queried
+// together. Files are loaded concurrently on the shared thread pool, largest
+// first, so the whole set loads in about the time of the largest file.
+// Queries likewise run over catalogs in parallel and give matches in catalog
+// order.
+class CatalogWorkspace {
+public:
+    CatalogWorkspace();
+
+    // A file already in the workspace is reloaded in place; a file that
+    // fails to load is reported and leaves its previous contents.
+    WorkspaceLoadReport load(const std::vector<std::string>& filenames);
+    void clear();
+
+    std::size_t size() const;
+    const WorkspaceCatalog& catalog(std::size_t index) const;
+    std::uintptr_t count() const;
+
+    std::vector<WorkspaceMatch> find(const std::string& producer, const std::string& model) const;
+    // At most limit matches; prices that parse_price cannot read never match.
+    std::vector<WorkspaceMatch> find_by_price(double min_price, double max_price, std::size_t limit) const;
+    AggregateReport aggregate(GroupKey group_key, std::size_t top_count) const;
+private:
+    std::vector<WorkspaceCatalog> m_catalogs;
+};
@@ -0,0 +1,253 @@
+#include "ConcurrentHeadphonesList.hpp"
+#include "HeadphonesSchema.hpp"
+#include <thread>
+#include <utility>
+
+ConcurrentHeadphonesList::SpinLock::SpinLock() :
+    m_is_locked(false)
+{}
+
+void ConcurrentHeadphonesList::SpinLock::lock()
+{
+    while (m_is_locked.exchange(true, std::memory_order_acquire))
+    {
+        while (m_is_locked.load(std::memory_order_relaxed))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ConcurrentHeadphonesList::SpinLock::unlock()
+{
+    m_is_locked.store(false, std::memory_order_release);
+}
+
+ConcurrentHeadphonesList::Iterator::Iterator(
+    node_ptr node
+) :
+    m_node(node)
+{}
+
+ConcurrentHeadphonesList::Iterator& ConcurrentHeadphonesList::Iterator::operator++()
+{
+    while (!m_node->m_is_tail)
+    {
+        node_ptr next;
+        {
+            std::lock_guard<SpinLock> lock(m_node->m_lock);
+            next = m_node->m_next;
+        }
+        m_node = next;
+        if (!m_node->m_is_removed)
+        {
+            break;
+        }
+    }
+    return *this;
+}
+
+ConcurrentHeadphonesList::Iterator ConcurrentHeadphonesList::Iterator::operator++(int)
+{
+    Iterator result = *this;
+    ++(*this);
+    return result;
+}
+
+bool ConcurrentHeadphonesList::Iterator::is_end() const
+{
+    return m_node->m_is_tail;
+}
+
+bool ConcurrentHeadphonesList::Iterator::is_removed() const
+{
+    return m_node->m_is_removed;
+}
+
+bool operator== (const ConcurrentHeadphonesList::Iterator& a, const ConcurrentHeadphonesList::Iterator& b)
+{
+    return a.m_node == b.m_node;
+}
+
+bool operator!= (const ConcurrentHeadphonesList::Iterator& a, const ConcurrentHeadphonesList::Iterator& b)
+{
+    return !(a == b);
+}
+
+ConcurrentHeadphonesList::ConcurrentHeadphonesList() :
+    m_head(std::make_shared<Node>()),
+    m_tail(std::make_shared<Node>()),
+    m_count(0)
+{
+    m_tail->m_is_tail = true;
+    m_head->m_next = m_tail;
+    m_tail->m_prev = m_head.get();
+}
+
+ConcurrentHeadphonesList::~ConcurrentHeadphonesList()
+{
+    // Unlink iteratively: releasing a long chain of owning links recursively
+    // would overflow the stack.
+    node_ptr node = std::move(m_head->m_next);
+    while (node)
+    {
+        node_ptr next = std::move(node->m_next);
+        node = std::move(next);
+    }
+}
+
+ConcurrentHeadphonesList::Iterator ConcurrentHeadphonesList::begin() const
+{
+    Iterator it(m_head);
+    return ++it;
+}
+
+ConcurrentHeadphonesList::Iterator ConcurrentHeadphonesList::end() const
+{
+    return Iterator(m_tail);
+}
+
+std::uintptr_t ConcurrentHeadphonesList::count() const
+{
+    return m_count;
+}
+
+bool ConcurrentHeadphonesList::is_empty() const
+{
+    return count() == 0;
+}
+
+bool ConcurrentHeadphonesList::remove(Iterator it)
+{
+    Node& node = *it.m_node;
+    if (node.m_is_tail || &node == m_head.get())
+    {
+        return false;
+    }
+
+    while (true)
+    {
+        // The predecessor cannot be unlinked while we hold the node's lock,
+        // so it is safe to take a strong reference to it here.
+        node_ptr prev;
+        {
+            std::lock_guard<SpinLock> lock(node.m_lock);
+            if (node.m_is_removed)
+            {
+                return false;
+            }
+            prev = node.m_prev->shared_from_this();
+        }
+
+        std::lock_guard<SpinLock> prev_lock(prev->m_lock);
+        std::lock_guard<SpinLock> node_lock(node.m_lock);
+        if (node.m_is_removed)
+        {
+            return false;
+        }
+        if (prev->m_is_removed || prev->m_next.get() != &node)
+        {
+            continue;
+        }
+
+        node_ptr next = node.m_next;
+        std::lock_guard<SpinLock> next_lock(next->m_lock);
+        prev->m_next = next;
+        next->m_prev = prev.get();
+        node.m_is_removed = true;
+        m_count--;
+        return true;
+    }
+}
+
+void ConcurrentHeadphonesList::append(const HeadphonesList& list)
+{
+    for (const auto& node : list.snapshot())
+    {
+        auto copy = std::make_shared<Node>();
+        HeadphonesSchema::assign(copy->m_value, node->cvalue());
+        insert_before(end(), copy);
+    }
+}
+
+HeadphonesList ConcurrentHeadphonesList::to_list() const
+{
+    HeadphonesList list {};
+    for (auto it = begin(); !it.is_end(); ++it)
+    {
+        it.read(
+            [&list](const Headphones& value)
+            {
+                auto copy = list.emplace_after(list.tail());
+                HeadphonesSchema::assign((*copy)->value(), value);
+            }
+        );
+    }
+    return list;
+}
+
+ConcurrentHeadphonesList::Iterator ConcurrentHeadphonesList::insert_before(Iterator it, node_ptr node)
+{
+    Node& next = *it.m_node;
+    if (&next == m_head.get())
+    {
+        return end();
+    }
+
+    while (true)
+    {
+        node_ptr prev;
+        {
+            std::lock_guard<SpinLock> lock(next.m_lock);
+            if (next.m_is_removed)
+            {
+                return end();
+            }
+            prev = next.m_prev->shared_from_this();
+        }
+
+        std::lock_guard<SpinLock> prev_lock(prev->m_lock);
+        std::lock_guard<SpinLock> next_lock(next.m_lock);
+        if (next.m_is_removed)
+        {
+            return end();
+        }
+        if (prev->m_is_removed || prev->m_next.get() != &next)
+        {
+            continue;
+        }
+
+        node_ptr next_ptr = prev->m_next;
+        link(*prev, node, next_ptr);
+        m_count++;
+        return Iterator(node);
+    }
+}
+
+ConcurrentHeadphonesList::Iterator ConcurrentHeadphonesList::insert_after(Iterator it, node_ptr node)
+{
+    Node& prev = *it.m_node;
+    if (prev.m_is_tail)
+    {
+        return end();
+    }
+
+    std::lock_guard<SpinLock> prev_lock(prev.m_lock);
+    if (prev.m_is_removed)
+    {
+        return end();
+    }
+    node_ptr next = prev.m_next;
+    std::lock_guard<SpinLock> next_lock(next->m_lock);
+    link(prev, node, next);
+    m_count++;
+    return Iterator(node);
+}
+
+void ConcurrentHeadphonesList::link(Node& prev, const node_ptr& node, const node_ptr& next)
+{
+    node->m_next = next;
+    node->m_prev = &prev;
+    next->m_prev = node.get();
+    prev.m_next = node;
+}
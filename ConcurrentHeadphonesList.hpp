@@ -0,0 +1,124 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// A HeadphonesList that may be shared between threads. Every node carries its
+// own lock and operations lock at most three neighbouring nodes, always in list
+// order, so writers in different parts of the list do not contend.
+//
+// Unlinked nodes keep their forward link, so an iterator standing on a removed
+// record still advances to the live records that followed it. Iteration is
+// forward only: a removed node's backward link may point to freed memory.
+class ConcurrentHeadphonesList {
+public:
+    class SpinLock {
+    public:
+        SpinLock();
+
+        void lock();
+        void unlock();
+    private:
+        std::atomic<bool> m_is_locked;
+    };
+
+    class Node : public std::enable_shared_from_this<Node> {
+    public:
+        template<typename... Args>
+        Node(Args&&... args) :
+            m_value(std::forward<Args>(args)...),
+            m_next(nullptr),
+            m_prev(nullptr),
+            m_is_removed(false),
+            m_is_tail(false),
+            m_lock()
+        {}
+    private:
+        friend class ConcurrentHeadphonesList;
+
+        Headphones m_value;
+        std::shared_ptr<Node> m_next;
+        Node* m_prev;
+        std::atomic<bool> m_is_removed;
+        bool m_is_tail;
+        SpinLock m_lock;
+    };
+    using node_ptr = std::shared_ptr<Node>;
+
+    class Iterator {
+    public:
+        Iterator(node_ptr node);
+
+        Iterator& operator++();
+        Iterator operator++(int);
+        bool is_end() const;
+        bool is_removed() const;
+
+        template<class Visitor>
+        void read(Visitor visitor) const
+        {
+            std::lock_guard<SpinLock> lock(m_node->m_lock);
+            visitor((const Headphones&)m_node->m_value);
+        }
+        template<class Visitor>
+        bool update(Visitor visitor)
+        {
+            std::lock_guard<SpinLock> lock(m_node->m_lock);
+            if (m_node->m_is_removed)
+            {
+                return false;
+            }
+            visitor(m_node->m_value);
+            return true;
+        }
+
+        friend bool operator== (const Iterator& a, const Iterator& b);
+        friend bool operator!= (const Iterator& a, const Iterator& b);
+    private:
+        friend class ConcurrentHeadphonesList;
+
+        node_ptr m_node;
+    };
+
+    ConcurrentHeadphonesList();
+    ~ConcurrentHeadphonesList();
+
+    ConcurrentHeadphonesList(const ConcurrentHeadphonesList& list) = delete;
+    ConcurrentHeadphonesList& operator=(const ConcurrentHeadphonesList& list) = delete;
+
+    Iterator begin() const;
+    Iterator end() const;
+    std::uintptr_t count() const;
+    bool is_empty() const;
+
+    // Both return end() if `it` was removed before the new node could be linked.
+    template<typename... Args>
+    Iterator emplace_before(Iterator it, Args&&... args)
+    {
+        return insert_before(it, std::make_shared<Node>(std::forward<Args>(args)...));
+    }
+    template<typename... Args>
+    Iterator emplace_after(Iterator it, Args&&... args)
+    {
+        return insert_after(it, std::make_shared<Node>(std::forward<Args>(args)...));
+    }
+    template<typename... Args>
+    Iterator emplace_back(Args&&... args)
+    {
+        return emplace_before(end(), std::forward<Args>(args)...);
+    }
+    bool remove(Iterator it);
+
+    void append(const HeadphonesList& list);
+    HeadphonesList to_list() const;
+private:
+    node_ptr m_head;
+    node_ptr m_tail;
+    std::atomic<std::uintptr_t> m_count;
+
+    Iterator insert_before(Iterator it, node_ptr node);
+    Iterator insert_after(Iterator it, node_ptr node);
+    static void link(Node& prev, const node_ptr& node, const node_ptr& next);
+};
@@ -0,0 +1,171 @@
+#include "ConcurrentListBenchmark.hpp"
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Writers keep the price equal to the volume written out, so a reader
+    // that sees them differ has seen a record half-updated.
+    std::string price_for(double volume)
+    {
+        return std::to_string((long long)volume);
+    }
+}
+
+ConcurrentListBenchmark::ConcurrentListBenchmark(
+    std::size_t record_count,
+    std::chrono::milliseconds duration
+) :
+    m_record_count(record_count),
+    m_duration(duration)
+{}
+
+bool ConcurrentListBenchmark::run()
+{
+    bool is_consistent = run_stress(8);
+    run_sweep();
+    return is_consistent;
+}
+
+ConcurrentListBenchmark::Totals ConcurrentListBenchmark::run_threads(
+    ConcurrentHeadphonesList& list,
+    std::size_t thread_count,
+    int write_percent
+) const
+{
+    std::atomic<bool> is_stopping(false);
+    std::vector<Totals> totals(thread_count, Totals {0, 0, 0, 0});
+    auto work = [&](std::size_t index)
+    {
+        std::minstd_rand random((std::uint32_t)index + 1);
+        auto& mine = totals[index];
+        auto it = list.begin();
+        while (!is_stopping.load(std::memory_order_relaxed))
+        {
+            if (it.is_end())
+            {
+                it = list.begin();
+                if (it.is_end())
+                {
+                    it = list.emplace_back("T", "M", price_for(0), 0.0, false, false, EqualizerMode::Normal);
+                    mine.inserted += !it.is_end();
+                    continue;
+                }
+            }
+
+            int roll = (int)(random() % 300);
+            if (roll >= write_percent * 3)
+            {
+                it.read(
+                    [&mine](const Headphones& value)
+                    {
+                        mine.torn_reads += value.get_price() != price_for(value.get_volume());
+                    }
+                );
+                ++it;
+            }
+            else if (roll < write_percent)
+            {
+                double volume = (double)(random() % 1000);
+                it.update(
+                    [volume](Headphones& value)
+                    {
+                        value.set_volume(volume);
+                        value.set_price(price_for(volume));
+                    }
+                );
+                ++it;
+            }
+            else if (roll < write_percent * 2)
+            {
+                double volume = (double)(random() % 1000);
+                auto added = list.emplace_after(it, "T", "M", price_for(volume), volume, false, false, EqualizerMode::Normal);
+                mine.inserted += !added.is_end();
+                ++it;
+            }
+            else
+            {
+                mine.removed += list.remove(it);
+                ++it;
+            }
+            mine.operations++;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back(work, i);
+    }
+    std::this_thread::sleep_for(m_duration);
+    is_stopping = true;
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    Totals sum {0, 0, 0, 0};
+    for (const auto& mine : totals)
+    {
+        sum.operations += mine.operations;
+        sum.inserted += mine.inserted;
+        sum.removed += mine.removed;
+        sum.torn_reads += mine.torn_reads;
+    }
+    return sum;
+}
+
+void ConcurrentListBenchmark::fill(ConcurrentHeadphonesList& list) const
+{
+    for (std::size_t i = 0; i < m_record_count; i++)
+    {
+        double volume = (double)(i % 1000);
+        list.emplace_back("T", "M" + std::to_string(i), price_for(volume), volume, false, false, EqualizerMode::Normal);
+    }
+}
+
+bool ConcurrentListBenchmark::run_stress(std::size_t thread_count)
+{
+    ConcurrentHeadphonesList list;
+    fill(list);
+    auto totals = run_threads(list, thread_count, 30);
+
+    std::uint64_t traversed = 0;
+    for (auto it = list.begin(); !it.is_end(); ++it)
+    {
+        traversed++;
+    }
+    std::uint64_t expected = m_record_count + totals.inserted - totals.removed;
+    bool is_consistent = totals.torn_reads == 0 && list.count() == expected && traversed == expected;
+
+    std::cout
+        << "Проверка под нагрузкой, потоков: " << thread_count
+        << ", операций: " << totals.operations
+        << ", вставлено: " << totals.inserted
+        << ", удалено: " << totals.removed << "\n"
+        << "  записей: " << list.count() << ", при обходе: " << traversed << ", ожидалось: " << expected
+        << ", несогласованных чтений: " << totals.torn_reads
+        << (is_consistent ? ". Список согласован.\n" : ". ОШИБКА: список рассогласован.\n")
+        << std::flush;
+    return is_consistent;
+}
+
+void ConcurrentListBenchmark::run_sweep()
+{
+    std::cout << "Смешанная нагрузка, 10% записей:\n" << std::flush;
+    for (std::size_t thread_count : {1, 2, 4, 8, 16})
+    {
+        ConcurrentHeadphonesList list;
+        fill(list);
+        auto totals = run_threads(list, thread_count, 10);
+        double seconds = std::chrono::duration<double>(m_duration).count();
+        std::cout
+            << "  потоков: " << thread_count
+            << ", оп/с: " << (std::uint64_t)(totals.operations / seconds) << "\n"
+            << std::flush;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "ConcurrentHeadphonesList.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Exercises ConcurrentHeadphonesList from many threads at once. The stress
+// run mixes reads, in-place updates, inserts and removes and then checks that
+// no record was seen half-updated and that the count, a full traversal and
+// the successful inserts and removes all agree; built with
+// -fsanitize=thread it doubles as the race test of the list. The sweep then
+// measures throughput of a read-mostly mix from 1 to 16 threads.
+class ConcurrentListBenchmark {
+public:
+    ConcurrentListBenchmark(std::size_t record_count, std::chrono::milliseconds duration);
+
+    // Returns whether the stress run found the list consistent.
+    bool run();
+private:
+    class Totals {
+    public:
+        std::uint64_t operations;
+        std::uint64_t inserted;
+        std::uint64_t removed;
+        std::uint64_t torn_reads;
+    };
+
+    std::size_t m_record_count;
+    std::chrono::milliseconds m_duration;
+
+    // write_percent of the operations are writes, split evenly between
+    // updates, inserts and removes; the rest read one record each.
+    Totals run_threads(ConcurrentHeadphonesList& list, std::size_t thread_count, int write_percent) const;
+    void fill(ConcurrentHeadphonesList& list) const;
+    bool run_stress(std::size_t thread_count);
+    void run_sweep();
+};
@@ -1,298 +1,176 @@
 #include "HeadphonesList.hpp"
+#include "HeadphonesSchema.hpp"
+#include "ThreadPool.hpp"
+#include "Utf8.hpp"
+#include <algorithm>
+#include <charconv>
+#include <optional>
 #include <utility>
 
-Headphones& HeadphonesList::Node::value()
+void assign_copy(Headphones& to, const Headphones& from)
 {
-    return m_value;
-}
-const Headphones& HeadphonesList::Node::cvalue() const
-{
-    return m_value;
-}
-HeadphonesList::Node::node_ptr HeadphonesList::Node::get_next() const
-{
-    return m_next;
-}
-HeadphonesList::Node::node_ptr HeadphonesList::Node::get_prev() const
-{
-    return m_prev;
+    HeadphonesSchema::assign(to, from);
 }
 
-void HeadphonesList::Node::set_next(node_ptr next)
-{
-    m_next = next;
-}
-void HeadphonesList::Node::set_prev(node_ptr prev)
+HeadphonesList HeadphonesList::clone() const
 {
-    m_prev = prev;
-}
-void HeadphonesList::Node::disconnect()
-{
-    set_next(nullptr);
-    set_prev(nullptr);
+    HeadphonesList copy {};
+    static_cast<IntrusiveList&>(copy) = IntrusiveList::clone();
+    return copy;
 }
 
-HeadphonesList::Iterator::Iterator(
-    std::shared_ptr<Node> ptr
-) :
-    m_ptr(ptr)
-{}
-HeadphonesList::Iterator::reference HeadphonesList::Iterator::operator*()
-{
-    return m_ptr;
-}
-HeadphonesList::Iterator::pointer HeadphonesList::Iterator::operator->()
-{
-    return &m_ptr;
-}
-HeadphonesList::Iterator& HeadphonesList::Iterator::operator++()
-{
-    m_ptr = m_ptr->get_next();
-    return *this;
-}
-HeadphonesList::Iterator HeadphonesList::Iterator::operator++(int)
-{
-    HeadphonesList::Iterator result = *this;
-    ++(*this);
-    return result;
-}
-HeadphonesList::Iterator& HeadphonesList::Iterator::operator--()
-{
-    m_ptr = m_ptr->get_prev();
-    return *this;
-}
-HeadphonesList::Iterator HeadphonesList::Iterator::operator--(int)
-{
-    HeadphonesList::Iterator result = *this;
-    --(*this);
-    return result;
-}
-bool operator== (const HeadphonesList::Iterator& a, const HeadphonesList::Iterator& b)
-{
-    return a.m_ptr == b.m_ptr;
-}
-bool operator!= (const HeadphonesList::Iterator& a, const HeadphonesList::Iterator& b)
-{
-    return !(a == b);
-}
-void swap(HeadphonesList::Iterator& a, HeadphonesList::Iterator& b)
-{
-    std::swap(a.m_ptr, b.m_ptr);
-}
-
-HeadphonesList::ConstIterator::ConstIterator(
-    HeadphonesList::ConstIterator::value_type ptr
+HeadphonesList::DeserializeError::DeserializeError(
+    std::string message
 ) :
-    m_ptr(ptr)
+    message(message)
 {}
 
-
-HeadphonesList::ConstIterator::ConstIterator(
-    HeadphonesList::Iterator iter
+HeadphonesList::SerializeError::SerializeError(
+    std::string message
 ) :
-    m_ptr(*iter)
+    message(message)
 {}
 
-HeadphonesList::ConstIterator::reference HeadphonesList::ConstIterator::operator*()
-{
-    return m_ptr;
-}
-HeadphonesList::ConstIterator::pointer HeadphonesList::ConstIterator::operator->()
-{
-    return &m_ptr;
-}
-HeadphonesList::ConstIterator& HeadphonesList::ConstIterator::operator++()
-{
-    m_ptr = m_ptr->get_next();
-    return *this;
-}
-HeadphonesList::ConstIterator HeadphonesList::ConstIterator::operator++(int)
-{
-    HeadphonesList::ConstIterator result = *this;
-    ++(*this);
-    return result;
-}
-HeadphonesList::ConstIterator& HeadphonesList::ConstIterator::operator--()
-{
-    m_ptr = m_ptr->get_prev();
-    return *this;
-}
-HeadphonesList::ConstIterator HeadphonesList::ConstIterator::operator--(int)
-{
-    HeadphonesList::ConstIterator result = *this;
-    --(*this);
-    return result;
-}
-bool operator== (const HeadphonesList::ConstIterator& a, const HeadphonesList::ConstIterator& b)
+void HeadphonesList::serialize_record(std::string& block, const Headphones& value)
 {
-    return a.m_ptr == b.m_ptr;
-}
-bool operator!= (const HeadphonesList::ConstIterator& a, const HeadphonesList::ConstIterator& b)
-{
-    return !(a == b);
-}
-void swap(HeadphonesList::ConstIterator& a, HeadphonesList::ConstIterator& b)
-{
-    std::swap(a.m_ptr, b.m_ptr);
-}
-
-HeadphonesList::HeadphonesList() :
-    m_head(nullptr),
-    m_tail(nullptr),
-    m_count(0)
-{}
+    auto delim = '|';
 
-HeadphonesList::Iterator HeadphonesList::head()
-{
-    return Iterator(m_head);
-}
-HeadphonesList::Iterator HeadphonesList::tail()
-{
-    return Iterator(m_tail);
-}
-HeadphonesList::ConstIterator HeadphonesList::chead() const
-{
-    return ConstIterator((Node::const_node_ptr)m_head);
-}
-HeadphonesList::ConstIterator HeadphonesList::ctail() const
-{
-    return ConstIterator((Node::const_node_ptr)m_tail);
-}
-std::uintptr_t HeadphonesList::count() const
-{
-    return m_count;
-}
-bool HeadphonesList::is_empty() const
-{
-    return count() == 0;
+    HeadphonesSchema::for_each_field(
+        [&](const auto& field)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            // The length prefix is only known once the field is encoded; the
+            // field is short, so moving it up to make room costs next to nothing.
+            std::size_t start = block.size();
+            Field::encoding::encode(Field::get(value), block);
+            char prefix[24];
+            auto result = std::to_chars(prefix, prefix + sizeof(prefix) - 1, block.size() - start);
+            *result.ptr++ = delim;
+            block.insert(start, prefix, result.ptr - prefix);
+        }
+    );
 }
-bool HeadphonesList::is_not_empty() const
+
+bool HeadphonesList::write_block(std::ostream& os, std::string& block)
 {
-    return !is_empty();
+    os.write(block.data(), block.size());
+    block.clear();
+    return (bool)os;
 }
 
-
-HeadphonesList::Iterator HeadphonesList::index(std::uintptr_t index)
+HeadphonesList::SerializeResult HeadphonesList::serialize(std::ostream& os) const
 {
-    if (index >= count())
+    auto io_err = "Ошибка ввода-вывода при записи файла";
+
+    std::string block;
+    block.reserve(serialize_block_size + 4096);
+    try
     {
-        return Iterator(nullptr);
+        for (const auto& value : *this)
+        {
+            serialize_record(block, value);
+            if (block.size() >= serialize_block_size && !write_block(os, block))
+            {
+                return SerializeError(io_err);
+            }
+        }
+        block += end_symbol;
+        if (!write_block(os, block))
+        {
+            return SerializeError(io_err);
+        }
+        return std::monostate();
     }
-
-    auto iter = head();
-    for (; index != 0; index--)
+    catch (std::ios_base::failure e)
     {
-        iter = (*iter)->get_next();
+        return SerializeError(io_err);
     }
-    return iter;
 }
 
-HeadphonesList::Iterator HeadphonesList::insert_before(Iterator it, Node::node_ptr node)
-{
-    auto next = *it;
-    auto prev = next ? (*it)->get_prev() : nullptr;
-    return insert_internal(node, next, prev);
-}
-HeadphonesList::Iterator HeadphonesList::insert_after(Iterator it, Node::node_ptr node)
+HeadphonesList::SerializeResult HeadphonesList::serialize(std::ostream& os, const Snapshot& snapshot)
 {
-    auto prev = *it;
-    auto next = prev ? (*it)->get_next() : nullptr;
-    return insert_internal(node, next, prev);
+    return serialize_snapshot(os, snapshot, nullptr);
 }
-
-void HeadphonesList::remove(HeadphonesList::Iterator it)
+HeadphonesList::SerializeResult HeadphonesList::serialize(
+    std::ostream& os,
+    const Snapshot& snapshot,
+    std::vector<std::uint64_t>& offsets
+)
 {
-    Node::node_ptr node = *it;
-    if (!node)
-    {
-        return;
-    }
-
-    Node::node_ptr next = node->get_next();
-    Node::node_ptr prev = node->get_prev();
-
-    if (next)
-    {
-        next->set_prev(prev);
-    }
-    else
-    {
-        m_tail = prev;
-    }
-
-    if (prev)
-    {
-        prev->set_next(next);
-    }
-    else
-    {
-        m_head = next;
-    }
-
-    node->disconnect();
-    m_count--;
+    offsets.clear();
+    offsets.reserve(snapshot.size() + 1);
+    return serialize_snapshot(os, snapshot, &offsets);
 }
 
-HeadphonesList::DeserializeError::DeserializeError(
-    std::string message
-) :
-    message(message)
-{}
-
-HeadphonesList::SerializeError::SerializeError(
-    std::string message
-) :
-    message(message)
-{}
-
-HeadphonesList::SerializeResult HeadphonesList::serialize(std::ostream& os) const
+HeadphonesList::SerializeResult HeadphonesList::serialize_snapshot(
+    std::ostream& os,
+    const Snapshot& snapshot,
+    std::vector<std::uint64_t>* offsets
+)
 {
-    auto end_symb = '^';
-    auto delim = '|';
     auto io_err = "Ошибка ввода-вывода при записи файла";
 
-    if (is_empty())
+    auto& pool = ThreadPool::shared();
+    std::size_t wave_chunks = pool.thread_count() * 2;
+    std::vector<std::string> blocks(wave_chunks);
+    std::vector<std::vector<std::uint64_t>> block_offsets(offsets ? wave_chunks : 0);
+    std::uint64_t written = 0;
+    try
     {
-        try
+        for (std::size_t wave = 0; wave < snapshot.size(); wave += wave_chunks * serialize_chunk_records)
         {
-            os << end_symb;
-            return std::monostate();
-        }
-        catch (std::ios_base::failure e)
-        {
-            return SerializeError(io_err);
-        }
-    }
-
-    for (ConstIterator it = chead();;it++)
-    {
-
-        const auto& value = (*it)->cvalue();
-        std::string buffer;
-        try
-        {
-            os << value.get_producer_name().size() << delim << value.get_producer_name();
-            os << value.get_model_name().size() << delim << value.get_model_name();
-            os << value.get_price().size() << delim << value.get_price();
-            buffer = std::to_string(value.get_volume());
-            os << buffer.size() << delim << buffer;
-            buffer = std::to_string(value.is_noise_canceling_enabled());
-            os << buffer.size() << delim << buffer;
-            buffer = std::to_string(value.is_microphone_enabled());
-            os << buffer.size() << delim << buffer;
-            buffer = equalizer_mode_to_string(value.get_equalizer_mode());
-            os << buffer.size() << delim << buffer;
-
-            if (it == ctail())
+            std::size_t chunk_count = std::min(
+                wave_chunks,
+                (snapshot.size() - wave + serialize_chunk_records - 1) / serialize_chunk_records
+            );
+            pool.parallel_for(0, chunk_count, 1, [&](std::size_t begin, std::size_t end)
             {
-                os << end_symb;
-                return std::monostate();
+                for (auto chunk = begin; chunk < end; chunk++)
+                {
+                    auto first = wave + chunk * serialize_chunk_records;
+                    auto last = std::min(first + serialize_chunk_records, snapshot.size());
+                    for (auto i = first; i < last; i++)
+                    {
+                        if (offsets)
+                        {
+                            block_offsets[chunk].push_back(blocks[chunk].size());
+                        }
+                        serialize_record(blocks[chunk], snapshot[i]->cvalue());
+                    }
+                }
+            });
+
+            for (std::size_t chunk = 0; chunk < chunk_count; chunk++)
+            {
+                if (offsets)
+                {
+                    for (auto offset : block_offsets[chunk])
+                    {
+                        offsets->push_back(written + offset);
+                    }
+                    block_offsets[chunk].clear();
+                }
+                written += blocks[chunk].size();
+                if (!write_block(os, blocks[chunk]))
+                {
+                    return SerializeError(io_err);
+                }
             }
         }
-        catch (std::ios_base::failure e)
+        if (offsets)
+        {
+            offsets->push_back(written);
+        }
+        std::string block(1, end_symbol);
+        if (!write_block(os, block))
         {
             return SerializeError(io_err);
         }
+        return std::monostate();
+    }
+    catch (std::ios_base::failure e)
+    {
+        return SerializeError(io_err);
     }
 }
 
@@ -357,6 +235,16 @@ std::variant<std::string, HeadphonesList::DeserializeError> HeadphonesList::dese
                 return DeserializeError(eof_err);
             }
 
+            if (auto offset = find_invalid_utf8(buffer))
+            {
+                std::string where = "в байте " + std::to_string(*offset + 1) + " поля";
+                auto end = is.tellg();
+                if (end != std::istream::pos_type(-1))
+                {
+                    where = "по смещению " + std::to_string((std::streamoff)end - (std::streamoff)len + (std::streamoff)*offset);
+                }
+                return DeserializeError("Файл содержит некорректную последовательность UTF-8 " + where + ".");
+            }
             return buffer;
         }
         buffer += ch;
@@ -365,170 +253,165 @@ std::variant<std::string, HeadphonesList::DeserializeError> HeadphonesList::dese
 
 HeadphonesList::DeserializeResult HeadphonesList::deserialize(std::istream& is)
 {
-    const auto end_symb = '^';
-    const auto io_err = "Ошибка ввода-вывода при чтении файла.";
-    const auto ill_err = "Файл поврежден или записан некорректно.";
-    const auto eof_err = "Файл неожиданно обрывается.";
-    HeadphonesList list {};
-
+    // Records are chained up on their own and handed to the list at the end,
+    // so a failed load never touches a list at all.
+    Node::node_ptr chain_head;
+    Node::node_ptr chain_tail;
+    std::uintptr_t chain_count = 0;
     while (true)
     {
-        std::istream::int_type ch;
-        try
+        auto result = deserialize_record(is);
+        if (std::holds_alternative<DeserializeError>(result))
         {
-            ch = is.peek();
+            // Nodes hold each other through both links; the list unlinks
+            // them when it goes.
+            HeadphonesList partial {};
+            partial.attach(Iterator(nullptr), chain_head, chain_tail, chain_count);
+            return std::get<DeserializeError>(result);
         }
-        catch (std::ios_base::failure e) {}
-
-        if (is.bad() || is.fail())
-        {
-            return DeserializeError(io_err);
-        }
-        if (is.eof())
-        {
-            return DeserializeError(eof_err);
-        }
-
-        if (ch == end_symb)
-        {
-            return list;
-        }
-
-        auto result = deserialize_read_section(is);
-        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+        auto& node = std::get<Node::node_ptr>(result);
+        if (!node)
         {
-            return std::get<HeadphonesList::DeserializeError>(result);
+            break;
         }
-        std::string producer_name = std::get<std::string>(result);
+        link_back(chain_head, chain_tail, std::move(node));
+        chain_count++;
+    }
 
-        result = deserialize_read_section(is);
-        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
-        {
-            return std::get<HeadphonesList::DeserializeError>(result);
-        }
-        std::string model_name = std::get<std::string>(result);
+    HeadphonesList list {};
+    list.attach(Iterator(nullptr), chain_head, chain_tail, chain_count);
+    return DeserializeResult(std::move(list));
+}
 
-        result = deserialize_read_section(is);
-        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
-        {
-            return std::get<HeadphonesList::DeserializeError>(result);
-        }
-        std::string price = std::get<std::string>(result);
+std::variant<HeadphonesList::Node::node_ptr, HeadphonesList::DeserializeError> HeadphonesList::deserialize_record(std::istream& is)
+{
+    const auto io_err = "Ошибка ввода-вывода при чтении файла.";
+    const auto ill_err = "Файл поврежден или записан некорректно.";
+    const auto eof_err = "Файл неожиданно обрывается.";
 
-        result = deserialize_read_section(is);
-        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
-        {
-            return std::get<HeadphonesList::DeserializeError>(result);
-        }
-        std::string buffer = std::get<std::string>(result);
-        double volume;
-        try
-        {
-            volume = std::stod(buffer);
-        }
-        catch (std::invalid_argument e)
-        {
-            return DeserializeError(ill_err);
-        }
-        catch (std::out_of_range e)
-        {
-            return DeserializeError(ill_err);
-        }
+    std::istream::int_type ch;
+    try
+    {
+        ch = is.peek();
+    }
+    catch (std::ios_base::failure e) {}
 
-        result = deserialize_read_section(is);
-        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
-        {
-            return std::get<HeadphonesList::DeserializeError>(result);
-        }
-        buffer = std::get<std::string>(result);
-        bool is_noise_canceling_enabled;
-        try
-        {
-            is_noise_canceling_enabled = (bool)std::stoi(buffer);
-        }
-        catch (std::invalid_argument e)
-        {
-            return DeserializeError(ill_err);
-        }
-        catch (std::out_of_range e)
-        {
-            return DeserializeError(ill_err);
-        }
+    if (is.bad() || is.fail())
+    {
+        return DeserializeError(io_err);
+    }
+    if (is.eof())
+    {
+        return DeserializeError(eof_err);
+    }
 
-        result = deserialize_read_section(is);
-        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
-        {
-            return std::get<HeadphonesList::DeserializeError>(result);
-        }
-        buffer = std::get<std::string>(result);
-        bool is_microphone_enabled;
-        try
-        {
-            is_microphone_enabled = (bool)std::stoi(buffer);
-        }
-        catch (std::invalid_argument e)
-        {
-            return DeserializeError(ill_err);
-        }
-        catch (std::out_of_range e)
-        {
-            return DeserializeError(ill_err);
-        }
+    if (ch == end_symbol)
+    {
+        return nullptr;
+    }
 
-        result = deserialize_read_section(is);
-        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+    auto node = make_node();
+    std::optional<DeserializeError> error;
+    HeadphonesSchema::all_fields(
+        [&](const auto& field)
         {
-            return std::get<HeadphonesList::DeserializeError>(result);
-        }
-        buffer = std::get<std::string>(result);
-        EqualizerMode equalizer_mode;
-        auto equalizer_mode_opt = equalizer_mode_from_string(buffer);
-        if (!equalizer_mode_opt)
-        {
-            return DeserializeError(ill_err);
+            using Field = std::decay_t<decltype(field)>;
+            auto result = deserialize_read_section(is);
+            if (std::holds_alternative<DeserializeError>(result))
+            {
+                error = std::get<DeserializeError>(result);
+                return false;
+            }
+            if (!Field::encoding::decode(std::move(std::get<std::string>(result)), Field::get(node->value())))
+            {
+                error = DeserializeError(ill_err);
+                return false;
+            }
+            return true;
         }
-        equalizer_mode = equalizer_mode_opt.value();
-
-        list.emplace_after(
-            list.tail(),
-            producer_name,
-            model_name,
-            price,
-            volume,
-            is_noise_canceling_enabled,
-            is_microphone_enabled,
-            equalizer_mode
-        );
+    );
+    if (error)
+    {
+        return *error;
     }
+    return node;
 }
 
-HeadphonesList::Iterator HeadphonesList::insert_internal(
-    Node::node_ptr node,
-    Node::node_ptr next,
-    Node::node_ptr prev
+std::variant<HeadphonesList::Node::node_ptr, HeadphonesList::DeserializeError> HeadphonesList::deserialize_record(
+    const char*& first,
+    const char* last,
+    std::uint64_t offset,
+    const char* checked_until
 )
 {
-    node->set_next(next);
-    node->set_prev(prev);
+    const auto delim = '|';
+    const auto ill_err = "Файл поврежден или записан некорректно.";
+    // Section lengths are written as decimal numbers that fit in 64 bits.
+    const std::ptrdiff_t max_length_digits = 20;
 
-    if (next)
+    if (first == last)
     {
-        next->set_prev(node);
+        return nullptr;
     }
-    else
+    if (*first == end_symbol)
     {
-        m_tail = node;
+        first++;
+        return nullptr;
     }
 
-    if (prev)
+    const char* it = first;
+    auto node = make_node();
+    bool is_partial = false;
+    std::optional<DeserializeError> error;
+    HeadphonesSchema::all_fields(
+        [&](const auto& field)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            const char* length_end = std::find(it, it + std::min(last - it, max_length_digits + 1), delim);
+            if (length_end == last)
+            {
+                is_partial = true;
+                return false;
+            }
+            unsigned long long len;
+            auto parsed = std::from_chars(it, length_end, len);
+            if (*length_end != delim || parsed.ec != std::errc() || parsed.ptr != length_end)
+            {
+                error = DeserializeError(ill_err);
+                return false;
+            }
+            it = length_end + 1;
+            if ((unsigned long long)(last - it) < len)
+            {
+                is_partial = true;
+                return false;
+            }
+
+            std::string text(it, (std::size_t)len);
+            auto bad = it + len <= checked_until ? std::nullopt : find_invalid_utf8(text);
+            if (bad)
+            {
+                auto where = offset + (std::uint64_t)(it - first) + *bad;
+                error = DeserializeError("Файл содержит некорректную последовательность UTF-8 по смещению " + std::to_string(where) + ".");
+                return false;
+            }
+            it += len;
+            if (!Field::encoding::decode(std::move(text), Field::get(node->value())))
+            {
+                error = DeserializeError(ill_err);
+                return false;
+            }
+            return true;
+        }
+    );
+    if (error)
     {
-        prev->set_next(node);
+        return *error;
     }
-    else
+    if (is_partial)
     {
-        m_head = node;
+        return nullptr;
     }
-
-    m_count++;
-    return Iterator(node);
+    first = it;
+    return node;
 }
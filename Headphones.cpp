@@ -1,4 +1,5 @@
 #include "Headphones.hpp"
+#include "HeadphonesSchema.hpp"
 
 std::string equalizer_mode_to_string(EqualizerMode equalizer_mode)
 {
@@ -68,15 +69,15 @@ Headphones::Headphones(
     m_equalizer_mode(equalizer_mode)
 {}
 
-std::string Headphones::get_producer_name() const
+const std::string& Headphones::get_producer_name() const
 {
     return m_producer_name;
 }
-std::string Headphones::get_model_name() const
+const std::string& Headphones::get_model_name() const
 {
     return m_model_name;
 }
-std::string Headphones::get_price() const
+const std::string& Headphones::get_price() const
 {
     return m_price;
 }
@@ -126,15 +127,27 @@ void Headphones::set_equalizer_mode(EqualizerMode equalizer_mode)
     m_equalizer_mode = equalizer_mode;
 }
 
+bool operator==(const Headphones& a, const Headphones& b)
+{
+    return HeadphonesSchema::equal(a, b);
+}
+
+bool operator!=(const Headphones& a, const Headphones& b)
+{
+    return !(a == b);
+}
+
 std::ostream& operator<<(std::ostream& os, const Headphones& headphones)
 {
     os << "Список параметров наушников:" << "\n";
-    os << "  Производитель: " << headphones.get_producer_name() << "\n";
-    os << "  Название модели: " << headphones.get_model_name() << "\n";
-    os << "  Цена: " << headphones.get_price() << "\n";
-    os << "  Громкость: " << headphones.get_volume() << "\n";
-    os << "  Шумоподавление: " << (headphones.is_noise_canceling_enabled() ? "Вкл" : "Выкл") << "\n";
-    os << "  Микрофон: " << (headphones.is_microphone_enabled() ? "Вкл" : "Выкл") << "\n";
-    os << "  Режим эквалайзера: " << equalizer_mode_to_string(headphones.get_equalizer_mode()) << "\n";
+    HeadphonesSchema::for_each_field(
+        [&](const auto& field)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            os << "  " << field.label << ": ";
+            Field::encoding::print(os, Field::get(headphones));
+            os << "\n";
+        }
+    );
     return os;
 }
@@ -29,10 +29,12 @@ public:
 
     Headphones(const Headphones& headphones) = delete;
     Headphones& operator=(const Headphones& headphones) = delete;
+    Headphones(Headphones&& headphones) = default;
+    Headphones& operator=(Headphones&& headphones) = default;
 
-    std::string get_producer_name() const;
-    std::string get_model_name() const;
-    std::string get_price() const;
+    const std::string& get_producer_name() const;
+    const std::string& get_model_name() const;
+    const std::string& get_price() const;
     double get_volume() const;
     bool is_noise_canceling_enabled() const;
     bool is_microphone_enabled() const;
@@ -46,6 +48,8 @@ public:
     void toggle_microphone();
     void set_equalizer_mode(EqualizerMode equalizer_mode);
 private:
+    friend class HeadphonesSchema;
+
     std::string m_producer_name;
     std::string m_model_name;
     std::string m_price;
@@ -55,4 +59,6 @@ private:
     EqualizerMode m_equalizer_mode;
 };
 
+bool operator==(const Headphones& a, const Headphones& b);
+bool operator!=(const Headphones& a, const Headphones& b);
 std::ostream& operator<<(std::ostream& os, const Headphones& headphones);
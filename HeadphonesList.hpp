@@ -1,125 +1,25 @@
 #pragma once
 #include "Headphones.hpp"
+#include "IntrusiveList.hpp"
 #include <memory>
+#include <cstddef>
 #include <cstdint>
+#include <string>
 #include <variant>
+#include <vector>
 
-class HeadphonesList {
-public:
-    class Node {
-    public:
-        using node_ptr = std::shared_ptr<Node>;
-        using const_node_ptr = std::shared_ptr<const Node>;
-
-        template<typename... Args>
-        Node(Args&&... args) : m_value(std::forward<Args>(args)...) {}
-
-        Headphones& value();
-        const Headphones& cvalue() const;
-        node_ptr get_next() const;
-        node_ptr get_prev() const;
+// Headphones are not copyable; lists copy them field by field.
+void assign_copy(Headphones& to, const Headphones& from);
 
-        void set_next(node_ptr next);
-        void set_prev(node_ptr prev);
-        void disconnect();
-    private:
-        Headphones m_value;
-        node_ptr m_next;
-        node_ptr m_prev;
-    };
-
-    class Iterator {
-    public:
-        using iterator_category = std::bidirectional_iterator_tag;
-        using difference_type   = std::ptrdiff_t;
-        using value_type        = Node::node_ptr;
-        using pointer           = value_type*;
-        using reference         = value_type&;
-
-        Iterator(value_type ptr);
-
-        reference operator*();
-        pointer operator->();
-        Iterator& operator++();
-        Iterator operator++(int);
-        Iterator& operator--();
-        Iterator operator--(int);
-        friend bool operator== (const Iterator& a, const Iterator& b);
-        friend bool operator!= (const Iterator& a, const Iterator& b);
-
-        friend void swap(Iterator& a, Iterator& b);
-    private:
-        value_type m_ptr;
-    };
-
-    class ConstIterator {
-    public:
-        using iterator_category = std::bidirectional_iterator_tag;
-        using difference_type   = std::ptrdiff_t;
-        using value_type        = Node::const_node_ptr;
-        using pointer           = value_type*;
-        using reference         = value_type&;
-
-        ConstIterator(value_type ptr);
-        ConstIterator(Iterator iter);
-
-        reference operator*();
-        pointer operator->();
-        ConstIterator& operator++();
-        ConstIterator operator++(int);
-        ConstIterator& operator--();
-        ConstIterator operator--(int);
-        friend bool operator== (const ConstIterator& a, const ConstIterator& b);
-        friend bool operator!= (const ConstIterator& a, const ConstIterator& b);
-
-        friend void swap(ConstIterator& a, ConstIterator& b);
-    private:
-        value_type m_ptr;
-    };
-
-    HeadphonesList();
-
-    Iterator head();
-    Iterator tail();
-
-    ConstIterator chead() const;
-    ConstIterator ctail() const;
-    std::uintptr_t count() const;
-    bool is_empty() const;
-    bool is_not_empty() const;
-
-    Iterator index(std::uintptr_t index);
-    template<class UnaryPredicate>
-    Iterator find_if(Iterator first_inclusive, Iterator last_inclusive, UnaryPredicate p)
-    {
-        for (Iterator it = first_inclusive; *it; it++) {
-            if (p(it->get()))
-            {
-                return it;
-            }
-            if (it == last_inclusive)
-            {
-                break;
-            }
-        }
+// The headphones instantiation of IntrusiveList with every policy at its
+// default, which is what the rest of the program was written against, plus
+// the catalog file format.
+class HeadphonesList : public IntrusiveList<Headphones> {
+public:
+    HeadphonesList() = default;
 
-        return Iterator(nullptr);
-    }
-    template<typename... Args>
-    Iterator emplace_before(Iterator it, Args&&... args)
-    {
-        Node::node_ptr node = std::make_shared<Node>(std::forward<Args>(args)...);
-        return insert_before(it, node);
-    }
-    template<typename... Args>
-    Iterator emplace_after(Iterator it, Args&&... args)
-    {
-        Node::node_ptr node = std::make_shared<Node>(std::forward<Args>(args)...);
-        return insert_after(it, node);
-    }
-    Iterator insert_before(Iterator it, Node::node_ptr node);
-    Iterator insert_after(Iterator it, Node::node_ptr node);
-    void remove(Iterator it);
+    // A deep copy, node by node, sharing nothing with this list.
+    HeadphonesList clone() const;
 
     class DeserializeError {
     public:
@@ -136,16 +36,46 @@ public:
     using SerializeResult = std::variant<std::monostate, SerializeError>;
 
     SerializeResult serialize(std::ostream& os) const;
+    static SerializeResult serialize(std::ostream& os, const Snapshot& snapshot);
+    // Also records where each record starts, counted from the first byte
+    // written, followed by where the end mark starts.
+    static SerializeResult serialize(std::ostream& os, const Snapshot& snapshot, std::vector<std::uint64_t>& offsets);
     static DeserializeResult deserialize(std::istream& is);
-private:
-    Node::node_ptr m_head;
-    Node::node_ptr m_tail;
-    std::uintptr_t m_count;
 
-    Iterator insert_internal(
-        Node::node_ptr node,
-        Node::node_ptr next,
-        Node::node_ptr prev
+    // Record-at-a-time versions of the above for catalogs that are streamed
+    // rather than loaded. serialize_record appends one record to block;
+    // deserialize_record returns nullptr once it reaches the end of the list.
+    static constexpr char end_symbol = '^';
+    static void serialize_record(std::string& block, const Headphones& value);
+    static std::variant<Node::node_ptr, DeserializeError> deserialize_record(std::istream& is);
+    // The same for records already in memory, for loaders that do their own
+    // reading; offset is where first lies in the file, for error messages.
+    // Moves first past the record, or past the end mark for which it returns
+    // nullptr. When [first, last) ends inside the record it also returns
+    // nullptr, but leaves first where it was.
+    //
+    // Fields that end before checked_until are taken to be valid UTF-8, so
+    // that a loader can check a whole block in one pass: separators are
+    // ASCII, so a well-formed block has well-formed fields.
+    static std::variant<Node::node_ptr, DeserializeError> deserialize_record(
+        const char*& first,
+        const char* last,
+        std::uint64_t offset,
+        const char* checked_until
+    );
+private:
+    // Records are formatted into a block of about this size, which is then
+    // handed to the stream in one write.
+    static constexpr std::size_t serialize_block_size = 1 << 20;
+    // Snapshots are formatted this many records to a block, a few blocks per
+    // thread of the shared pool at once, and the blocks written in order.
+    static constexpr std::size_t serialize_chunk_records = 1 << 14;
+
+    static bool write_block(std::ostream& os, std::string& block);
+    static SerializeResult serialize_snapshot(
+        std::ostream& os,
+        const Snapshot& snapshot,
+        std::vector<std::uint64_t>* offsets
     );
     static std::variant<std::string, HeadphonesList::DeserializeError> deserialize_read_section(std::istream& is);
 };
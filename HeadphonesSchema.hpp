@@ -0,0 +1,266 @@
+#pragma once
+#include "Headphones.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// An encoding says how one field is written into a catalog section, parsed
+// back from it and shown to the user.
+class TextEncoding {
+public:
+    using value_type = std::string;
+
+    static void encode(const std::string& value, std::string& out)
+    {
+        out += value;
+    }
+    static bool decode(std::string text, std::string& value)
+    {
+        value = std::move(text);
+        return true;
+    }
+    static void print(std::ostream& os, const std::string& value)
+    {
+        os << value;
+    }
+};
+
+class NumberEncoding {
+public:
+    using value_type = double;
+
+    // Shortest text that parses back to the same bits, whatever the locale.
+    static void encode(double value, std::string& out)
+    {
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+    static bool decode(const std::string& text, double& value)
+    {
+        if (parse(text, value))
+        {
+            return true;
+        }
+        // Older files went through std::to_string, which writes the decimal
+        // separator of the current locale ("0,990000" under ru_RU).
+        std::string dotted = text;
+        std::replace(dotted.begin(), dotted.end(), ',', '.');
+        return parse(dotted, value);
+    }
+    static void print(std::ostream& os, double value)
+    {
+        os << value;
+    }
+private:
+    static bool parse(const std::string& text, double& value)
+    {
+        const char* end = text.data() + text.size();
+        auto result = std::from_chars(text.data(), end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+};
+
+class FlagEncoding {
+public:
+    using value_type = bool;
+
+    static void encode(bool value, std::string& out)
+    {
+        out += value ? '1' : '0';
+    }
+    static bool decode(const std::string& text, bool& value)
+    {
+        try
+        {
+            value = (bool)std::stoi(text);
+        }
+        catch (std::invalid_argument& e)
+        {
+            return false;
+        }
+        catch (std::out_of_range& e)
+        {
+            return false;
+        }
+        return true;
+    }
+    static void print(std::ostream& os, bool value)
+    {
+        os << (value ? "Вкл" : "Выкл");
+    }
+};
+
+class EqualizerModeEncoding {
+public:
+    using value_type = EqualizerMode;
+
+    static constexpr std::array<EqualizerMode, 4> choices {
+        EqualizerMode::Normal,
+        EqualizerMode::Bass,
+        EqualizerMode::Treble,
+        EqualizerMode::Vocal
+    };
+
+    static void encode(EqualizerMode value, std::string& out)
+    {
+        out += equalizer_mode_to_string(value);
+    }
+    static bool decode(const std::string& text, EqualizerMode& value)
+    {
+        auto mode = equalizer_mode_from_string(text);
+        if (!mode)
+        {
+            return false;
+        }
+        value = *mode;
+        return true;
+    }
+    static void print(std::ostream& os, EqualizerMode value)
+    {
+        os << equalizer_mode_to_string(value);
+    }
+};
+
+template<typename Encoding, typename Encoding::value_type Headphones::* Member>
+class HeadphonesField {
+public:
+    using encoding = Encoding;
+    using value_type = typename Encoding::value_type;
+
+    // Column name in CSV and key in JSON.
+    const char* key;
+    const char* label;
+    // Completes "Введите ..." when the field is edited by hand.
+    const char* prompt;
+
+    static const value_type& get(const Headphones& headphones)
+    {
+        return headphones.*Member;
+    }
+    static value_type& get(Headphones& headphones)
+    {
+        return headphones.*Member;
+    }
+};
+
+// The fields of Headphones in on-disk order. Everything that walks over the
+// fields is unrolled from this table at compile time, so a new field only has
+// to be added to Headphones and listed here.
+class HeadphonesSchema {
+public:
+    static constexpr auto fields = std::make_tuple(
+        HeadphonesField<TextEncoding, &Headphones::m_producer_name> {"producer", "Производитель", "название производителя"},
+        HeadphonesField<TextEncoding, &Headphones::m_model_name> {"model", "Название модели", "название модели"},
+        HeadphonesField<TextEncoding, &Headphones::m_price> {"price", "Цена", "цену"},
+        HeadphonesField<NumberEncoding, &Headphones::m_volume> {"volume", "Громкость", "громкость"},
+        HeadphonesField<FlagEncoding, &Headphones::m_is_noise_canceling_enabled> {"noise_canceling", "Шумоподавление", "шумоподавление"},
+        HeadphonesField<FlagEncoding, &Headphones::m_is_microphone_enabled> {"microphone", "Микрофон", "микрофон"},
+        HeadphonesField<EqualizerModeEncoding, &Headphones::m_equalizer_mode> {"equalizer_mode", "Режим эквалайзера", "режим эквалайзера"}
+    );
+    static constexpr std::size_t field_count = std::tuple_size<decltype(fields)>::value;
+
+    template<typename Visitor>
+    static void for_each_field(Visitor&& visitor)
+    {
+        std::apply([&visitor](const auto&... field) { (visitor(field), ...); }, fields);
+    }
+
+    // Visits fields in order until the visitor returns false.
+    template<typename Visitor>
+    static bool all_fields(Visitor&& visitor)
+    {
+        return std::apply([&visitor](const auto&... field) { return (visitor(field) && ...); }, fields);
+    }
+
+    // For menus, where the field is picked at run time.
+    template<typename Visitor>
+    static void visit_field(std::size_t index, Visitor&& visitor)
+    {
+        std::size_t i = 0;
+        all_fields(
+            [&](const auto& field)
+            {
+                if (i++ != index)
+                {
+                    return true;
+                }
+                visitor(field);
+                return false;
+            }
+        );
+    }
+
+    // Position of the field whose key or label is name.
+    static std::optional<std::size_t> find_field(const std::string& name)
+    {
+        std::optional<std::size_t> found;
+        std::size_t i = 0;
+        all_fields(
+            [&](const auto& field)
+            {
+                if (name == field.key || name == field.label)
+                {
+                    found = i;
+                    return false;
+                }
+                i++;
+                return true;
+            }
+        );
+        return found;
+    }
+
+    // Headphones is not copyable, so that copies are explicit.
+    static void assign(Headphones& to, const Headphones& from)
+    {
+        for_each_field(
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                Field::get(to) = Field::get(from);
+            }
+        );
+    }
+
+    static bool equal(const Headphones& a, const Headphones& b)
+    {
+        return all_fields(
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                return Field::get(a) == Field::get(b);
+            }
+        );
+    }
+
+    // Field-by-field ordering: negative, zero or positive like strcmp.
+    static int compare(const Headphones& a, const Headphones& b)
+    {
+        int result = 0;
+        all_fields(
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                if (Field::get(a) < Field::get(b))
+                {
+                    result = -1;
+                }
+                else if (Field::get(b) < Field::get(a))
+                {
+                    result = 1;
+                }
+                return result == 0;
+            }
+        );
+        return result;
+    }
+};
@@ -0,0 +1,925 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Policies of IntrusiveList, given in any order after the allocator. Each
+// pair is either/or; a list that names neither gets the first.
+//
+// TrackCount keeps the number of nodes; NoCount counts them when asked.
+class TrackCount {};
+class NoCount {};
+// SinglyLinked drops the link to the previous node. Inserting before a node
+// and removing one then walk from the head to find the previous node, so it
+// suits lists that are grown at the ends and walked forwards.
+class DoublyLinked {};
+class SinglyLinked {};
+// Owning lists hold their nodes through shared pointers, allocate them with
+// the allocator and unlink them when cleared, so a node lives on for as long
+// as a Snapshot holds it. NonOwning lists link nodes by plain pointer; the
+// nodes live in storage of the caller's, which must outlive their time in
+// the list. Clearing such a list leaves the links in the nodes as they were.
+class Owning {};
+class NonOwning {};
+
+// The link to the previous node, which singly linked nodes do without.
+template <class Pointer, bool is_present>
+class IntrusivePrevLink {
+protected:
+    Pointer m_prev {};
+};
+template <class Pointer>
+class IntrusivePrevLink<Pointer, false> {};
+
+class IntrusiveNoCount {};
+
+// A linked list whose nodes carry the links next to the value, so that
+// taking a node out of one list and into another moves no value. The
+// policies decide what the list keeps up to date; every one that is left
+// out compiles away rather than being checked at run time.
+//
+// Values that cannot be copy-assigned are copied, where insert_range and
+// clone need it, by an assign_copy(T& to, const T& from) found by ADL.
+template <class T, class Allocator = std::allocator<T>, class... Policies>
+class IntrusiveList {
+    template <class Policy>
+    static constexpr bool has_policy = (std::is_same_v<Policy, Policies> || ...);
+public:
+    static constexpr bool is_counted = !has_policy<NoCount>;
+    static constexpr bool is_doubly_linked = !has_policy<SinglyLinked>;
+    static constexpr bool is_owning = !has_policy<NonOwning>;
+
+    static_assert(!(has_policy<TrackCount> && has_policy<NoCount>), "TrackCount and NoCount exclude each other");
+    static_assert(!(has_policy<DoublyLinked> && has_policy<SinglyLinked>), "DoublyLinked and SinglyLinked exclude each other");
+    static_assert(!(has_policy<Owning> && has_policy<NonOwning>), "Owning and NonOwning exclude each other");
+
+    class Node : private IntrusivePrevLink<std::conditional_t<is_owning, std::shared_ptr<Node>, Node*>, is_doubly_linked> {
+    public:
+        using node_ptr = std::conditional_t<is_owning, std::shared_ptr<Node>, Node*>;
+        using const_node_ptr = std::conditional_t<is_owning, std::shared_ptr<const Node>, const Node*>;
+
+        template<typename... Args>
+        Node(Args&&... args) : m_value(std::forward<Args>(args)...), m_next() {}
+
+        T& value()
+        {
+            return m_value;
+        }
+        const T& cvalue() const
+        {
+            return m_value;
+        }
+        node_ptr get_next() const
+        {
+            return m_next;
+        }
+        node_ptr get_prev() const
+        {
+            static_assert(is_doubly_linked, "a singly linked node has no previous node");
+            return this->m_prev;
+        }
+        // Without touching the reference counts, for traversal.
+        Node* next_node() const
+        {
+            return raw(m_next);
+        }
+        Node* prev_node() const
+        {
+            static_assert(is_doubly_linked, "a singly linked node has no previous node");
+            return raw(this->m_prev);
+        }
+
+        void set_next(node_ptr next)
+        {
+            m_next = std::move(next);
+        }
+        // Does nothing for singly linked nodes, so that the list can link
+        // nodes the same way whatever the policy.
+        void set_prev(node_ptr prev)
+        {
+            if constexpr (is_doubly_linked)
+            {
+                this->m_prev = std::move(prev);
+            }
+        }
+        void disconnect()
+        {
+            set_next(nullptr);
+            set_prev(nullptr);
+        }
+    private:
+        T m_value;
+        node_ptr m_next;
+    };
+
+    using node_ptr = typename Node::node_ptr;
+    using const_node_ptr = typename Node::const_node_ptr;
+    using iterator_category = std::conditional_t<
+        is_doubly_linked,
+        std::bidirectional_iterator_tag,
+        std::forward_iterator_tag
+    >;
+
+    class Iterator {
+    public:
+        using iterator_category = IntrusiveList::iterator_category;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = node_ptr;
+        using pointer           = value_type*;
+        using reference         = value_type&;
+
+        Iterator(value_type ptr) : m_ptr(std::move(ptr)) {}
+
+        reference operator*()
+        {
+            return m_ptr;
+        }
+        pointer operator->()
+        {
+            return &m_ptr;
+        }
+        Iterator& operator++()
+        {
+            m_ptr = m_ptr->get_next();
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator result = *this;
+            ++(*this);
+            return result;
+        }
+        Iterator& operator--()
+        {
+            m_ptr = m_ptr->get_prev();
+            return *this;
+        }
+        Iterator operator--(int)
+        {
+            Iterator result = *this;
+            --(*this);
+            return result;
+        }
+        friend bool operator== (const Iterator& a, const Iterator& b)
+        {
+            return a.m_ptr == b.m_ptr;
+        }
+        friend bool operator!= (const Iterator& a, const Iterator& b)
+        {
+            return !(a == b);
+        }
+
+        friend void swap(Iterator& a, Iterator& b)
+        {
+            std::swap(a.m_ptr, b.m_ptr);
+        }
+    private:
+        value_type m_ptr;
+    };
+
+    class ConstIterator {
+    public:
+        using iterator_category = IntrusiveList::iterator_category;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = const_node_ptr;
+        using pointer           = value_type*;
+        using reference         = value_type&;
+
+        ConstIterator(value_type ptr) : m_ptr(std::move(ptr)) {}
+        ConstIterator(Iterator iter) : m_ptr(*iter) {}
+
+        reference operator*()
+        {
+            return m_ptr;
+        }
+        pointer operator->()
+        {
+            return &m_ptr;
+        }
+        ConstIterator& operator++()
+        {
+            m_ptr = m_ptr->get_next();
+            return *this;
+        }
+        ConstIterator operator++(int)
+        {
+            ConstIterator result = *this;
+            ++(*this);
+            return result;
+        }
+        ConstIterator& operator--()
+        {
+            m_ptr = m_ptr->get_prev();
+            return *this;
+        }
+        ConstIterator operator--(int)
+        {
+            ConstIterator result = *this;
+            --(*this);
+            return result;
+        }
+        friend bool operator== (const ConstIterator& a, const ConstIterator& b)
+        {
+            return a.m_ptr == b.m_ptr;
+        }
+        friend bool operator!= (const ConstIterator& a, const ConstIterator& b)
+        {
+            return !(a == b);
+        }
+
+        friend void swap(ConstIterator& a, ConstIterator& b)
+        {
+            std::swap(a.m_ptr, b.m_ptr);
+        }
+    private:
+        value_type m_ptr;
+    };
+
+    // Iterators over the values rather than the nodes. They hold plain
+    // pointers, so stepping costs no reference counting, and they meet the
+    // iterator requirements of the list's category: begin()/end() work with
+    // range-for, <algorithm> and the parallel algorithms. end() is a null
+    // node tagged with its list, so that it can be stepped back to the tail.
+    class ConstRecordIterator;
+    class RecordIterator {
+    public:
+        using iterator_category = IntrusiveList::iterator_category;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+        using pointer           = value_type*;
+        using reference         = value_type&;
+
+        RecordIterator() : m_node(nullptr), m_list(nullptr) {}
+        RecordIterator(Node* node, const IntrusiveList* list) : m_node(node), m_list(list) {}
+
+        reference operator*() const
+        {
+            return m_node->value();
+        }
+        pointer operator->() const
+        {
+            return &m_node->value();
+        }
+        Node* node() const
+        {
+            return m_node;
+        }
+        RecordIterator& operator++()
+        {
+            m_node = m_node->next_node();
+            return *this;
+        }
+        RecordIterator operator++(int)
+        {
+            RecordIterator result = *this;
+            ++(*this);
+            return result;
+        }
+        RecordIterator& operator--()
+        {
+            m_node = m_node ? m_node->prev_node() : raw(m_list->m_tail);
+            return *this;
+        }
+        RecordIterator operator--(int)
+        {
+            RecordIterator result = *this;
+            --(*this);
+            return result;
+        }
+        friend bool operator== (const RecordIterator& a, const RecordIterator& b)
+        {
+            return a.m_node == b.m_node;
+        }
+        friend bool operator!= (const RecordIterator& a, const RecordIterator& b)
+        {
+            return !(a == b);
+        }
+
+        friend void swap(RecordIterator& a, RecordIterator& b)
+        {
+            std::swap(a.m_node, b.m_node);
+            std::swap(a.m_list, b.m_list);
+        }
+    private:
+        friend class ConstRecordIterator;
+
+        Node* m_node;
+        const IntrusiveList* m_list;
+    };
+
+    class ConstRecordIterator {
+    public:
+        using iterator_category = IntrusiveList::iterator_category;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+        using pointer           = const value_type*;
+        using reference         = const value_type&;
+
+        ConstRecordIterator() : m_node(nullptr), m_list(nullptr) {}
+        ConstRecordIterator(const Node* node, const IntrusiveList* list) : m_node(node), m_list(list) {}
+        ConstRecordIterator(RecordIterator iter) : m_node(iter.m_node), m_list(iter.m_list) {}
+
+        reference operator*() const
+        {
+            return m_node->cvalue();
+        }
+        pointer operator->() const
+        {
+            return &m_node->cvalue();
+        }
+        const Node* node() const
+        {
+            return m_node;
+        }
+        ConstRecordIterator& operator++()
+        {
+            m_node = m_node->next_node();
+            return *this;
+        }
+        ConstRecordIterator operator++(int)
+        {
+            ConstRecordIterator result = *this;
+            ++(*this);
+            return result;
+        }
+        ConstRecordIterator& operator--()
+        {
+            m_node = m_node ? m_node->prev_node() : raw(m_list->m_tail);
+            return *this;
+        }
+        ConstRecordIterator operator--(int)
+        {
+            ConstRecordIterator result = *this;
+            --(*this);
+            return result;
+        }
+        friend bool operator== (const ConstRecordIterator& a, const ConstRecordIterator& b)
+        {
+            return a.m_node == b.m_node;
+        }
+        friend bool operator!= (const ConstRecordIterator& a, const ConstRecordIterator& b)
+        {
+            return !(a == b);
+        }
+
+        friend void swap(ConstRecordIterator& a, ConstRecordIterator& b)
+        {
+            std::swap(a.m_node, b.m_node);
+            std::swap(a.m_list, b.m_list);
+        }
+    private:
+        const Node* m_node;
+        const IntrusiveList* m_list;
+    };
+
+    using Snapshot = std::vector<const_node_ptr>;
+
+    IntrusiveList() :
+        m_head(nullptr),
+        m_tail(nullptr),
+        m_count()
+    {}
+    ~IntrusiveList()
+    {
+        if constexpr (is_owning)
+        {
+            clear();
+        }
+    }
+
+    // Owning nodes link to each other through shared pointers, so two lists
+    // must never share them: copying is explicit through clone(), and moving
+    // hands the nodes over in O(1), leaving the source empty.
+    IntrusiveList(const IntrusiveList& list) = delete;
+    IntrusiveList& operator=(const IntrusiveList& list) = delete;
+    IntrusiveList(IntrusiveList&& list) :
+        m_head(std::exchange(list.m_head, nullptr)),
+        m_tail(std::exchange(list.m_tail, nullptr)),
+        m_count(std::exchange(list.m_count, CountType()))
+    {}
+    IntrusiveList& operator=(IntrusiveList&& list)
+    {
+        if (&list != this)
+        {
+            clear();
+            m_head = std::exchange(list.m_head, nullptr);
+            m_tail = std::exchange(list.m_tail, nullptr);
+            m_count = std::exchange(list.m_count, CountType());
+        }
+        return *this;
+    }
+
+    // A deep copy. Every node is allocated on its own through the allocator
+    // of the list, so a node of the copy that outlives the rest, in a
+    // snapshot or in the undo history, keeps no other record alive.
+    IntrusiveList clone() const
+    {
+        static_assert(is_owning, "only an owning list can allocate a copy");
+
+        IntrusiveList copy {};
+        copy.insert_range(Iterator(nullptr), begin(), end());
+        return copy;
+    }
+
+    RecordIterator begin()
+    {
+        return RecordIterator(raw(m_head), this);
+    }
+    RecordIterator end()
+    {
+        return RecordIterator(nullptr, this);
+    }
+    ConstRecordIterator begin() const
+    {
+        return cbegin();
+    }
+    ConstRecordIterator end() const
+    {
+        return cend();
+    }
+    ConstRecordIterator cbegin() const
+    {
+        return ConstRecordIterator(raw(m_head), this);
+    }
+    ConstRecordIterator cend() const
+    {
+        return ConstRecordIterator(nullptr, this);
+    }
+
+    Iterator head()
+    {
+        return Iterator(m_head);
+    }
+    Iterator tail()
+    {
+        return Iterator(m_tail);
+    }
+
+    ConstIterator chead() const
+    {
+        return ConstIterator((const_node_ptr)m_head);
+    }
+    ConstIterator ctail() const
+    {
+        return ConstIterator((const_node_ptr)m_tail);
+    }
+    // O(1) with TrackCount, a walk over the list with NoCount.
+    std::uintptr_t count() const
+    {
+        if constexpr (is_counted)
+        {
+            return m_count;
+        }
+        else
+        {
+            std::uintptr_t count = 0;
+            for (const Node* node = raw(m_head); node; node = node->next_node())
+            {
+                count++;
+            }
+            return count;
+        }
+    }
+    bool is_empty() const
+    {
+        return !m_head;
+    }
+    bool is_not_empty() const
+    {
+        return !is_empty();
+    }
+
+    Iterator index(std::uintptr_t index)
+    {
+        if constexpr (is_counted)
+        {
+            if (index >= count())
+            {
+                return Iterator(nullptr);
+            }
+        }
+
+        auto iter = head();
+        for (; index != 0 && *iter; index--)
+        {
+            ++iter;
+        }
+        return iter;
+    }
+    template<class UnaryPredicate>
+    Iterator find_if(Iterator first_inclusive, Iterator last_inclusive, UnaryPredicate p)
+    {
+        for (Iterator it = first_inclusive; *it; it++) {
+            if (p(raw(*it)))
+            {
+                return it;
+            }
+            if (it == last_inclusive)
+            {
+                break;
+            }
+        }
+
+        return Iterator(nullptr);
+    }
+    template<typename... Args>
+    Iterator emplace_before(Iterator it, Args&&... args)
+    {
+        return insert_before(it, make_node(std::forward<Args>(args)...));
+    }
+    template<typename... Args>
+    Iterator emplace_after(Iterator it, Args&&... args)
+    {
+        return insert_after(it, make_node(std::forward<Args>(args)...));
+    }
+    // A null it means the end of the list.
+    Iterator insert_before(Iterator it, node_ptr node)
+    {
+        auto next = *it;
+        auto prev = prev_of(raw(next));
+        return insert_internal(node, next, prev);
+    }
+    Iterator insert_after(Iterator it, node_ptr node)
+    {
+        auto prev = *it;
+        auto next = prev ? prev->get_next() : nullptr;
+        return insert_internal(node, next, prev);
+    }
+    void remove(Iterator it)
+    {
+        node_ptr node = *it;
+        if (!node)
+        {
+            return;
+        }
+
+        node_ptr next = node->get_next();
+        node_ptr prev = prev_of(raw(node));
+
+        if (next)
+        {
+            next->set_prev(prev);
+        }
+        else
+        {
+            m_tail = prev;
+        }
+
+        if (prev)
+        {
+            prev->set_next(next);
+        }
+        else
+        {
+            m_head = next;
+        }
+
+        node->disconnect();
+        add_count(-1);
+    }
+    void clear()
+    {
+        // Owning nodes are unlinked one by one: doubly linked ones hold each
+        // other, and a long chain released from its head would recurse.
+        if constexpr (is_owning)
+        {
+            node_ptr node = m_head;
+            while (node)
+            {
+                node_ptr next = node->get_next();
+                node->disconnect();
+                node = next;
+            }
+        }
+
+        m_head = nullptr;
+        m_tail = nullptr;
+        m_count = CountType();
+    }
+
+    // Bulk operations. Positions name the node the new ones go in front of,
+    // a null iterator meaning the end of the list. Each returns the first
+    // inserted node, or it when nothing was inserted.
+    //
+    // Elements of the range are nodes, which are linked in as they are, or
+    // values (T or const nodes, as in a Snapshot), which owning lists copy.
+    // The new nodes are chained together first and attached in one step.
+    template<class InputIt>
+    Iterator insert_range(Iterator it, InputIt first, InputIt last)
+    {
+        node_ptr chain_head = nullptr;
+        node_ptr chain_tail = nullptr;
+        std::uintptr_t chain_count = 0;
+        for (; first != last; ++first)
+        {
+            link_back(chain_head, chain_tail, to_node(*first));
+            chain_count++;
+        }
+        return attach(it, chain_head, chain_tail, chain_count);
+    }
+    // Moves all nodes of other into this list in O(1); other is left empty.
+    Iterator splice(Iterator it, IntrusiveList& other)
+    {
+        if (&other == this || other.is_empty())
+        {
+            return it;
+        }
+        std::uintptr_t range_count = 0;
+        if constexpr (is_counted)
+        {
+            range_count = other.m_count;
+        }
+        node_ptr first = std::exchange(other.m_head, nullptr);
+        node_ptr last = std::exchange(other.m_tail, nullptr);
+        other.m_count = CountType();
+        return attach(it, first, last, range_count);
+    }
+    // Moves first_inclusive..last_inclusive of other. Without range_count the
+    // range is walked once to count it; with it the move is O(1), less the
+    // walk to the node before the range in a singly linked list. other may
+    // be this list as long as it lies outside the range.
+    Iterator splice(Iterator it, IntrusiveList& other, Iterator first_inclusive, Iterator last_inclusive)
+    {
+        if (!*first_inclusive)
+        {
+            return it;
+        }
+
+        std::uintptr_t range_count = 1;
+        for (Iterator range_it = first_inclusive; range_it != last_inclusive; range_it++)
+        {
+            range_count++;
+        }
+        return splice(it, other, first_inclusive, last_inclusive, range_count);
+    }
+    Iterator splice(
+        Iterator it,
+        IntrusiveList& other,
+        Iterator first_inclusive,
+        Iterator last_inclusive,
+        std::uintptr_t range_count
+    )
+    {
+        node_ptr first = *first_inclusive;
+        node_ptr last = *last_inclusive;
+        if (!first)
+        {
+            return it;
+        }
+
+        node_ptr prev = other.prev_of(raw(first));
+        node_ptr next = last->get_next();
+        if (prev)
+        {
+            prev->set_next(next);
+        }
+        else
+        {
+            other.m_head = next;
+        }
+        if (next)
+        {
+            next->set_prev(prev);
+        }
+        else
+        {
+            other.m_tail = prev;
+        }
+        other.add_count(-(std::intptr_t)range_count);
+
+        first->set_prev(nullptr);
+        last->set_next(nullptr);
+        return attach(it, first, last, range_count);
+    }
+    void append(IntrusiveList&& other)
+    {
+        splice(Iterator(nullptr), other);
+    }
+    // Removes every node p holds for in one pass, relinking each run of kept
+    // nodes once. Returns the number of nodes removed.
+    template<class UnaryPredicate>
+    std::uintptr_t erase_if(UnaryPredicate p)
+    {
+        std::uintptr_t erased = 0;
+        node_ptr kept = nullptr;
+        node_ptr node = m_head;
+        while (node)
+        {
+            node_ptr next = node->get_next();
+            if (p(raw(node)))
+            {
+                node->disconnect();
+                erased++;
+            }
+            else
+            {
+                bool is_linked;
+                if constexpr (is_doubly_linked)
+                {
+                    is_linked = node->get_prev() == kept;
+                }
+                else
+                {
+                    is_linked = kept ? kept->next_node() == raw(node) : m_head == node;
+                }
+                if (!is_linked)
+                {
+                    node->set_prev(kept);
+                    if (kept)
+                    {
+                        kept->set_next(node);
+                    }
+                    else
+                    {
+                        m_head = node;
+                    }
+                }
+                kept = node;
+            }
+            node = next;
+        }
+
+        if (kept)
+        {
+            kept->set_next(nullptr);
+        }
+        else
+        {
+            m_head = nullptr;
+        }
+        m_tail = kept;
+        add_count(-(std::intptr_t)erased);
+        return erased;
+    }
+
+    Snapshot snapshot() const
+    {
+        Snapshot snapshot;
+        if constexpr (is_counted)
+        {
+            snapshot.reserve(count());
+        }
+        for (const_node_ptr node = m_head; node; node = node->get_next())
+        {
+            snapshot.push_back(node);
+        }
+        return snapshot;
+    }
+protected:
+    static Node* raw(const node_ptr& node)
+    {
+        if constexpr (is_owning)
+        {
+            return node.get();
+        }
+        else
+        {
+            return node;
+        }
+    }
+
+    static void copy_value(T& to, const T& from)
+    {
+        if constexpr (std::is_copy_assignable_v<T>)
+        {
+            to = from;
+        }
+        else
+        {
+            assign_copy(to, from);
+        }
+    }
+
+    template<typename... Args>
+    static node_ptr make_node(Args&&... args)
+    {
+        static_assert(is_owning, "a non-owning list does not allocate nodes");
+        using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+        return std::allocate_shared<Node>(NodeAllocator(), std::forward<Args>(args)...);
+    }
+    static node_ptr to_node(node_ptr node)
+    {
+        return node;
+    }
+    static node_ptr to_node(const const_node_ptr& node)
+    {
+        return to_node(node->cvalue());
+    }
+    static node_ptr to_node(const T& value)
+    {
+        auto node = make_node();
+        copy_value(node->value(), value);
+        return node;
+    }
+    static void link_back(node_ptr& chain_head, node_ptr& chain_tail, node_ptr node)
+    {
+        node->set_prev(chain_tail);
+        node->set_next(nullptr);
+        if (chain_tail)
+        {
+            chain_tail->set_next(node);
+        }
+        else
+        {
+            chain_head = node;
+        }
+        chain_tail = std::move(node);
+    }
+    Iterator attach(Iterator it, node_ptr chain_head, node_ptr chain_tail, std::uintptr_t chain_count)
+    {
+        if (!chain_head)
+        {
+            return it;
+        }
+
+        node_ptr next = *it;
+        node_ptr prev = prev_of(raw(next));
+        chain_head->set_prev(prev);
+        chain_tail->set_next(next);
+        if (prev)
+        {
+            prev->set_next(chain_head);
+        }
+        else
+        {
+            m_head = chain_head;
+        }
+        if (next)
+        {
+            next->set_prev(chain_tail);
+        }
+        else
+        {
+            m_tail = chain_tail;
+        }
+
+        add_count(chain_count);
+        return Iterator(chain_head);
+    }
+private:
+    using CountType = std::conditional_t<is_counted, std::uintptr_t, IntrusiveNoCount>;
+
+    node_ptr m_head;
+    node_ptr m_tail;
+    CountType m_count;
+
+    void add_count(std::intptr_t delta)
+    {
+        if constexpr (is_counted)
+        {
+            m_count += delta;
+        }
+    }
+    // The node before node, the tail for a null one. A singly linked list
+    // walks from the head to find it.
+    node_ptr prev_of(Node* node) const
+    {
+        if (!node)
+        {
+            return m_tail;
+        }
+        if constexpr (is_doubly_linked)
+        {
+            return node->get_prev();
+        }
+        else
+        {
+            node_ptr prev = nullptr;
+            for (node_ptr it = m_head; it && raw(it) != node; it = it->get_next())
+            {
+                prev = it;
+            }
+            return prev;
+        }
+    }
+    Iterator insert_internal(node_ptr node, node_ptr next, node_ptr prev)
+    {
+        node->set_next(next);
+        node->set_prev(prev);
+
+        if (next)
+        {
+            next->set_prev(node);
+        }
+        else
+        {
+            m_tail = node;
+        }
+
+        if (prev)
+        {
+            prev->set_next(node);
+        }
+        else
+        {
+            m_head = node;
+        }
+
+        add_count(1);
+        return Iterator(node);
+    }
+};
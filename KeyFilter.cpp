@@ -0,0 +1,215 @@
+#include "KeyFilter.hpp"
+#include "Autosave.hpp"
+#include "CatalogIndex.hpp"
+#include "CatalogMerge.hpp"
+#include "Utf8.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+    const char filter_magic[4] = {'H', 'P', 'B', 'F'};
+    const std::uint32_t filter_version = 1;
+
+    class FilterHeader {
+    public:
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t catalog_size;
+        std::int64_t catalog_time;
+    };
+
+    // Fingerprints are not mixed well enough in every bit for probing, so
+    // they go through a finalizer first.
+    std::uint64_t mix(std::uint64_t key)
+    {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ull;
+        key ^= key >> 33;
+        return key;
+    }
+}
+
+KeyFilter::KeyFilter() :
+    KeyFilter(0)
+{}
+
+KeyFilter::KeyFilter(
+    std::uint64_t expected_keys
+) :
+    m_words(),
+    m_block_count(std::max<std::uint64_t>(1, (expected_keys * bits_per_key + 511) / 512)),
+    m_key_count(0)
+{
+    m_words.assign(m_block_count * words_per_block, 0);
+}
+
+KeyFilter KeyFilter::build(const HeadphonesList::Snapshot& snapshot)
+{
+    KeyFilter filter(snapshot.size());
+    for (const auto& node : snapshot)
+    {
+        filter.insert(node->cvalue());
+    }
+    return filter;
+}
+
+void KeyFilter::insert(std::uint64_t key)
+{
+    key = mix(key);
+    auto* block = &m_words[((key >> 32) * m_block_count >> 32) * words_per_block];
+    auto probe = (std::uint32_t)key;
+    auto step = (std::uint32_t)((key * 0x9e3779b97f4a7c15ull) >> 32) | 1;
+    for (std::uint32_t i = 0; i < probe_count; i++, probe += step)
+    {
+        auto bit = probe >> 23;
+        block[bit >> 6] |= std::uint64_t(1) << (bit & 63);
+    }
+    m_key_count++;
+}
+
+void KeyFilter::insert(const Headphones& value)
+{
+    insert(key_fingerprint(value.get_producer_name(), value.get_model_name()));
+}
+
+bool KeyFilter::may_contain(std::uint64_t key) const
+{
+    key = mix(key);
+    const auto* block = &m_words[((key >> 32) * m_block_count >> 32) * words_per_block];
+    auto probe = (std::uint32_t)key;
+    auto step = (std::uint32_t)((key * 0x9e3779b97f4a7c15ull) >> 32) | 1;
+    for (std::uint32_t i = 0; i < probe_count; i++, probe += step)
+    {
+        auto bit = probe >> 23;
+        if (!(block[bit >> 6] & (std::uint64_t(1) << (bit & 63))))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool KeyFilter::may_contain(const std::string& producer, const std::string& model) const
+{
+    return may_contain(key_fingerprint(producer, model));
+}
+
+std::uint64_t KeyFilter::key_count() const
+{
+    return m_key_count;
+}
+
+std::uint64_t KeyFilter::capacity() const
+{
+    return m_block_count * 512 / bits_per_key;
+}
+
+std::uint64_t KeyFilter::byte_size() const
+{
+    return m_words.size() * sizeof(std::uint64_t);
+}
+
+void KeyFilter::write(std::ostream& os) const
+{
+    os.write((const char*)&m_block_count, sizeof(m_block_count));
+    os.write((const char*)&m_key_count, sizeof(m_key_count));
+    os.write((const char*)m_words.data(), m_words.size() * sizeof(std::uint64_t));
+}
+
+std::optional<KeyFilter> KeyFilter::read(std::istream& is)
+{
+    // Block indices are computed in 32 bits.
+    const std::uint64_t max_block_count = std::numeric_limits<std::uint32_t>::max();
+
+    std::uint64_t block_count;
+    std::uint64_t key_count;
+    is.read((char*)&block_count, sizeof(block_count));
+    is.read((char*)&key_count, sizeof(key_count));
+    if (!is || block_count == 0 || block_count > max_block_count)
+    {
+        return std::nullopt;
+    }
+
+    // The blocks must fill the rest of the stream exactly; checked before
+    // allocating, so a damaged count cannot ask for any amount of memory.
+    auto blocks_start = is.tellg();
+    is.seekg(0, std::ios::end);
+    auto blocks_end = is.tellg();
+    is.seekg(blocks_start);
+    if (!is || (std::uint64_t)(blocks_end - blocks_start) != block_count * words_per_block * sizeof(std::uint64_t))
+    {
+        return std::nullopt;
+    }
+
+    KeyFilter filter;
+    filter.m_words.resize(block_count * words_per_block);
+    is.read((char*)filter.m_words.data(), filter.m_words.size() * sizeof(std::uint64_t));
+    if (!is)
+    {
+        return std::nullopt;
+    }
+    filter.m_block_count = block_count;
+    filter.m_key_count = key_count;
+    return filter;
+}
+
+std::string catalog_filter_filename(const std::string& catalog_filename)
+{
+    return catalog_filename + ".bloom";
+}
+
+HeadphonesList::SerializeResult write_catalog_filter(const std::string& catalog_filename, const KeyFilter& filter)
+{
+    auto stamp = catalog_stamp(catalog_filename);
+    if (!stamp)
+    {
+        return HeadphonesList::SerializeError("Не получается построить фильтр каталога.");
+    }
+
+    return write_file_atomically(
+        catalog_filter_filename(catalog_filename),
+        [&](std::ostream& os) -> HeadphonesList::SerializeResult
+        {
+            FilterHeader header {};
+            std::memcpy(header.magic, filter_magic, sizeof(filter_magic));
+            header.version = filter_version;
+            header.catalog_size = stamp->size;
+            header.catalog_time = stamp->time;
+
+            os.write((const char*)&header, sizeof(header));
+            filter.write(os);
+            if (!os)
+            {
+                return HeadphonesList::SerializeError("Ошибка ввода-вывода при записи фильтра каталога");
+            }
+            return std::monostate();
+        }
+    );
+}
+
+std::optional<KeyFilter> read_catalog_filter(const std::string& catalog_filename)
+{
+    auto stamp = catalog_stamp(catalog_filename);
+    std::ifstream file(utf8_path(catalog_filter_filename(catalog_filename)), std::ios::in | std::ios::binary);
+    if (!stamp || !file.is_open())
+    {
+        return std::nullopt;
+    }
+
+    FilterHeader header {};
+    file.read((char*)&header, sizeof(header));
+    if (!file
+        || std::memcmp(header.magic, filter_magic, sizeof(filter_magic)) != 0
+        || header.version != filter_version
+        || header.catalog_size != stamp->size
+        || header.catalog_time != stamp->time)
+    {
+        return std::nullopt;
+    }
+    return KeyFilter::read(file);
+}
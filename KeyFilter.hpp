@@ -0,0 +1,56 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A Bloom filter over key_fingerprint of (producer, model): "no" is always
+// right, "maybe" is wrong about 1% of the time at the sized capacity. The
+// filter is blocked: all probes of a key land in one 64-byte block, so a
+// lookup touches a single cache line.
+//
+// Keys cannot be taken out; a record that is removed or renamed leaves its
+// bits behind, which only adds false positives until the filter is rebuilt.
+class KeyFilter {
+public:
+    static constexpr std::uint32_t bits_per_key = 10;
+    static constexpr std::uint32_t probe_count = 7;
+
+    KeyFilter();
+    // Sized for expected_keys at bits_per_key; it takes more keys, only with a
+    // growing false positive rate.
+    KeyFilter(std::uint64_t expected_keys);
+
+    static KeyFilter build(const HeadphonesList::Snapshot& snapshot);
+
+    void insert(std::uint64_t key);
+    void insert(const Headphones& value);
+    bool may_contain(std::uint64_t key) const;
+    bool may_contain(const std::string& producer, const std::string& model) const;
+
+    std::uint64_t key_count() const;
+    std::uint64_t capacity() const;
+    std::uint64_t byte_size() const;
+
+    void write(std::ostream& os) const;
+    static std::optional<KeyFilter> read(std::istream& is);
+private:
+    static constexpr std::uint32_t words_per_block = 8;
+
+    std::vector<std::uint64_t> m_words;
+    std::uint64_t m_block_count;
+    std::uint64_t m_key_count;
+};
+
+// A sidecar "<catalog>.bloom" holding the filter of a catalog file, so that
+// membership can be checked without loading the catalog. Like the index it
+// remembers the size and write time of the catalog and is ignored once they
+// no longer match.
+std::string catalog_filter_filename(const std::string& catalog_filename);
+// Call once the catalog is in place, since the filter takes its stamp.
+HeadphonesList::SerializeResult write_catalog_filter(const std::string& catalog_filename, const KeyFilter& filter);
+// Nothing when the sidecar is missing, damaged or stale.
+std::optional<KeyFilter> read_catalog_filter(const std::string& catalog_filename);
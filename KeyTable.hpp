@@ -0,0 +1,61 @@
+#pragma once
+#include "Headphones.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Open addressing with linear probing from (producer, model) keys to entries
+// that the caller keeps in a vector of its own, at most two thirds full.
+// Slots carry the key fingerprint, so that a probe past another key touches
+// no entry.
+class KeyTable {
+public:
+    class Slot {
+    public:
+        std::uint64_t fingerprint;
+        // The index of the entry plus one, so that zero marks a free slot.
+        std::uint32_t entry;
+    };
+
+    KeyTable(std::size_t expected) :
+        m_slots(),
+        m_mask(0)
+    {
+        std::size_t capacity = 16;
+        while (capacity < expected + expected / 2)
+        {
+            capacity <<= 1;
+        }
+        m_slots.assign(capacity, Slot {0, 0});
+        m_mask = capacity - 1;
+    }
+
+    static bool has_same_key(const Headphones& a, const Headphones& b)
+    {
+        return a.get_producer_name() == b.get_producer_name() && a.get_model_name() == b.get_model_name();
+    }
+
+    // The slot of the entry with the same key as value, or the free slot
+    // where it belongs, its fingerprint already filled in so that taking it
+    // only needs entry set. record_of(index) gives the record of an entry.
+    template<class RecordOf>
+    Slot& find(std::uint64_t fingerprint, const Headphones& value, RecordOf&& record_of)
+    {
+        for (std::size_t i = (std::size_t)fingerprint & m_mask;; i = (i + 1) & m_mask)
+        {
+            auto& slot = m_slots[i];
+            if (slot.entry == 0)
+            {
+                slot.fingerprint = fingerprint;
+                return slot;
+            }
+            if (slot.fingerprint == fingerprint && has_same_key(record_of(slot.entry - 1), value))
+            {
+                return slot;
+            }
+        }
+    }
+private:
+    std::vector<Slot> m_slots;
+    std::size_t m_mask;
+};
@@ -0,0 +1,298 @@
+#include "LoadGenerator.hpp"
+#include "CatalogProtocol.hpp"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <afunix.h>
+#include <ws2tcpip.h>
+
+LoadGenerator::LoadGenerator(
+    std::string unix_path,
+    std::uint16_t tcp_port
+) :
+    m_unix_path(unix_path),
+    m_tcp_port(tcp_port)
+{}
+
+void LoadGenerator::run(const std::vector<std::size_t>& connection_counts, std::chrono::milliseconds duration)
+{
+    std::uint64_t record_count;
+    if (!request_count(record_count))
+    {
+        std::cout << "Ошибка: не получается получить количество записей от сервера.\n" << std::flush;
+        return;
+    }
+
+    std::cout << "Записей в каталоге сервера: " << record_count << "\n" << std::flush;
+    for (auto connection_count : connection_counts)
+    {
+        run_level(connection_count, duration, record_count);
+    }
+}
+
+SOCKET LoadGenerator::connect_socket() const
+{
+    SOCKET result;
+    int status;
+    if (m_tcp_port != 0)
+    {
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(m_tcp_port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        result = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (result == INVALID_SOCKET)
+        {
+            return INVALID_SOCKET;
+        }
+        BOOL no_delay = 1;
+        setsockopt(result, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+        status = connect(result, (const sockaddr*)&address, sizeof(address));
+    }
+    else
+    {
+        sockaddr_un address {};
+        if (m_unix_path.size() >= sizeof(address.sun_path))
+        {
+            return INVALID_SOCKET;
+        }
+        address.sun_family = AF_UNIX;
+        m_unix_path.copy(address.sun_path, m_unix_path.size());
+        result = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (result == INVALID_SOCKET)
+        {
+            return INVALID_SOCKET;
+        }
+        status = connect(result, (const sockaddr*)&address, sizeof(address));
+    }
+
+    if (status == SOCKET_ERROR)
+    {
+        closesocket(result);
+        return INVALID_SOCKET;
+    }
+    return result;
+}
+
+bool LoadGenerator::request_count(std::uint64_t& count) const
+{
+    SOCKET socket = connect_socket();
+    if (socket == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    PayloadWriter request;
+    request.put_u8((std::uint8_t)CatalogOpcode::Count);
+    std::string output;
+    append_frame(output, request.bytes());
+    if (send(socket, output.data(), (int)output.size(), 0) != (int)output.size())
+    {
+        closesocket(socket);
+        return false;
+    }
+
+    std::string input;
+    std::string response;
+    char buffer[256];
+    while (extract_frame(input.data(), input.size(), response) == 0)
+    {
+        int received = recv(socket, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            closesocket(socket);
+            return false;
+        }
+        input.append(buffer, received);
+    }
+    closesocket(socket);
+
+    PayloadReader reader(response);
+    std::uint8_t status;
+    return reader.get_u8(status)
+        && status == (std::uint8_t)CatalogStatus::Ok
+        && reader.get_u64(count);
+}
+
+void LoadGenerator::run_level(
+    std::size_t connection_count,
+    std::chrono::milliseconds duration,
+    std::uint64_t record_count
+)
+{
+    const int poll_timeout_ms = 10;
+
+    std::vector<Connection> connections;
+    for (std::size_t i = 0; i < connection_count; i++)
+    {
+        SOCKET socket = connect_socket();
+        u_long mode = 1;
+        if (socket == INVALID_SOCKET || ioctlsocket(socket, FIONBIO, &mode) != 0)
+        {
+            if (socket != INVALID_SOCKET)
+            {
+                closesocket(socket);
+            }
+            std::cout << "Ошибка: удалось открыть только " << i << " соединений из " << connection_count << ".\n";
+            break;
+        }
+        Connection connection {};
+        connection.socket = socket;
+        connection.output_offset = 0;
+        connections.push_back(std::move(connection));
+    }
+
+    std::mt19937_64 generator(connection_count);
+    std::uniform_int_distribution<std::uint64_t> index_distribution(0, record_count == 0 ? 0 : record_count - 1);
+    auto send_request = [&](Connection& connection)
+    {
+        PayloadWriter request;
+        if (record_count == 0)
+        {
+            request.put_u8((std::uint8_t)CatalogOpcode::Count);
+        }
+        else
+        {
+            request.put_u8((std::uint8_t)CatalogOpcode::Get);
+            request.put_u64(index_distribution(generator));
+        }
+        append_frame(connection.output, request.bytes());
+        connection.sent_at = std::chrono::steady_clock::now();
+    };
+    for (auto& connection : connections)
+    {
+        send_request(connection);
+    }
+
+    std::vector<std::uint64_t> latencies_us;
+    std::size_t failed = 0;
+    // A connection the server closed or sent garbage on can make no more
+    // progress: its request counts as failed and it leaves the poll set.
+    auto drop = [&failed](Connection& connection)
+    {
+        closesocket(connection.socket);
+        connection.socket = INVALID_SOCKET;
+        failed++;
+    };
+    std::size_t opened_count = connections.size();
+    std::vector<WSAPOLLFD> fds;
+    std::string response;
+    char buffer[64 * 1024];
+    auto started_at = std::chrono::steady_clock::now();
+    auto deadline = started_at + duration;
+    while (std::chrono::steady_clock::now() < deadline && !connections.empty())
+    {
+        fds.clear();
+        for (const auto& connection : connections)
+        {
+            short events = POLLRDNORM;
+            if (connection.output_offset < connection.output.size())
+            {
+                events |= POLLWRNORM;
+            }
+            fds.push_back({connection.socket, events, 0});
+        }
+        if (WSAPoll(fds.data(), (u_long)fds.size(), poll_timeout_ms) <= 0)
+        {
+            continue;
+        }
+
+        for (std::size_t i = 0; i < connections.size(); i++)
+        {
+            auto& connection = connections[i];
+            if (fds[i].revents & POLLWRNORM)
+            {
+                int sent = send(
+                    connection.socket,
+                    connection.output.data() + connection.output_offset,
+                    (int)(connection.output.size() - connection.output_offset),
+                    0
+                );
+                if (sent == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK)
+                {
+                    drop(connection);
+                    continue;
+                }
+                if (sent > 0)
+                {
+                    connection.output_offset += sent;
+                }
+                if (connection.output_offset == connection.output.size())
+                {
+                    connection.output.clear();
+                    connection.output_offset = 0;
+                }
+            }
+            if (!(fds[i].revents & (POLLRDNORM | POLLHUP)))
+            {
+                continue;
+            }
+
+            int received = recv(connection.socket, buffer, sizeof(buffer), 0);
+            if (received == 0 || (received == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK))
+            {
+                drop(connection);
+                continue;
+            }
+            if (received < 0)
+            {
+                continue;
+            }
+            connection.input.append(buffer, received);
+
+            std::size_t frame_size = extract_frame(connection.input.data(), connection.input.size(), response);
+            if (frame_size == SIZE_MAX)
+            {
+                drop(connection);
+                continue;
+            }
+            if (frame_size == 0)
+            {
+                continue;
+            }
+            connection.input.erase(0, frame_size);
+
+            auto now = std::chrono::steady_clock::now();
+            latencies_us.push_back(
+                std::chrono::duration_cast<std::chrono::microseconds>(now - connection.sent_at).count()
+            );
+            if (response.empty() || response[0] != (char)CatalogStatus::Ok)
+            {
+                failed++;
+            }
+            send_request(connection);
+        }
+        connections.erase(
+            std::remove_if(
+                connections.begin(),
+                connections.end(),
+                [](const Connection& connection) { return connection.socket == INVALID_SOCKET; }
+            ),
+            connections.end()
+        );
+    }
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+
+    for (auto& connection : connections)
+    {
+        closesocket(connection.socket);
+    }
+
+    std::cout << "Соединений: " << opened_count;
+    if (latencies_us.empty())
+    {
+        std::cout << ", ответов не получено, ошибок: " << failed << ".\n" << std::flush;
+        return;
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto percentile = [&latencies_us](double fraction)
+    {
+        return latencies_us[(std::size_t)(fraction * (latencies_us.size() - 1))];
+    };
+    std::cout
+        << ", оп/с: " << (std::uint64_t)(latencies_us.size() / elapsed_s)
+        << ", p50: " << percentile(0.50) << " мкс"
+        << ", p99: " << percentile(0.99) << " мкс"
+        << ", ошибок: " << failed << "\n"
+        << std::flush;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <winsock2.h>
+
+// Drives a running CatalogServer with random Get requests from many
+// connections at once and reports throughput and latency percentiles.
+class LoadGenerator {
+public:
+    LoadGenerator(std::string unix_path, std::uint16_t tcp_port);
+
+    void run(const std::vector<std::size_t>& connection_counts, std::chrono::milliseconds duration);
+private:
+    class Connection {
+    public:
+        SOCKET socket;
+        std::string input;
+        std::string output;
+        std::size_t output_offset;
+        std::chrono::steady_clock::time_point sent_at;
+    };
+
+    std::string m_unix_path;
+    std::uint16_t m_tcp_port;
+
+    SOCKET connect_socket() const;
+    bool request_count(std::uint64_t& count) const;
+    void run_level(std::size_t connection_count, std::chrono::milliseconds duration, std::uint64_t record_count);
+};
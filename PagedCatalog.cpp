@@ -0,0 +1,523 @@
+#include "PagedCatalog.hpp"
+#include "Stopwatch.hpp"
+#include "Utf8.hpp"
+#include <filesystem>
+#include <limits>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+    // The store is written in blocks of about this size while loading.
+    const std::size_t store_block_size = 1 << 20;
+}
+
+template<std::size_t... I>
+constexpr std::size_t PagedCatalog::count_paged(std::index_sequence<I...>)
+{
+    using Fields = std::decay_t<decltype(HeadphonesSchema::fields)>;
+    return (std::size_t(0) + ... + (std::size_t)is_paged<std::tuple_element_t<I, Fields>>);
+}
+
+template<class RecordType, class Visitor, std::size_t... I>
+void PagedCatalog::visit_resident_fields(RecordType& record, Visitor& visitor, std::index_sequence<I...>)
+{
+    auto visit = [&](auto index)
+    {
+        constexpr std::size_t i = decltype(index)::value;
+        constexpr std::size_t paged_before = count_paged(std::make_index_sequence<i>());
+        const auto& field = std::get<i>(HeadphonesSchema::fields);
+        if constexpr (is_paged<std::decay_t<decltype(field)>>)
+        {
+            visitor(field, record.sizes[paged_before]);
+        }
+        else
+        {
+            visitor(field, std::get<i - paged_before>(record.values));
+        }
+    };
+    (visit(std::integral_constant<std::size_t, I>()), ...);
+}
+
+template<class RecordType, class Visitor>
+void PagedCatalog::for_each_resident_field(RecordType& record, Visitor&& visitor)
+{
+    visit_resident_fields(record, visitor, std::make_index_sequence<HeadphonesSchema::field_count>());
+}
+
+PagedCatalog::Stats::Stats() :
+    lookups(0),
+    hits(0),
+    page_ins(0),
+    page_in_seconds(0.0),
+    resident_records(0),
+    resident_bytes(0),
+    metadata_bytes(0),
+    budget_bytes(0)
+{}
+
+double PagedCatalog::Stats::hit_rate() const
+{
+    return lookups == 0 ? 0.0 : (double)hits / lookups;
+}
+
+double PagedCatalog::Stats::average_page_in_seconds() const
+{
+    return page_ins == 0 ? 0.0 : page_in_seconds / page_ins;
+}
+
+PagedCatalog::PagedCatalog(
+    std::string store_filename,
+    std::uint64_t budget_bytes
+) :
+    m_store_filename(std::move(store_filename)),
+    m_store(),
+    m_store_size(0),
+    m_records(),
+    m_slots(),
+    m_free_slots(),
+    m_most_recent(no_slot),
+    m_least_recent(no_slot),
+    m_stats()
+{
+    m_stats.budget_bytes = budget_bytes;
+    open_store();
+}
+
+PagedCatalog::~PagedCatalog()
+{
+    m_store.close();
+    std::error_code error;
+    std::filesystem::remove(utf8_path(m_store_filename), error);
+}
+
+PagedCatalog::OpenResult PagedCatalog::load(std::istream& is)
+{
+    const auto store_err = "Не получается создать файл подкачки.";
+    const auto io_err = "Ошибка ввода-вывода при записи файла подкачки.";
+
+    clear_cache();
+    m_records.clear();
+    if (!open_store())
+    {
+        return HeadphonesList::DeserializeError(store_err);
+    }
+
+    std::string block;
+    while (true)
+    {
+        auto result = HeadphonesList::deserialize_record(is);
+        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+        {
+            m_records.clear();
+            return std::get<HeadphonesList::DeserializeError>(result);
+        }
+        auto& node = std::get<HeadphonesList::Node::node_ptr>(result);
+        if (!node)
+        {
+            break;
+        }
+
+        Record record;
+        if (!append_payload(record, node->cvalue(), block))
+        {
+            m_records.clear();
+            return HeadphonesList::DeserializeError(io_err);
+        }
+        m_records.push_back(record);
+    }
+    if (!flush_block(block))
+    {
+        m_records.clear();
+        return HeadphonesList::DeserializeError(io_err);
+    }
+    return std::monostate();
+}
+
+std::uint64_t PagedCatalog::count() const
+{
+    return m_records.size();
+}
+
+PagedCatalog::RecordResult PagedCatalog::get(std::uint64_t index)
+{
+    const auto range_err = "Нет записи с таким номером.";
+    const auto io_err = "Ошибка ввода-вывода при чтении файла подкачки.";
+
+    if (index >= m_records.size())
+    {
+        return HeadphonesList::DeserializeError(range_err);
+    }
+
+    m_stats.lookups++;
+    const auto& record = m_records[index];
+    if (record.slot != no_slot)
+    {
+        m_stats.hits++;
+        unlink(record.slot);
+        link_front(record.slot);
+        return RecordResult(make_record(record, m_slots[record.slot]));
+    }
+
+    auto start = Clock::now();
+    std::string payload;
+    if (!read_payload(record, payload))
+    {
+        return HeadphonesList::DeserializeError(io_err);
+    }
+    m_stats.page_ins++;
+    m_stats.page_in_seconds += seconds_since(start);
+
+    admit(index, payload);
+    return RecordResult(make_record(record, std::move(payload)));
+}
+
+HeadphonesList::SerializeResult PagedCatalog::set(std::uint64_t index, const Headphones& value)
+{
+    const auto range_err = "Нет записи с таким номером.";
+    const auto io_err = "Ошибка ввода-вывода при записи файла подкачки.";
+
+    if (index >= m_records.size())
+    {
+        return HeadphonesList::SerializeError(range_err);
+    }
+
+    // The record is only replaced once its strings are in the store, so that
+    // a failed write leaves it pointing at the old ones.
+    Record updated;
+    std::string block;
+    if (!append_payload(updated, value, block) || !flush_block(block))
+    {
+        return HeadphonesList::SerializeError(io_err);
+    }
+
+    // The cached strings are out of date; the record is paged in afresh.
+    auto& record = m_records[index];
+    if (record.slot != no_slot)
+    {
+        evict(record.slot);
+    }
+    record = updated;
+    return std::monostate();
+}
+
+HeadphonesList::SerializeResult PagedCatalog::push_back(const Headphones& value)
+{
+    const auto io_err = "Ошибка ввода-вывода при записи файла подкачки.";
+
+    Record record;
+    std::string block;
+    if (!append_payload(record, value, block) || !flush_block(block))
+    {
+        return HeadphonesList::SerializeError(io_err);
+    }
+    m_records.push_back(record);
+    return std::monostate();
+}
+
+HeadphonesList::SerializeResult PagedCatalog::serialize(std::ostream& os)
+{
+    const auto io_err = "Ошибка ввода-вывода при записи файла";
+    const auto store_err = "Ошибка ввода-вывода при чтении файла подкачки.";
+
+    std::string block;
+    std::string payload;
+    for (const auto& record : m_records)
+    {
+        if (record.slot != no_slot)
+        {
+            HeadphonesList::serialize_record(block, make_record(record, m_slots[record.slot]));
+        }
+        else
+        {
+            if (!read_payload(record, payload))
+            {
+                return HeadphonesList::SerializeError(store_err);
+            }
+            HeadphonesList::serialize_record(block, make_record(record, payload));
+        }
+
+        if (block.size() >= store_block_size)
+        {
+            os.write(block.data(), block.size());
+            block.clear();
+            if (!os)
+            {
+                return HeadphonesList::SerializeError(io_err);
+            }
+        }
+    }
+    block += HeadphonesList::end_symbol;
+    os.write(block.data(), block.size());
+    if (!os)
+    {
+        return HeadphonesList::SerializeError(io_err);
+    }
+    return std::monostate();
+}
+
+void PagedCatalog::set_budget(std::uint64_t budget_bytes)
+{
+    m_stats.budget_bytes = budget_bytes;
+    evict_to(budget_bytes);
+}
+
+PagedCatalog::Stats PagedCatalog::stats() const
+{
+    auto stats = m_stats;
+    stats.metadata_bytes = m_records.capacity() * sizeof(Record);
+    return stats;
+}
+
+bool PagedCatalog::open_store()
+{
+    m_store.close();
+    m_store.clear();
+    m_store.open(utf8_path(m_store_filename), std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    m_store_size = 0;
+    return m_store.is_open();
+}
+
+bool PagedCatalog::append_payload(Record& record, const Headphones& value, std::string& block)
+{
+    const std::uint64_t max_size = std::numeric_limits<std::uint32_t>::max();
+    bool fits = HeadphonesSchema::all_fields(
+        [&](const auto& field)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            if constexpr (is_paged<Field>)
+            {
+                return Field::get(value).size() <= max_size;
+            }
+            return true;
+        }
+    );
+    if (!fits)
+    {
+        return false;
+    }
+
+    record.offset = m_store_size + block.size();
+    record.slot = no_slot;
+    for_each_resident_field(
+        record,
+        [&](const auto& field, auto& resident)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            if constexpr (is_paged<Field>)
+            {
+                resident = (std::uint32_t)Field::get(value).size();
+                block += Field::get(value);
+            }
+            else
+            {
+                resident = Field::get(value);
+            }
+        }
+    );
+    return block.size() < store_block_size || flush_block(block);
+}
+
+bool PagedCatalog::flush_block(std::string& block)
+{
+    if (block.empty())
+    {
+        return true;
+    }
+    m_store.clear();
+    m_store.seekp((std::streamoff)m_store_size);
+    m_store.write(block.data(), block.size());
+    m_store.flush();
+    if (!m_store)
+    {
+        return false;
+    }
+    m_store_size += block.size();
+    block.clear();
+    return true;
+}
+
+bool PagedCatalog::read_payload(const Record& record, std::string& payload)
+{
+    payload.resize((std::size_t)payload_size(record));
+    m_store.clear();
+    m_store.seekg((std::streamoff)record.offset);
+    m_store.read(payload.data(), payload.size());
+    return (bool)m_store;
+}
+
+std::uint64_t PagedCatalog::payload_size(const Record& record)
+{
+    std::uint64_t size = 0;
+    for_each_resident_field(
+        record,
+        [&size](const auto& field, const auto& resident)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            if constexpr (is_paged<Field>)
+            {
+                size += resident;
+            }
+        }
+    );
+    return size;
+}
+
+std::uint64_t PagedCatalog::cost_of(const Record& record)
+{
+    return sizeof(CacheSlot) + payload_size(record);
+}
+
+void PagedCatalog::admit(std::uint64_t index, std::string payload)
+{
+    auto& record = m_records[index];
+    auto cost = cost_of(record);
+    if (cost > m_stats.budget_bytes)
+    {
+        return;
+    }
+    evict_to(m_stats.budget_bytes - cost);
+
+    std::uint32_t slot;
+    if (!m_free_slots.empty())
+    {
+        slot = m_free_slots.back();
+        m_free_slots.pop_back();
+    }
+    else
+    {
+        slot = (std::uint32_t)m_slots.size();
+        m_slots.emplace_back();
+    }
+
+    auto& cached = m_slots[slot];
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < paged_field_count; i++)
+    {
+        cached.texts[i].assign(payload, offset, record.sizes[i]);
+        offset += record.sizes[i];
+    }
+    cached.record = index;
+    link_front(slot);
+    record.slot = slot;
+    m_stats.resident_records++;
+    m_stats.resident_bytes += cost;
+}
+
+void PagedCatalog::unlink(std::uint32_t slot)
+{
+    auto& cached = m_slots[slot];
+    if (cached.prev != no_slot)
+    {
+        m_slots[cached.prev].next = cached.next;
+    }
+    else
+    {
+        m_most_recent = cached.next;
+    }
+    if (cached.next != no_slot)
+    {
+        m_slots[cached.next].prev = cached.prev;
+    }
+    else
+    {
+        m_least_recent = cached.prev;
+    }
+}
+
+void PagedCatalog::link_front(std::uint32_t slot)
+{
+    auto& cached = m_slots[slot];
+    cached.prev = no_slot;
+    cached.next = m_most_recent;
+    if (m_most_recent != no_slot)
+    {
+        m_slots[m_most_recent].prev = slot;
+    }
+    else
+    {
+        m_least_recent = slot;
+    }
+    m_most_recent = slot;
+}
+
+void PagedCatalog::evict(std::uint32_t slot)
+{
+    unlink(slot);
+    auto& cached = m_slots[slot];
+    auto& record = m_records[cached.record];
+    record.slot = no_slot;
+    m_stats.resident_records--;
+    m_stats.resident_bytes -= cost_of(record);
+
+    // Swapped out rather than cleared, so that the memory is given back.
+    for (auto& text : cached.texts)
+    {
+        std::string().swap(text);
+    }
+    m_free_slots.push_back(slot);
+}
+
+void PagedCatalog::evict_to(std::uint64_t budget_bytes)
+{
+    while (m_stats.resident_bytes > budget_bytes && m_least_recent != no_slot)
+    {
+        evict(m_least_recent);
+    }
+}
+
+void PagedCatalog::clear_cache()
+{
+    evict_to(0);
+    m_slots.clear();
+    m_slots.shrink_to_fit();
+    m_free_slots.clear();
+    m_free_slots.shrink_to_fit();
+}
+
+Headphones PagedCatalog::make_record(const Record& record, const CacheSlot& slot) const
+{
+    Headphones value;
+    std::size_t paged = 0;
+    for_each_resident_field(
+        record,
+        [&](const auto& field, const auto& resident)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            if constexpr (is_paged<Field>)
+            {
+                Field::get(value) = slot.texts[paged++];
+            }
+            else
+            {
+                Field::get(value) = resident;
+            }
+        }
+    );
+    return value;
+}
+
+Headphones PagedCatalog::make_record(const Record& record, const std::string& payload) const
+{
+    Headphones value;
+    std::size_t offset = 0;
+    for_each_resident_field(
+        record,
+        [&](const auto& field, const auto& resident)
+        {
+            using Field = std::decay_t<decltype(field)>;
+            if constexpr (is_paged<Field>)
+            {
+                Field::get(value).assign(payload, offset, resident);
+                offset += resident;
+            }
+            else
+            {
+                Field::get(value) = resident;
+            }
+        }
+    );
+    return value;
+}
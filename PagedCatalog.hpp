@@ -0,0 +1,142 @@
+#pragma once
+#include "Headphones.hpp"
+#include "HeadphonesList.hpp"
+#include "HeadphonesSchema.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// A catalog for machines with less memory than the catalog takes. The fixed
+// size part of every record stays in memory; the text fields of the schema,
+// which make up most of a record, live in a store file and are paged in on
+// access. Paged-in strings are kept in an LRU cache that is held within
+// a byte budget, the least recently used records being dropped first.
+//
+// The store is only ever appended to: an edited record gets its strings
+// written anew and the old copy is left behind, so a cached record is never
+// newer than the store and can be dropped at any time without a write.
+class PagedCatalog {
+public:
+    class Stats {
+    public:
+        std::uint64_t lookups;
+        std::uint64_t hits;
+        std::uint64_t page_ins;
+        double page_in_seconds;
+        std::uint64_t resident_records;
+        // Cached strings together with their bookkeeping.
+        std::uint64_t resident_bytes;
+        // The part that stays in memory whatever the budget.
+        std::uint64_t metadata_bytes;
+        std::uint64_t budget_bytes;
+
+        Stats();
+        double hit_rate() const;
+        double average_page_in_seconds() const;
+    };
+
+    using OpenResult = std::variant<std::monostate, HeadphonesList::DeserializeError>;
+    using RecordResult = std::variant<Headphones, HeadphonesList::DeserializeError>;
+
+    // The store is created afresh and removed with the catalog.
+    PagedCatalog(std::string store_filename, std::uint64_t budget_bytes);
+    ~PagedCatalog();
+
+    PagedCatalog(const PagedCatalog& catalog) = delete;
+    PagedCatalog& operator=(const PagedCatalog& catalog) = delete;
+
+    // Reads a serialized catalog record by record, so that the whole of it is
+    // never in memory at once. Replaces what the catalog held before.
+    OpenResult load(std::istream& is);
+
+    std::uint64_t count() const;
+    // A copy of the record; the cache keeps its own.
+    RecordResult get(std::uint64_t index);
+    HeadphonesList::SerializeResult set(std::uint64_t index, const Headphones& value);
+    HeadphonesList::SerializeResult push_back(const Headphones& value);
+    // Writes the catalog out in the usual format, past the cache.
+    HeadphonesList::SerializeResult serialize(std::ostream& os);
+
+    void set_budget(std::uint64_t budget_bytes);
+    Stats stats() const;
+private:
+    template<class Field>
+    static constexpr bool is_paged = std::is_same_v<typename Field::encoding, TextEncoding>;
+    template<class... Fields>
+    static auto resident_values_of(const std::tuple<Fields...>& fields) -> decltype(std::tuple_cat(
+        std::declval<std::conditional_t<is_paged<Fields>, std::tuple<>, std::tuple<typename Fields::value_type>>>()...
+    ));
+    using ResidentValues = decltype(resident_values_of(HeadphonesSchema::fields));
+    static constexpr std::size_t paged_field_count = HeadphonesSchema::field_count - std::tuple_size_v<ResidentValues>;
+
+    class Record {
+    public:
+        // Where the text fields lie in the store, one after another.
+        std::uint64_t offset;
+        // Sizes of the text fields in the store, in schema order.
+        std::array<std::uint32_t, paged_field_count> sizes;
+        // Cache slot holding the text fields, or no_slot.
+        std::uint32_t slot;
+        // The other fields, in schema order.
+        ResidentValues values;
+    };
+
+    // Slots are linked from the most to the least recently used.
+    class CacheSlot {
+    public:
+        // The text fields, in schema order.
+        std::array<std::string, paged_field_count> texts;
+        std::uint64_t record;
+        std::uint32_t prev;
+        std::uint32_t next;
+    };
+
+    static constexpr std::uint32_t no_slot = 0xFFFFFFFF;
+
+    std::string m_store_filename;
+    std::fstream m_store;
+    std::uint64_t m_store_size;
+    std::vector<Record> m_records;
+
+    std::vector<CacheSlot> m_slots;
+    std::vector<std::uint32_t> m_free_slots;
+    std::uint32_t m_most_recent;
+    std::uint32_t m_least_recent;
+    Stats m_stats;
+
+    bool open_store();
+    // Fills record anew, so that it can be swapped in once the block is in
+    // the store.
+    bool append_payload(Record& record, const Headphones& value, std::string& block);
+    bool flush_block(std::string& block);
+    bool read_payload(const Record& record, std::string& payload);
+
+    // Calls visitor(field, resident) for each field of the schema, resident
+    // being the size of a text field and the value of any other.
+    template<class RecordType, class Visitor>
+    static void for_each_resident_field(RecordType& record, Visitor&& visitor);
+    template<class RecordType, class Visitor, std::size_t... I>
+    static void visit_resident_fields(RecordType& record, Visitor& visitor, std::index_sequence<I...>);
+    template<std::size_t... I>
+    static constexpr std::size_t count_paged(std::index_sequence<I...>);
+
+    static std::uint64_t payload_size(const Record& record);
+    static std::uint64_t cost_of(const Record& record);
+    void admit(std::uint64_t index, std::string payload);
+    void unlink(std::uint32_t slot);
+    void link_front(std::uint32_t slot);
+    void evict(std::uint32_t slot);
+    void evict_to(std::uint64_t budget_bytes);
+    void clear_cache();
+    Headphones make_record(const Record& record, const CacheSlot& slot) const;
+    Headphones make_record(const Record& record, const std::string& payload) const;
+};
@@ -0,0 +1,405 @@
+#include "PartitionedCatalog.hpp"
+#include "Autosave.hpp"
+#include "KeyFilter.hpp"
+#include "PipelinedLoader.hpp"
+#include "Utf8.hpp"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+    const char* manifest_filename = "manifest.txt";
+    const char* manifest_magic = "headphones-catalog";
+    const int manifest_version = 1;
+
+    std::uint64_t fnv1a(const std::string& bytes)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (unsigned char ch : bytes)
+        {
+            hash ^= ch;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+PartitionedCatalog::PartitionedCatalog(
+    std::string directory
+) :
+    m_directory(directory),
+    m_partitions(),
+    m_partition_index(),
+    m_next_segment_id(0)
+{}
+
+const std::string& PartitionedCatalog::directory() const
+{
+    return m_directory;
+}
+
+PartitionedCatalog::OpenResult PartitionedCatalog::open()
+{
+    const auto io_err = "Ошибка ввода-вывода при чтении оглавления каталога.";
+    const auto ill_err = "Оглавление каталога повреждено или записано некорректно.";
+
+    for (auto& partition : m_partitions)
+    {
+        if (partition.list)
+        {
+            partition.list->clear();
+        }
+    }
+    m_partitions.clear();
+    m_partition_index.clear();
+    m_next_segment_id = 0;
+
+    std::ifstream file(utf8_path(path_of(manifest_filename)), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        return std::monostate();
+    }
+
+    std::string magic;
+    int version;
+    std::size_t partition_count;
+    if (!(file >> magic >> version >> m_next_segment_id >> partition_count))
+    {
+        return HeadphonesList::DeserializeError(file.bad() ? io_err : ill_err);
+    }
+    if (magic != manifest_magic || version != manifest_version)
+    {
+        return HeadphonesList::DeserializeError(ill_err);
+    }
+
+    for (std::size_t i = 0; i < partition_count; i++)
+    {
+        Partition partition {};
+        std::size_t producer_length;
+        char delim;
+        if (!(file >> partition.filename >> partition.count >> std::hex >> partition.hash >> std::dec >> producer_length))
+        {
+            return HeadphonesList::DeserializeError(file.bad() ? io_err : ill_err);
+        }
+        if (!file.get(delim) || delim != '|')
+        {
+            return HeadphonesList::DeserializeError(ill_err);
+        }
+        partition.producer.resize(producer_length);
+        if (!file.read(partition.producer.data(), producer_length))
+        {
+            return HeadphonesList::DeserializeError(ill_err);
+        }
+        if (m_partition_index.count(partition.producer) != 0)
+        {
+            return HeadphonesList::DeserializeError(ill_err);
+        }
+
+        m_partition_index.emplace(partition.producer, m_partitions.size());
+        m_partitions.push_back(std::move(partition));
+    }
+
+    return std::monostate();
+}
+
+std::vector<std::string> PartitionedCatalog::producers() const
+{
+    std::vector<std::string> producers;
+    producers.reserve(m_partitions.size());
+    for (const auto& partition : m_partitions)
+    {
+        producers.push_back(partition.producer);
+    }
+    return producers;
+}
+
+std::uintptr_t PartitionedCatalog::count() const
+{
+    std::uintptr_t total = 0;
+    for (const auto& partition : m_partitions)
+    {
+        total += partition.list ? partition.list->count() : partition.count;
+    }
+    return total;
+}
+
+std::uintptr_t PartitionedCatalog::count(const std::string& producer) const
+{
+    auto found = m_partition_index.find(producer);
+    if (found == m_partition_index.end())
+    {
+        return 0;
+    }
+    const auto& partition = m_partitions[found->second];
+    return partition.list ? partition.list->count() : partition.count;
+}
+
+bool PartitionedCatalog::is_loaded(const std::string& producer) const
+{
+    auto found = m_partition_index.find(producer);
+    return found != m_partition_index.end() && m_partitions[found->second].list;
+}
+
+PartitionedCatalog::PartitionResult PartitionedCatalog::partition(const std::string& producer)
+{
+    const auto missing_err = "В каталоге нет записей этого производителя.";
+    const auto open_err = "Не получается открыть файл раздела каталога.";
+
+    auto found = m_partition_index.find(producer);
+    if (found == m_partition_index.end())
+    {
+        return HeadphonesList::DeserializeError(missing_err);
+    }
+
+    auto& partition = m_partitions[found->second];
+    if (partition.list)
+    {
+        return partition.list.get();
+    }
+
+    PipelinedLoader loader(path_of(partition.filename));
+    if (!loader.is_open())
+    {
+        return HeadphonesList::DeserializeError(open_err);
+    }
+
+    auto result = loader.load();
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+    {
+        return std::get<HeadphonesList::DeserializeError>(result);
+    }
+    partition.list = std::make_unique<HeadphonesList>(std::move(std::get<HeadphonesList>(result)));
+    partition.is_dirty = false;
+    return partition.list.get();
+}
+
+void PartitionedCatalog::mark_dirty(const std::string& producer)
+{
+    auto found = m_partition_index.find(producer);
+    if (found != m_partition_index.end() && m_partitions[found->second].list)
+    {
+        m_partitions[found->second].is_dirty = true;
+    }
+}
+
+void PartitionedCatalog::evict_clean()
+{
+    for (auto& partition : m_partitions)
+    {
+        if (partition.list && !partition.is_dirty)
+        {
+            partition.list->clear();
+            partition.list.reset();
+        }
+    }
+}
+
+HeadphonesList::SerializeResult PartitionedCatalog::save()
+{
+    // Records whose producer was edited move to the partition they now belong to.
+    for (std::size_t i = 0; i < m_partitions.size(); i++)
+    {
+        if (!m_partitions[i].list || !m_partitions[i].is_dirty)
+        {
+            continue;
+        }
+
+        std::vector<HeadphonesList::Iterator> moved;
+        auto& list = *m_partitions[i].list;
+        for (auto it = list.head(); *it; it++)
+        {
+            if ((*it)->cvalue().get_producer_name() != m_partitions[i].producer)
+            {
+                moved.push_back(it);
+            }
+        }
+
+        for (auto& it : moved)
+        {
+            auto node = *it;
+            m_partitions[i].list->remove(it);
+
+            std::string producer = node->cvalue().get_producer_name();
+            if (m_partition_index.count(producer) == 0)
+            {
+                add_partition(producer).list = std::make_unique<HeadphonesList>();
+            }
+            auto target = partition(producer);
+            if (std::holds_alternative<HeadphonesList::DeserializeError>(target))
+            {
+                return HeadphonesList::SerializeError(std::get<HeadphonesList::DeserializeError>(target).message);
+            }
+            auto target_list = std::get<HeadphonesList*>(target);
+            target_list->insert_after(target_list->tail(), node);
+            m_partitions[m_partition_index[producer]].is_dirty = true;
+        }
+    }
+
+    std::filesystem::create_directories(utf8_path(m_directory));
+    for (auto& partition : m_partitions)
+    {
+        if (!partition.list || !partition.is_dirty)
+        {
+            continue;
+        }
+        auto result = write_partition(partition, partition.list->snapshot());
+        if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+        {
+            return result;
+        }
+        partition.is_dirty = false;
+    }
+
+    remove_empty_partitions();
+    return write_manifest();
+}
+
+HeadphonesList::SerializeResult PartitionedCatalog::assign(const HeadphonesList& list)
+{
+    std::vector<std::pair<std::string, HeadphonesList::Snapshot>> groups;
+    std::unordered_map<std::string, std::size_t> group_index;
+    for (auto& node : list.snapshot())
+    {
+        const auto& producer = node->cvalue().get_producer_name();
+        auto found = group_index.find(producer);
+        if (found == group_index.end())
+        {
+            found = group_index.emplace(producer, groups.size()).first;
+            groups.emplace_back(producer, HeadphonesList::Snapshot());
+        }
+        groups[found->second].second.push_back(node);
+    }
+
+    for (auto& partition : m_partitions)
+    {
+        if (partition.list)
+        {
+            partition.list->clear();
+            partition.list.reset();
+        }
+        partition.is_dirty = false;
+        if (group_index.count(partition.producer) == 0)
+        {
+            partition.count = 0;
+        }
+    }
+
+    std::filesystem::create_directories(utf8_path(m_directory));
+    for (auto& [producer, snapshot] : groups)
+    {
+        auto found = m_partition_index.find(producer);
+        auto& partition = found == m_partition_index.end()
+            ? add_partition(producer)
+            : m_partitions[found->second];
+        auto result = write_partition(partition, snapshot);
+        if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+        {
+            return result;
+        }
+    }
+
+    remove_empty_partitions();
+    return write_manifest();
+}
+
+std::string PartitionedCatalog::path_of(const std::string& filename) const
+{
+    return (utf8_path(m_directory) / utf8_path(filename)).u8string();
+}
+
+PartitionedCatalog::Partition& PartitionedCatalog::add_partition(const std::string& producer)
+{
+    Partition partition {};
+    partition.producer = producer;
+    partition.filename = "segment-" + std::to_string(m_next_segment_id++) + ".bin";
+    partition.count = 0;
+    partition.hash = 0;
+    partition.is_dirty = false;
+
+    m_partition_index.emplace(producer, m_partitions.size());
+    m_partitions.push_back(std::move(partition));
+    return m_partitions.back();
+}
+
+void PartitionedCatalog::remove_empty_partitions()
+{
+    std::vector<Partition> partitions;
+    partitions.reserve(m_partitions.size());
+    m_partition_index.clear();
+    for (auto& partition : m_partitions)
+    {
+        if (partition.count == 0)
+        {
+            std::error_code ignored;
+            std::filesystem::remove(utf8_path(path_of(partition.filename)), ignored);
+            std::filesystem::remove(utf8_path(catalog_filter_filename(path_of(partition.filename))), ignored);
+            continue;
+        }
+        m_partition_index.emplace(partition.producer, partitions.size());
+        partitions.push_back(std::move(partition));
+    }
+    m_partitions = std::move(partitions);
+}
+
+HeadphonesList::SerializeResult PartitionedCatalog::write_partition(
+    Partition& partition,
+    const HeadphonesList::Snapshot& snapshot
+)
+{
+    std::ostringstream buffer;
+    auto result = HeadphonesList::serialize(buffer, snapshot);
+    if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+    {
+        return result;
+    }
+    std::string bytes = buffer.str();
+    std::uint64_t hash = fnv1a(bytes);
+
+    partition.count = snapshot.size();
+    if (partition.count == 0
+        || (hash == partition.hash && std::filesystem::exists(utf8_path(path_of(partition.filename)))))
+    {
+        return std::monostate();
+    }
+
+    result = write_file_atomically(
+        path_of(partition.filename),
+        [&bytes](std::ostream& os) -> HeadphonesList::SerializeResult
+        {
+            os.write(bytes.data(), bytes.size());
+            return std::monostate();
+        }
+    );
+    if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+    {
+        return result;
+    }
+    partition.hash = hash;
+    write_catalog_filter(path_of(partition.filename), KeyFilter::build(snapshot));
+    return std::monostate();
+}
+
+HeadphonesList::SerializeResult PartitionedCatalog::write_manifest() const
+{
+    std::filesystem::create_directories(utf8_path(m_directory));
+    return write_file_atomically(
+        path_of(manifest_filename),
+        [this](std::ostream& os) -> HeadphonesList::SerializeResult
+        {
+            os << manifest_magic << ' ' << manifest_version << '\n';
+            os << m_next_segment_id << ' ' << m_partitions.size() << '\n';
+            for (const auto& partition : m_partitions)
+            {
+                std::uintptr_t count = partition.list ? partition.list->count() : partition.count;
+                os
+                    << partition.filename << ' '
+                    << count << ' '
+                    << std::hex << partition.hash << std::dec << ' '
+                    << partition.producer.size() << '|' << partition.producer << '\n';
+            }
+            return std::monostate();
+        }
+    );
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+// A catalog stored as a directory with one segment file per producer plus a
+// manifest. Only the manifest is read on open; segments are loaded on first
+// access, can be evicted again and only dirty ones are rewritten on save.
+class PartitionedCatalog {
+public:
+    using OpenResult = std::variant<std::monostate, HeadphonesList::DeserializeError>;
+    using PartitionResult = std::variant<HeadphonesList*, HeadphonesList::DeserializeError>;
+
+    PartitionedCatalog(std::string directory);
+
+    const std::string& directory() const;
+    OpenResult open();
+
+    std::vector<std::string> producers() const;
+    std::uintptr_t count() const;
+    std::uintptr_t count(const std::string& producer) const;
+    bool is_loaded(const std::string& producer) const;
+
+    PartitionResult partition(const std::string& producer);
+    void mark_dirty(const std::string& producer);
+    void evict_clean();
+
+    HeadphonesList::SerializeResult save();
+    HeadphonesList::SerializeResult assign(const HeadphonesList& list);
+private:
+    class Partition {
+    public:
+        std::string producer;
+        std::string filename;
+        std::uintptr_t count;
+        std::uint64_t hash;
+        std::unique_ptr<HeadphonesList> list;
+        bool is_dirty;
+    };
+
+    std::string m_directory;
+    std::vector<Partition> m_partitions;
+    std::unordered_map<std::string, std::size_t> m_partition_index;
+    std::uintptr_t m_next_segment_id;
+
+    std::string path_of(const std::string& filename) const;
+    Partition& add_partition(const std::string& producer);
+    void remove_empty_partitions();
+    HeadphonesList::SerializeResult write_partition(Partition& partition, const HeadphonesList::Snapshot& snapshot);
+    HeadphonesList::SerializeResult write_manifest() const;
+};
@@ -0,0 +1,229 @@
+#include "PersistentList.hpp"
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <random>
+#include <utility>
+
+namespace
+{
+    std::uint32_t next_priority()
+    {
+        static std::minstd_rand generator(0x48503230);
+        return (std::uint32_t)generator();
+    }
+}
+
+PersistentList::TreeNode::TreeNode(
+    value_type value,
+    std::uint32_t priority,
+    tree_ptr left,
+    tree_ptr right
+) :
+    value(value),
+    priority(priority),
+    size(size_of(left) + size_of(right) + 1),
+    left(left),
+    right(right)
+{}
+
+PersistentList::PersistentList() :
+    m_root(nullptr)
+{}
+
+PersistentList::PersistentList(
+    tree_ptr root
+) :
+    m_root(root)
+{}
+
+PersistentList PersistentList::from_list(const HeadphonesList& list)
+{
+    auto nodes = list.snapshot();
+    if (nodes.empty())
+    {
+        return PersistentList();
+    }
+
+    // Lay the nodes out as a perfectly balanced tree and hand out random
+    // priorities in breadth-first order, largest first, so the heap order of
+    // the treap holds without any rotations.
+    std::vector<std::uint32_t> priorities(nodes.size());
+    std::generate(priorities.begin(), priorities.end(), next_priority);
+    std::sort(priorities.begin(), priorities.end(), std::greater<std::uint32_t>());
+
+    std::vector<std::uint32_t> priority_at(nodes.size());
+    std::deque<std::pair<std::size_t, std::size_t>> ranges {{0, nodes.size()}};
+    std::size_t next = 0;
+    while (!ranges.empty())
+    {
+        auto [first, last] = ranges.front();
+        ranges.pop_front();
+        std::size_t middle = first + (last - first) / 2;
+        priority_at[middle] = priorities[next++];
+        if (first < middle)
+        {
+            ranges.emplace_back(first, middle);
+        }
+        if (middle + 1 < last)
+        {
+            ranges.emplace_back(middle + 1, last);
+        }
+    }
+
+    std::function<tree_ptr(std::size_t, std::size_t)> build = [&](std::size_t first, std::size_t last) -> tree_ptr
+    {
+        if (first >= last)
+        {
+            return nullptr;
+        }
+        std::size_t middle = first + (last - first) / 2;
+        return std::make_shared<const TreeNode>(
+            std::const_pointer_cast<HeadphonesList::Node>(nodes[middle]),
+            priority_at[middle],
+            build(first, middle),
+            build(middle + 1, last)
+        );
+    };
+    return PersistentList(build(0, nodes.size()));
+}
+
+std::uintptr_t PersistentList::count() const
+{
+    return size_of(m_root);
+}
+
+bool PersistentList::is_empty() const
+{
+    return count() == 0;
+}
+
+const PersistentList::value_type& PersistentList::at(std::uintptr_t index) const
+{
+    const TreeNode* tree = m_root.get();
+    while (true)
+    {
+        std::uintptr_t left_size = size_of(tree->left);
+        if (index < left_size)
+        {
+            tree = tree->left.get();
+        }
+        else if (index == left_size)
+        {
+            return tree->value;
+        }
+        else
+        {
+            index -= left_size + 1;
+            tree = tree->right.get();
+        }
+    }
+}
+
+HeadphonesList::Snapshot PersistentList::snapshot() const
+{
+    HeadphonesList::Snapshot snapshot;
+    snapshot.reserve(count());
+
+    std::vector<const TreeNode*> stack;
+    const TreeNode* tree = m_root.get();
+    while (tree || !stack.empty())
+    {
+        while (tree)
+        {
+            stack.push_back(tree);
+            tree = tree->left.get();
+        }
+        tree = stack.back();
+        stack.pop_back();
+        snapshot.push_back(tree->value);
+        tree = tree->right.get();
+    }
+    return snapshot;
+}
+
+PersistentList PersistentList::insert(std::uintptr_t index, value_type value) const
+{
+    auto [left, right] = split(m_root, std::min(index, count()));
+    auto node = std::make_shared<const TreeNode>(value, next_priority(), nullptr, nullptr);
+    return PersistentList(merge(merge(left, node), right));
+}
+
+PersistentList PersistentList::set(std::uintptr_t index, value_type value) const
+{
+    if (index >= count())
+    {
+        return *this;
+    }
+    return PersistentList(set_internal(m_root, index, value));
+}
+
+PersistentList PersistentList::remove(std::uintptr_t index) const
+{
+    if (index >= count())
+    {
+        return *this;
+    }
+    auto [left, rest] = split(m_root, index);
+    auto [removed, right] = split(rest, 1);
+    return PersistentList(merge(left, right));
+}
+
+std::uintptr_t PersistentList::size_of(const tree_ptr& tree)
+{
+    return tree ? tree->size : 0;
+}
+
+PersistentList::tree_ptr PersistentList::with_children(const tree_ptr& tree, tree_ptr left, tree_ptr right)
+{
+    return std::make_shared<const TreeNode>(tree->value, tree->priority, left, right);
+}
+
+std::pair<PersistentList::tree_ptr, PersistentList::tree_ptr> PersistentList::split(const tree_ptr& tree, std::uintptr_t count)
+{
+    if (!tree)
+    {
+        return {nullptr, nullptr};
+    }
+
+    std::uintptr_t left_size = size_of(tree->left);
+    if (count <= left_size)
+    {
+        auto [left, right] = split(tree->left, count);
+        return {left, with_children(tree, right, tree->right)};
+    }
+    auto [left, right] = split(tree->right, count - left_size - 1);
+    return {with_children(tree, tree->left, left), right};
+}
+
+PersistentList::tree_ptr PersistentList::merge(const tree_ptr& left, const tree_ptr& right)
+{
+    if (!left)
+    {
+        return right;
+    }
+    if (!right)
+    {
+        return left;
+    }
+
+    if (left->priority > right->priority)
+    {
+        return with_children(left, left->left, merge(left->right, right));
+    }
+    return with_children(right, merge(left, right->left), right->right);
+}
+
+PersistentList::tree_ptr PersistentList::set_internal(const tree_ptr& tree, std::uintptr_t index, value_type value)
+{
+    std::uintptr_t left_size = size_of(tree->left);
+    if (index < left_size)
+    {
+        return with_children(tree, set_internal(tree->left, index, value), tree->right);
+    }
+    if (index > left_size)
+    {
+        return with_children(tree, tree->left, set_internal(tree->right, index - left_size - 1, value));
+    }
+    return std::make_shared<const TreeNode>(value, tree->priority, tree->left, tree->right);
+}
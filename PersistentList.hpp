@@ -0,0 +1,49 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstdint>
+#include <memory>
+
+// Immutable sequence of list nodes. Every modification returns a new version
+// that shares all untouched subtrees with the old one (an implicit treap with
+// path copying), so keeping many versions around costs O(log n) per edit.
+class PersistentList {
+public:
+    using value_type = HeadphonesList::Node::node_ptr;
+
+    PersistentList();
+
+    static PersistentList from_list(const HeadphonesList& list);
+
+    std::uintptr_t count() const;
+    bool is_empty() const;
+    const value_type& at(std::uintptr_t index) const;
+    HeadphonesList::Snapshot snapshot() const;
+
+    PersistentList insert(std::uintptr_t index, value_type value) const;
+    PersistentList set(std::uintptr_t index, value_type value) const;
+    PersistentList remove(std::uintptr_t index) const;
+private:
+    class TreeNode;
+    using tree_ptr = std::shared_ptr<const TreeNode>;
+
+    class TreeNode {
+    public:
+        TreeNode(value_type value, std::uint32_t priority, tree_ptr left, tree_ptr right);
+
+        value_type value;
+        std::uint32_t priority;
+        std::uintptr_t size;
+        tree_ptr left;
+        tree_ptr right;
+    };
+
+    tree_ptr m_root;
+
+    explicit PersistentList(tree_ptr root);
+
+    static std::uintptr_t size_of(const tree_ptr& tree);
+    static tree_ptr with_children(const tree_ptr& tree, tree_ptr left, tree_ptr right);
+    static std::pair<tree_ptr, tree_ptr> split(const tree_ptr& tree, std::uintptr_t count);
+    static tree_ptr merge(const tree_ptr& left, const tree_ptr& right);
+    static tree_ptr set_internal(const tree_ptr& tree, std::uintptr_t index, value_type value);
+};
@@ -0,0 +1,280 @@
+#include "PipelinedLoader.hpp"
+#include "Utf8.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <windows.h>
+
+namespace
+{
+    class Block {
+    public:
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+        // An empty block that is not failed marks the end of the file.
+        bool is_failed;
+    };
+
+    // Lock-free for one producer and one consumer. The reader only advances
+    // m_published and the decoder only m_released, each once it is done with
+    // the block, so no block is ever in the hands of both.
+    class BlockRing {
+    public:
+        BlockRing();
+
+        // Reader side. wait_free returns nullptr once the decoder has stopped.
+        Block* wait_free();
+        void publish();
+
+        // Decoder side.
+        Block& wait_published();
+        void release();
+        void stop();
+    private:
+        std::array<Block, PipelinedLoader::block_count> m_blocks;
+        // Apart, so that the two threads do not share a cache line.
+        alignas(64) std::atomic<std::uint64_t> m_published;
+        alignas(64) std::atomic<std::uint64_t> m_released;
+        std::atomic<bool> m_is_stopping;
+    };
+
+    BlockRing::BlockRing() :
+        m_blocks(),
+        m_published(0),
+        m_released(0),
+        m_is_stopping(false)
+    {
+        for (auto& block : m_blocks)
+        {
+            block.data = std::make_unique<char[]>(PipelinedLoader::block_size);
+            block.size = 0;
+            block.is_failed = false;
+        }
+    }
+
+    Block* BlockRing::wait_free()
+    {
+        auto published = m_published.load(std::memory_order_relaxed);
+        while (published - m_released.load(std::memory_order_acquire) == m_blocks.size())
+        {
+            if (m_is_stopping.load(std::memory_order_relaxed))
+            {
+                return nullptr;
+            }
+            std::this_thread::yield();
+        }
+        return &m_blocks[published % m_blocks.size()];
+    }
+
+    void BlockRing::publish()
+    {
+        m_published.fetch_add(1, std::memory_order_release);
+    }
+
+    Block& BlockRing::wait_published()
+    {
+        auto released = m_released.load(std::memory_order_relaxed);
+        while (m_published.load(std::memory_order_acquire) == released)
+        {
+            std::this_thread::yield();
+        }
+        return m_blocks[released % m_blocks.size()];
+    }
+
+    void BlockRing::release()
+    {
+        m_released.fetch_add(1, std::memory_order_release);
+    }
+
+    void BlockRing::stop()
+    {
+        m_is_stopping.store(true, std::memory_order_relaxed);
+    }
+
+    void read_blocks(HANDLE file, BlockRing& ring)
+    {
+        while (true)
+        {
+            Block* block = ring.wait_free();
+            if (!block)
+            {
+                return;
+            }
+            DWORD read = 0;
+            BOOL is_read = ReadFile(file, block->data.get(), (DWORD)PipelinedLoader::block_size, &read, nullptr);
+            block->size = read;
+            block->is_failed = !is_read;
+            ring.publish();
+            if (!is_read || read == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    // The longest prefix of the block that is well-formed UTF-8 as a whole
+    // and ends on an ASCII byte, so that no character is cut at its end.
+    const char* checked_prefix_end(const char* first, const char* last)
+    {
+        while (last != first && (last[-1] & 0x80))
+        {
+            last--;
+        }
+        return is_valid_utf8(first, (std::size_t)(last - first)) ? last : first;
+    }
+
+    HeadphonesList::DeserializeResult decode_blocks(BlockRing& ring)
+    {
+        const auto io_err = "Ошибка ввода-вывода при чтении файла.";
+        const auto eof_err = "Файл неожиданно обрывается.";
+        // The first bytes of a block taken to finish a split record; the
+        // step doubles, so a record longer than that is still copied once.
+        const std::size_t carry_step = 4096;
+
+        HeadphonesList list {};
+        std::vector<HeadphonesList::Node::node_ptr> batch;
+        // The start of a record split between blocks.
+        std::string carry;
+        std::uint64_t carry_offset = 0;
+        std::uint64_t offset = 0;
+        while (true)
+        {
+            Block& block = ring.wait_published();
+            if (block.is_failed)
+            {
+                return HeadphonesList::DeserializeError(io_err);
+            }
+            if (block.size == 0)
+            {
+                return HeadphonesList::DeserializeError(eof_err);
+            }
+
+            const char* first = block.data.get();
+            const char* it = first;
+            const char* last = first + block.size;
+            const char* checked_until = checked_prefix_end(first, last);
+            bool is_done = false;
+
+            std::size_t taken = 0;
+            while (!carry.empty() && taken < block.size)
+            {
+                std::size_t step = std::min(block.size - taken, std::max(carry.size(), carry_step));
+                carry.append(first + taken, step);
+                taken += step;
+
+                const char* record = carry.data();
+                auto result = HeadphonesList::deserialize_record(
+                    record,
+                    carry.data() + carry.size(),
+                    carry_offset,
+                    carry.data()
+                );
+                if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+                {
+                    return std::get<HeadphonesList::DeserializeError>(result);
+                }
+                if (record == carry.data())
+                {
+                    continue;
+                }
+                auto& node = std::get<HeadphonesList::Node::node_ptr>(result);
+                if (node)
+                {
+                    batch.push_back(std::move(node));
+                }
+                else
+                {
+                    is_done = true;
+                }
+                it = first + taken - (carry.data() + carry.size() - record);
+                carry.clear();
+            }
+
+            while (carry.empty() && !is_done)
+            {
+                const char* record = it;
+                auto result = HeadphonesList::deserialize_record(
+                    it,
+                    last,
+                    offset + (std::uint64_t)(it - first),
+                    checked_until
+                );
+                if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+                {
+                    return std::get<HeadphonesList::DeserializeError>(result);
+                }
+                if (it == record)
+                {
+                    carry.assign(it, last);
+                    carry_offset = offset + (std::uint64_t)(it - first);
+                    break;
+                }
+                auto& node = std::get<HeadphonesList::Node::node_ptr>(result);
+                if (!node)
+                {
+                    is_done = true;
+                    break;
+                }
+                batch.push_back(std::move(node));
+            }
+
+            offset += block.size;
+            ring.release();
+            list.insert_range(HeadphonesList::Iterator(nullptr), batch.begin(), batch.end());
+            batch.clear();
+            if (is_done)
+            {
+                return HeadphonesList::DeserializeResult(std::move(list));
+            }
+        }
+    }
+}
+
+PipelinedLoader::PipelinedLoader(
+    const std::string& filename
+) :
+    m_file(CreateFileW(
+        utf8_path(filename).wstring().c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr
+    ))
+{}
+
+PipelinedLoader::~PipelinedLoader()
+{
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+    }
+}
+
+bool PipelinedLoader::is_open() const
+{
+    return m_file != INVALID_HANDLE_VALUE;
+}
+
+HeadphonesList::DeserializeResult PipelinedLoader::load()
+{
+    const auto open_err = "Не получается открыть файл каталога.";
+
+    if (!is_open())
+    {
+        return HeadphonesList::DeserializeError(open_err);
+    }
+
+    BlockRing ring;
+    std::thread reader(read_blocks, m_file, std::ref(ring));
+    auto result = decode_blocks(ring);
+    ring.stop();
+    reader.join();
+    return result;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstddef>
+#include <string>
+
+// Loads a catalog file with reading and decoding overlapped. An I/O thread
+// reads the file in large blocks into a small ring of buffers, while the
+// loading thread decodes each block as soon as it is published and appends
+// its records to the list, so neither waits on the other for long.
+class PipelinedLoader {
+public:
+    // Blocks of the ring; three are enough for the reader to stay one block
+    // ahead of the decoder while the third is being refilled.
+    static constexpr std::size_t block_size = 1 << 20;
+    static constexpr std::size_t block_count = 3;
+
+    PipelinedLoader(const std::string& filename);
+    ~PipelinedLoader();
+
+    PipelinedLoader(const PipelinedLoader& loader) = delete;
+    PipelinedLoader& operator=(const PipelinedLoader& loader) = delete;
+
+    bool is_open() const;
+    // Reads the catalog from the start; the loader can be used once.
+    HeadphonesList::DeserializeResult load();
+private:
+    void* m_file;
+};
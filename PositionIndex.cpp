@@ -0,0 +1,305 @@
+#include "PositionIndex.hpp"
+#include "CatalogMerge.hpp"
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    std::uint32_t next_priority()
+    {
+        static std::minstd_rand generator(0x50493230);
+        return (std::uint32_t)generator();
+    }
+
+    std::uint64_t key_of(const Headphones& value)
+    {
+        return key_fingerprint(value.get_producer_name(), value.get_model_name());
+    }
+}
+
+PositionIndex::PositionIndex() :
+    m_root(nullptr),
+    m_keys()
+{}
+
+PositionIndex::~PositionIndex()
+{
+    clear();
+}
+
+void PositionIndex::assign(const HeadphonesList::Snapshot& nodes)
+{
+    clear();
+    m_keys.reserve(nodes.size());
+
+    // Entries arrive in order, so the treap is built as a Cartesian tree on
+    // the stack of its right spine. An entry is complete once it is popped,
+    // since everything to its right is attached by then.
+    std::vector<Entry*> spine;
+    for (const auto& node : nodes)
+    {
+        auto* entry = new Entry {node, next_priority(), 1, nullptr, nullptr, nullptr};
+        add_key(entry);
+
+        Entry* last = nullptr;
+        while (!spine.empty() && spine.back()->priority < entry->priority)
+        {
+            last = spine.back();
+            spine.pop_back();
+            update(last);
+        }
+        entry->left = last;
+        if (last)
+        {
+            last->parent = entry;
+        }
+        if (!spine.empty())
+        {
+            spine.back()->right = entry;
+            entry->parent = spine.back();
+        }
+        spine.push_back(entry);
+    }
+    if (!spine.empty())
+    {
+        m_root = spine.front();
+    }
+    while (!spine.empty())
+    {
+        update(spine.back());
+        spine.pop_back();
+    }
+}
+
+void PositionIndex::clear()
+{
+    std::vector<Entry*> pending;
+    if (m_root)
+    {
+        pending.push_back(m_root);
+    }
+    while (!pending.empty())
+    {
+        auto* entry = pending.back();
+        pending.pop_back();
+        if (entry->left)
+        {
+            pending.push_back(entry->left);
+        }
+        if (entry->right)
+        {
+            pending.push_back(entry->right);
+        }
+        delete entry;
+    }
+    m_root = nullptr;
+    m_keys.clear();
+}
+
+std::uintptr_t PositionIndex::count() const
+{
+    return size_of(m_root);
+}
+
+PositionIndex::const_node_ptr PositionIndex::at(std::uintptr_t position) const
+{
+    auto* entry = entry_at(position);
+    return entry ? entry->node : nullptr;
+}
+
+std::optional<std::uintptr_t> PositionIndex::find(const std::string& producer, const std::string& model) const
+{
+    std::optional<std::uintptr_t> found;
+    auto range = m_keys.equal_range(key_fingerprint(producer, model));
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const auto& value = it->second->node->cvalue();
+        if (value.get_producer_name() != producer || value.get_model_name() != model)
+        {
+            continue;
+        }
+        auto position = position_of(it->second);
+        if (!found || position < *found)
+        {
+            found = position;
+        }
+    }
+    return found;
+}
+
+HeadphonesList::Snapshot PositionIndex::snapshot() const
+{
+    HeadphonesList::Snapshot snapshot;
+    snapshot.reserve(count());
+
+    std::vector<const Entry*> stack;
+    const Entry* entry = m_root;
+    while (entry || !stack.empty())
+    {
+        while (entry)
+        {
+            stack.push_back(entry);
+            entry = entry->left;
+        }
+        entry = stack.back();
+        stack.pop_back();
+        snapshot.push_back(entry->node);
+        entry = entry->right;
+    }
+    return snapshot;
+}
+
+void PositionIndex::insert(std::uintptr_t position, const_node_ptr node)
+{
+    auto* entry = new Entry {std::move(node), next_priority(), 1, nullptr, nullptr, nullptr};
+    add_key(entry);
+    auto [left, right] = split(m_root, position);
+    m_root = merge(merge(left, entry), right);
+    m_root->parent = nullptr;
+}
+
+void PositionIndex::set(std::uintptr_t position, const_node_ptr node)
+{
+    auto* entry = entry_at(position);
+    if (!entry)
+    {
+        return;
+    }
+    remove_key(entry);
+    entry->node = std::move(node);
+    add_key(entry);
+}
+
+void PositionIndex::erase(std::uintptr_t position)
+{
+    if (position >= count())
+    {
+        return;
+    }
+    auto [left, rest] = split(m_root, position);
+    auto [erased, right] = split(rest, 1);
+    remove_key(erased);
+    delete erased;
+    m_root = merge(left, right);
+    if (m_root)
+    {
+        m_root->parent = nullptr;
+    }
+}
+
+std::uintptr_t PositionIndex::size_of(const Entry* entry)
+{
+    return entry ? entry->size : 0;
+}
+
+void PositionIndex::update(Entry* entry)
+{
+    entry->size = size_of(entry->left) + size_of(entry->right) + 1;
+}
+
+// The roots returned are detached: their parent is null.
+std::pair<PositionIndex::Entry*, PositionIndex::Entry*> PositionIndex::split(Entry* tree, std::uintptr_t count)
+{
+    if (!tree)
+    {
+        return {nullptr, nullptr};
+    }
+    tree->parent = nullptr;
+    if (size_of(tree->left) >= count)
+    {
+        auto [left, right] = split(tree->left, count);
+        tree->left = right;
+        if (right)
+        {
+            right->parent = tree;
+        }
+        update(tree);
+        return {left, tree};
+    }
+    auto [left, right] = split(tree->right, count - size_of(tree->left) - 1);
+    tree->right = left;
+    if (left)
+    {
+        left->parent = tree;
+    }
+    update(tree);
+    return {tree, right};
+}
+
+PositionIndex::Entry* PositionIndex::merge(Entry* left, Entry* right)
+{
+    if (!left)
+    {
+        return right;
+    }
+    if (!right)
+    {
+        return left;
+    }
+    if (left->priority > right->priority)
+    {
+        left->right = merge(left->right, right);
+        left->right->parent = left;
+        update(left);
+        return left;
+    }
+    right->left = merge(left, right->left);
+    right->left->parent = right;
+    update(right);
+    return right;
+}
+
+std::uintptr_t PositionIndex::position_of(const Entry* entry)
+{
+    std::uintptr_t position = size_of(entry->left);
+    for (; entry->parent; entry = entry->parent)
+    {
+        if (entry == entry->parent->right)
+        {
+            position += size_of(entry->parent->left) + 1;
+        }
+    }
+    return position;
+}
+
+PositionIndex::Entry* PositionIndex::entry_at(std::uintptr_t position) const
+{
+    Entry* entry = m_root;
+    while (entry)
+    {
+        auto left_size = size_of(entry->left);
+        if (position < left_size)
+        {
+            entry = entry->left;
+        }
+        else if (position == left_size)
+        {
+            return entry;
+        }
+        else
+        {
+            position -= left_size + 1;
+            entry = entry->right;
+        }
+    }
+    return nullptr;
+}
+
+void PositionIndex::add_key(Entry* entry)
+{
+    m_keys.emplace(key_of(entry->node->cvalue()), entry);
+}
+
+void PositionIndex::remove_key(Entry* entry)
+{
+    auto range = m_keys.equal_range(key_of(entry->node->cvalue()));
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == entry)
+        {
+            m_keys.erase(it);
+            return;
+        }
+    }
+}
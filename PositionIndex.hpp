@@ -0,0 +1,61 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// The nodes of a list by position, for callers that address records by
+// index: an implicit treap whose entries know their parents, so that both
+// the node at a position and the position of a node take O(log n), and so do
+// insertions and removals anywhere. Entries are also hashed by (producer,
+// model), so that a key is found without a scan.
+class PositionIndex {
+public:
+    using const_node_ptr = HeadphonesList::Node::const_node_ptr;
+
+    PositionIndex();
+    ~PositionIndex();
+
+    PositionIndex(const PositionIndex& index) = delete;
+    PositionIndex& operator=(const PositionIndex& index) = delete;
+
+    // Replaces the contents with nodes, in O(n).
+    void assign(const HeadphonesList::Snapshot& nodes);
+    void clear();
+
+    std::uintptr_t count() const;
+    // nullptr past the end.
+    const_node_ptr at(std::uintptr_t position) const;
+    // The first position holding a record with this key.
+    std::optional<std::uintptr_t> find(const std::string& producer, const std::string& model) const;
+    HeadphonesList::Snapshot snapshot() const;
+
+    void insert(std::uintptr_t position, const_node_ptr node);
+    void set(std::uintptr_t position, const_node_ptr node);
+    void erase(std::uintptr_t position);
+private:
+    class Entry {
+    public:
+        const_node_ptr node;
+        std::uint32_t priority;
+        std::uintptr_t size;
+        Entry* left;
+        Entry* right;
+        Entry* parent;
+    };
+
+    Entry* m_root;
+    // key_fingerprint of each entry's record.
+    std::unordered_multimap<std::uint64_t, Entry*> m_keys;
+
+    static std::uintptr_t size_of(const Entry* entry);
+    static void update(Entry* entry);
+    static std::pair<Entry*, Entry*> split(Entry* tree, std::uintptr_t count);
+    static Entry* merge(Entry* left, Entry* right);
+    static std::uintptr_t position_of(const Entry* entry);
+
+    Entry* entry_at(std::uintptr_t position) const;
+    void add_key(Entry* entry);
+    void remove_key(Entry* entry);
+};
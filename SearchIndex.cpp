@@ -0,0 +1,446 @@
+#include "SearchIndex.hpp"
+#include "Utf8.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace
+{
+    const std::uint32_t no_trie_node = UINT32_MAX;
+
+    // Returns the length of the sequence at s[i], or 0 if it is not valid UTF-8.
+    std::size_t decode_utf8(const std::string& s, std::size_t i, char32_t& code_point)
+    {
+        unsigned char lead = s[i];
+        std::size_t length;
+        if (lead < 0x80)
+        {
+            code_point = lead;
+            return 1;
+        }
+        else if ((lead & 0xE0) == 0xC0)
+        {
+            code_point = lead & 0x1F;
+            length = 2;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            code_point = lead & 0x0F;
+            length = 3;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            code_point = lead & 0x07;
+            length = 4;
+        }
+        else
+        {
+            return 0;
+        }
+
+        if (s.size() - i < length)
+        {
+            return 0;
+        }
+        for (std::size_t k = 1; k < length; k++)
+        {
+            unsigned char ch = s[i + k];
+            if ((ch & 0xC0) != 0x80)
+            {
+                return 0;
+            }
+            code_point = (code_point << 6) | (ch & 0x3F);
+        }
+        return length;
+    }
+
+    char32_t fold_code_point(char32_t code_point)
+    {
+        if (code_point >= U'A' && code_point <= U'Z')
+        {
+            return code_point + 0x20;
+        }
+        if (code_point >= 0xC0 && code_point <= 0xDE && code_point != 0xD7)
+        {
+            return code_point + 0x20;
+        }
+        if (code_point >= 0x410 && code_point <= 0x42F)
+        {
+            return code_point + 0x20;
+        }
+        if (code_point >= 0x400 && code_point <= 0x40F)
+        {
+            return code_point + 0x50;
+        }
+        return code_point;
+    }
+
+    // Folded strings are valid UTF-8 except for copied invalid bytes, which
+    // are treated as single code points of their own.
+    std::vector<char32_t> code_points_of(const std::string& s)
+    {
+        std::vector<char32_t> code_points;
+        code_points.reserve(s.size());
+        for (std::size_t i = 0; i < s.size();)
+        {
+            char32_t code_point;
+            std::size_t length = decode_utf8(s, i, code_point);
+            if (length == 0)
+            {
+                code_point = (unsigned char)s[i];
+                length = 1;
+            }
+            code_points.push_back(code_point);
+            i += length;
+        }
+        return code_points;
+    }
+
+    void append_trigrams(const std::string& folded, std::vector<std::uint64_t>& trigrams)
+    {
+        auto code_points = code_points_of(folded);
+        for (std::size_t i = 0; i + 2 < code_points.size(); i++)
+        {
+            trigrams.push_back(
+                ((std::uint64_t)code_points[i] << 42)
+                | ((std::uint64_t)code_points[i + 1] << 21)
+                | (std::uint64_t)code_points[i + 2]
+            );
+        }
+    }
+}
+
+std::string fold_case(const std::string& utf8)
+{
+    std::string folded;
+    folded.reserve(utf8.size());
+    for (std::size_t i = 0; i < utf8.size();)
+    {
+        char32_t code_point;
+        std::size_t length = decode_utf8(utf8, i, code_point);
+        if (length == 0)
+        {
+            folded += utf8[i];
+            i++;
+            continue;
+        }
+        append_utf8(fold_code_point(code_point), folded);
+        i += length;
+    }
+    return folded;
+}
+
+SearchIndex::SearchIndex() :
+    m_entries(),
+    m_ids(),
+    m_trigrams(),
+    m_trie(1),
+    m_removed_count(0),
+    m_is_built(false)
+{}
+
+bool SearchIndex::is_built() const
+{
+    return m_is_built;
+}
+
+void SearchIndex::build(const HeadphonesList& list)
+{
+    clear();
+    m_is_built = true;
+    auto nodes = list.snapshot();
+    m_entries.reserve(nodes.size());
+    m_ids.reserve(nodes.size());
+    for (const auto& node : nodes)
+    {
+        add_entry(node);
+    }
+}
+
+void SearchIndex::clear()
+{
+    m_entries.clear();
+    m_ids.clear();
+    m_trigrams.clear();
+    m_trie.clear();
+    m_trie.emplace_back();
+    m_removed_count = 0;
+    m_is_built = false;
+}
+
+void SearchIndex::insert(const HeadphonesList::Node::const_node_ptr& node)
+{
+    if (m_is_built)
+    {
+        add_entry(node);
+    }
+}
+
+void SearchIndex::remove(const HeadphonesList::Node* node)
+{
+    if (!m_is_built)
+    {
+        return;
+    }
+    auto found = m_ids.find(node);
+    if (found == m_ids.end())
+    {
+        return;
+    }
+
+    auto id = found->second;
+    auto& entry = m_entries[id];
+    trie_erase(entry.producer_name, id);
+    trie_erase(entry.model_name, id);
+    entry.is_live = false;
+    entry.node = nullptr;
+    m_ids.erase(found);
+
+    // Posting lists are cleaned up lazily; rebuild once dead entries dominate.
+    m_removed_count++;
+    if (m_removed_count > m_ids.size() && m_removed_count > 1024)
+    {
+        compact();
+    }
+}
+
+HeadphonesList::Snapshot SearchIndex::find_substring(const std::string& query, std::size_t limit) const
+{
+    HeadphonesList::Snapshot result;
+    std::string folded_query = fold_case(query);
+
+    std::vector<std::uint64_t> trigrams;
+    append_trigrams(folded_query, trigrams);
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    if (trigrams.empty())
+    {
+        // Too short for trigrams: scan the folded names directly.
+        for (const auto& entry : m_entries)
+        {
+            if (result.size() >= limit)
+            {
+                break;
+            }
+            if (entry.is_live && matches(entry, folded_query))
+            {
+                result.push_back(entry.node);
+            }
+        }
+        return result;
+    }
+
+    std::vector<const std::vector<std::uint32_t>*> postings;
+    for (auto trigram : trigrams)
+    {
+        auto found = m_trigrams.find(trigram);
+        if (found == m_trigrams.end())
+        {
+            return result;
+        }
+        postings.push_back(&found->second);
+    }
+    std::sort(
+        postings.begin(),
+        postings.end(),
+        [](const auto* a, const auto* b) { return a->size() < b->size(); }
+    );
+
+    std::vector<std::uint32_t> candidates = *postings[0];
+    std::vector<std::uint32_t> intersection;
+    for (std::size_t i = 1; i < postings.size() && !candidates.empty(); i++)
+    {
+        intersection.clear();
+        std::set_intersection(
+            candidates.begin(),
+            candidates.end(),
+            postings[i]->begin(),
+            postings[i]->end(),
+            std::back_inserter(intersection)
+        );
+        candidates.swap(intersection);
+    }
+
+    for (auto id : candidates)
+    {
+        if (result.size() >= limit)
+        {
+            break;
+        }
+        const auto& entry = m_entries[id];
+        if (entry.is_live && matches(entry, folded_query))
+        {
+            result.push_back(entry.node);
+        }
+    }
+    return result;
+}
+
+HeadphonesList::Snapshot SearchIndex::find_prefix(const std::string& query, std::size_t limit) const
+{
+    HeadphonesList::Snapshot result;
+    std::uint32_t start = trie_find(fold_case(query));
+    if (start == no_trie_node)
+    {
+        return result;
+    }
+
+    std::unordered_set<std::uint32_t> seen;
+    std::vector<std::uint32_t> stack {start};
+    while (!stack.empty() && result.size() < limit)
+    {
+        const auto& trie_node = m_trie[stack.back()];
+        stack.pop_back();
+        for (auto id : trie_node.ids)
+        {
+            if (result.size() >= limit)
+            {
+                break;
+            }
+            if (seen.insert(id).second)
+            {
+                result.push_back(m_entries[id].node);
+            }
+        }
+        for (auto it = trie_node.children.rbegin(); it != trie_node.children.rend(); it++)
+        {
+            stack.push_back(it->second);
+        }
+    }
+    return result;
+}
+
+HeadphonesList::Snapshot SearchIndex::refine(const HeadphonesList::Snapshot& candidates, const std::string& query) const
+{
+    HeadphonesList::Snapshot result;
+    std::string folded_query = fold_case(query);
+    for (const auto& node : candidates)
+    {
+        auto found = m_ids.find(node.get());
+        if (found != m_ids.end() && matches(m_entries[found->second], folded_query))
+        {
+            result.push_back(node);
+        }
+    }
+    return result;
+}
+
+void SearchIndex::add_entry(const HeadphonesList::Node::const_node_ptr& node)
+{
+    if (m_ids.count(node.get()) != 0)
+    {
+        return;
+    }
+
+    auto id = (std::uint32_t)m_entries.size();
+    Entry entry {};
+    entry.node = node;
+    entry.producer_name = fold_case(node->cvalue().get_producer_name());
+    entry.model_name = fold_case(node->cvalue().get_model_name());
+    entry.is_live = true;
+
+    std::vector<std::uint64_t> trigrams;
+    append_trigrams(entry.producer_name, trigrams);
+    append_trigrams(entry.model_name, trigrams);
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    // Ids only grow, so appending keeps every posting list sorted.
+    for (auto trigram : trigrams)
+    {
+        m_trigrams[trigram].push_back(id);
+    }
+
+    trie_insert(entry.producer_name, id);
+    trie_insert(entry.model_name, id);
+
+    m_ids.emplace(node.get(), id);
+    m_entries.push_back(std::move(entry));
+}
+
+void SearchIndex::trie_insert(const std::string& key, std::uint32_t id)
+{
+    std::uint32_t current = 0;
+    for (unsigned char ch : key)
+    {
+        auto& children = m_trie[current].children;
+        auto it = std::lower_bound(
+            children.begin(),
+            children.end(),
+            ch,
+            [](const auto& edge, unsigned char value) { return edge.first < value; }
+        );
+        if (it != children.end() && it->first == ch)
+        {
+            current = it->second;
+            continue;
+        }
+        auto child = (std::uint32_t)m_trie.size();
+        children.insert(it, {ch, child});
+        m_trie.emplace_back();
+        current = child;
+    }
+
+    auto& ids = m_trie[current].ids;
+    if (ids.empty() || ids.back() != id)
+    {
+        ids.push_back(id);
+    }
+}
+
+void SearchIndex::trie_erase(const std::string& key, std::uint32_t id)
+{
+    std::uint32_t trie_node = trie_find(key);
+    if (trie_node == no_trie_node)
+    {
+        return;
+    }
+    auto& ids = m_trie[trie_node].ids;
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+}
+
+std::uint32_t SearchIndex::trie_find(const std::string& key) const
+{
+    std::uint32_t current = 0;
+    for (unsigned char ch : key)
+    {
+        const auto& children = m_trie[current].children;
+        auto it = std::lower_bound(
+            children.begin(),
+            children.end(),
+            ch,
+            [](const auto& edge, unsigned char value) { return edge.first < value; }
+        );
+        if (it == children.end() || it->first != ch)
+        {
+            return no_trie_node;
+        }
+        current = it->second;
+    }
+    return current;
+}
+
+bool SearchIndex::matches(const Entry& entry, const std::string& folded_query) const
+{
+    return entry.producer_name.find(folded_query) != std::string::npos
+        || entry.model_name.find(folded_query) != std::string::npos;
+}
+
+void SearchIndex::compact()
+{
+    std::vector<HeadphonesList::Node::const_node_ptr> live;
+    live.reserve(m_ids.size());
+    for (const auto& entry : m_entries)
+    {
+        if (entry.is_live)
+        {
+            live.push_back(entry.node);
+        }
+    }
+
+    clear();
+    m_is_built = true;
+    for (const auto& node : live)
+    {
+        add_entry(node);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Lowercases ASCII, Latin-1 and Cyrillic letters of a UTF-8 string. Bytes that
+// are not valid UTF-8 are copied unchanged.
+std::string fold_case(const std::string& utf8);
+
+// Case-insensitive search over producer and model names: a trigram index
+// answers substring queries and a byte trie over the folded names answers
+// prefix queries. The index is built on first use and then kept current
+// through insert/remove as records are edited.
+class SearchIndex {
+public:
+    SearchIndex();
+
+    bool is_built() const;
+    void build(const HeadphonesList& list);
+    void clear();
+
+    void insert(const HeadphonesList::Node::const_node_ptr& node);
+    void remove(const HeadphonesList::Node* node);
+
+    HeadphonesList::Snapshot find_substring(const std::string& query, std::size_t limit) const;
+    HeadphonesList::Snapshot find_prefix(const std::string& query, std::size_t limit) const;
+    // Narrows earlier results to those that also match the longer query, so
+    // type-ahead does not restart the search on every keystroke.
+    HeadphonesList::Snapshot refine(const HeadphonesList::Snapshot& candidates, const std::string& query) const;
+private:
+    class Entry {
+    public:
+        HeadphonesList::Node::const_node_ptr node;
+        std::string producer_name;
+        std::string model_name;
+        bool is_live;
+    };
+
+    class TrieNode {
+    public:
+        std::vector<std::pair<unsigned char, std::uint32_t>> children;
+        std::vector<std::uint32_t> ids;
+    };
+
+    std::vector<Entry> m_entries;
+    std::unordered_map<const HeadphonesList::Node*, std::uint32_t> m_ids;
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> m_trigrams;
+    std::vector<TrieNode> m_trie;
+    std::size_t m_removed_count;
+    bool m_is_built;
+
+    void add_entry(const HeadphonesList::Node::const_node_ptr& node);
+    void trie_insert(const std::string& key, std::uint32_t id);
+    void trie_erase(const std::string& key, std::uint32_t id);
+    std::uint32_t trie_find(const std::string& key) const;
+    bool matches(const Entry& entry, const std::string& folded_query) const;
+    void compact();
+};
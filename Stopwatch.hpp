@@ -0,0 +1,10 @@
+#pragma once
+#include <chrono>
+
+// The clock that reports and benchmarks time their work with.
+using Clock = std::chrono::steady_clock;
+
+inline double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
@@ -0,0 +1,386 @@
+#include "StorageBenchmark.hpp"
+#include "PipelinedLoader.hpp"
+#include "Stopwatch.hpp"
+#include "UnrolledHeadphonesList.hpp"
+#include "Utf8.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+namespace
+{
+    // Scans are repeated so that each measures at least this many records.
+    const std::size_t scanned_records = 20000000;
+
+    // Bytes handed out by CountingAllocator and not yet taken back.
+    std::size_t allocated_bytes = 0;
+
+    // Weighs the nodes of an owning list.
+    template<class T>
+    class CountingAllocator {
+    public:
+        using value_type = T;
+
+        CountingAllocator() = default;
+        template<class U>
+        CountingAllocator(const CountingAllocator<U>&) {}
+
+        T* allocate(std::size_t count)
+        {
+            allocated_bytes += count * sizeof(T);
+            return std::allocator<T>().allocate(count);
+        }
+        void deallocate(T* pointer, std::size_t count)
+        {
+            allocated_bytes -= count * sizeof(T);
+            std::allocator<T>().deallocate(pointer, count);
+        }
+
+        friend bool operator== (const CountingAllocator&, const CountingAllocator&)
+        {
+            return true;
+        }
+        friend bool operator!= (const CountingAllocator&, const CountingAllocator&)
+        {
+            return false;
+        }
+    };
+
+    // Short enough for the strings to stay inside Headphones, so that the
+    // bytes counted are those of the storage alone.
+    std::string model_name(std::size_t i)
+    {
+        return "M" + std::to_string(i % 100000);
+    }
+
+    template<class Range>
+    double scan(const Range& records, std::size_t record_count, double& checksum)
+    {
+        std::size_t passes = std::max<std::size_t>(1, scanned_records / std::max<std::size_t>(1, record_count));
+        auto start = Clock::now();
+        for (std::size_t pass = 0; pass < passes; pass++)
+        {
+            for (const auto& value : records)
+            {
+                checksum += value.get_volume();
+            }
+        }
+        return seconds_since(start) * 1e9 / (passes * record_count);
+    }
+
+    // Builds a list of record_count records with the policies of List, then
+    // times a full scan, count() and removing every other record. Lists
+    // that do not own their nodes link them from one array.
+    template<class List>
+    void run_policy(const char* name, std::size_t record_count)
+    {
+        using Node = typename List::Node;
+        std::unique_ptr<Node[]> storage;
+        List list;
+
+        auto start = Clock::now();
+        if constexpr (List::is_owning)
+        {
+            for (std::size_t i = 0; i < record_count; i++)
+            {
+                list.emplace_after(list.tail(), "P", model_name(i), "100", (double)(i % 100), false, false, EqualizerMode::Normal);
+            }
+        }
+        else
+        {
+            storage.reset(new Node[record_count]);
+            for (std::size_t i = 0; i < record_count; i++)
+            {
+                storage[i].value() = Headphones("P", model_name(i), "100", (double)(i % 100), false, false, EqualizerMode::Normal);
+                list.insert_before(typename List::Iterator(nullptr), &storage[i]);
+            }
+        }
+        double build_ns = seconds_since(start) * 1e9 / record_count;
+
+        double checksum = 0.0;
+        double scan_ns = scan(list, record_count, checksum);
+
+        start = Clock::now();
+        auto count = list.count();
+        double count_us = seconds_since(start) * 1e6;
+
+        start = Clock::now();
+        list.erase_if([](const Node* node) { return (int)node->cvalue().get_volume() % 2 != 0; });
+        double erase_ns = seconds_since(start) * 1e9 / record_count;
+
+        std::cout
+            << "  " << name << ": узел " << sizeof(Node) << " байт"
+            << ", вставка " << build_ns << " нс"
+            << ", обход " << scan_ns << " нс"
+            << ", удаление " << erase_ns << " нс на запись"
+            << ", count() " << count_us << " мкс\n"
+            << std::flush;
+        // Keeps the scan and the count from being optimized away.
+        if (checksum < 0.0 || count != record_count)
+        {
+            std::cout << checksum << "\n";
+        }
+    }
+
+    bool report(const char* name, bool is_passed)
+    {
+        std::cout << "Проверка: " << name << (is_passed ? " - да\n" : " - НЕТ\n") << std::flush;
+        return is_passed;
+    }
+
+    // UnrolledHeadphonesList walks by ConstIterator and has no begin/end.
+    class UnrolledRange {
+    public:
+        const UnrolledHeadphonesList& list;
+
+        UnrolledHeadphonesList::ConstIterator begin() const
+        {
+            return list.chead();
+        }
+        UnrolledHeadphonesList::ConstIterator end() const
+        {
+            return UnrolledHeadphonesList::ConstIterator(nullptr);
+        }
+    };
+}
+
+StorageBenchmark::StorageBenchmark(
+    std::size_t record_count
+) :
+    m_record_count(record_count)
+{}
+
+bool StorageBenchmark::run()
+{
+    std::cout << "Записей: " << m_record_count << "\n" << std::flush;
+    run_scan();
+    run_memory();
+    run_policies();
+    return run_load();
+}
+
+bool StorageBenchmark::check()
+{
+    bool is_passed = check_clone();
+    is_passed = check_move() && is_passed;
+    is_passed = check_destroy() && is_passed;
+    return is_passed;
+}
+
+// A list read from a file has its nodes in memory in list order; one that
+// was edited for a while has them scattered. Shuffling the links of freshly
+// allocated nodes stands in for the latter.
+HeadphonesList StorageBenchmark::make_list(bool is_shuffled) const
+{
+    std::vector<HeadphonesList::node_ptr> nodes;
+    nodes.reserve(m_record_count);
+    for (std::size_t i = 0; i < m_record_count; i++)
+    {
+        nodes.push_back(std::make_shared<HeadphonesList::Node>(
+            "P", model_name(i), "100", (double)(i % 100), false, false, EqualizerMode::Normal
+        ));
+    }
+    if (is_shuffled)
+    {
+        std::shuffle(nodes.begin(), nodes.end(), std::minstd_rand(0x5354));
+    }
+
+    HeadphonesList list;
+    list.insert_range(HeadphonesList::Iterator(nullptr), nodes.begin(), nodes.end());
+    return list;
+}
+
+void StorageBenchmark::run_scan()
+{
+    double checksum = 0.0;
+    for (bool is_shuffled : {false, true})
+    {
+        auto list = make_list(is_shuffled);
+        auto unrolled = UnrolledHeadphonesList::from_list(list);
+        double list_ns = scan(list, m_record_count, checksum);
+        double unrolled_ns = scan(UnrolledRange {unrolled}, m_record_count, checksum);
+        std::cout
+            << "Полный обход, " << (is_shuffled ? "узлы вразброс" : "узлы подряд")
+            << ", нс на запись: список " << list_ns
+            << ", развёрнутый список " << unrolled_ns
+            << ", отношение " << list_ns / unrolled_ns << "\n"
+            << std::flush;
+    }
+    // Keeps the scans from being optimized away.
+    if (checksum < 0.0)
+    {
+        std::cout << checksum << "\n";
+    }
+}
+
+void StorageBenchmark::run_memory()
+{
+    // The same nodes as HeadphonesList, allocated through the counter.
+    std::size_t before = allocated_bytes;
+    IntrusiveList<Headphones, CountingAllocator<Headphones>> list;
+    for (std::size_t i = 0; i < m_record_count; i++)
+    {
+        list.emplace_after(list.tail(), "P", model_name(i), "100", 1.0, false, false, EqualizerMode::Normal);
+    }
+    double list_bytes = (double)(allocated_bytes - before) / m_record_count;
+
+    auto unrolled = UnrolledHeadphonesList::from_list(make_list(false));
+    double unrolled_bytes = (double)unrolled.memory_usage() / m_record_count;
+    std::cout
+        << "Байт на запись сверх строк: список " << list_bytes
+        << ", развёрнутый список " << unrolled_bytes
+        << ", сама запись " << sizeof(Headphones) << "\n"
+        << std::flush;
+}
+
+void StorageBenchmark::run_policies()
+{
+    using Allocator = std::allocator<Headphones>;
+
+    std::cout << "Политики IntrusiveList:\n" << std::flush;
+    run_policy<HeadphonesList>("HeadphonesList", m_record_count);
+    run_policy<IntrusiveList<Headphones, Allocator, NoCount>>("NoCount", m_record_count);
+    run_policy<IntrusiveList<Headphones, Allocator, SinglyLinked>>("SinglyLinked", m_record_count);
+    run_policy<IntrusiveList<Headphones, Allocator, NonOwning>>("NonOwning", m_record_count);
+    run_policy<IntrusiveList<Headphones, Allocator, NoCount, SinglyLinked, NonOwning>>("NoCount, SinglyLinked, NonOwning", m_record_count);
+}
+
+bool StorageBenchmark::run_load()
+{
+    const char* filename = "storage-bench.bin";
+    std::error_code ignored;
+    auto fail = [&](const std::string& message)
+    {
+        std::filesystem::remove(utf8_path(filename), ignored);
+        std::cout << "Ошибка: \"" << message << "\".\n" << std::flush;
+        return false;
+    };
+
+    {
+        auto list = make_list(false);
+        std::ofstream os(utf8_path(filename), std::ios::binary);
+        auto result = list.serialize(os);
+        if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+        {
+            return fail(std::get<HeadphonesList::SerializeError>(result).message);
+        }
+        os.close();
+        if (os.fail())
+        {
+            return fail("Ошибка ввода-вывода при записи файла");
+        }
+    }
+    std::ifstream probe(utf8_path(filename), std::ios::binary | std::ios::ate);
+    double megabytes = (double)probe.tellg() / (1 << 20);
+    probe.close();
+
+    HeadphonesList list;
+    auto start = Clock::now();
+    {
+        std::ifstream is(utf8_path(filename), std::ios::binary);
+        auto result = HeadphonesList::deserialize(is);
+        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+        {
+            return fail(std::get<HeadphonesList::DeserializeError>(result).message);
+        }
+        list = std::move(std::get<HeadphonesList>(result));
+    }
+    double stream_seconds = seconds_since(start);
+
+    start = Clock::now();
+    {
+        PipelinedLoader loader(filename);
+        auto result = loader.load();
+        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+        {
+            return fail(std::get<HeadphonesList::DeserializeError>(result).message);
+        }
+        list = std::move(std::get<HeadphonesList>(result));
+    }
+    double pipelined_seconds = seconds_since(start);
+
+    start = Clock::now();
+    auto copy = list.clone();
+    double clone_seconds = seconds_since(start);
+
+    start = Clock::now();
+    HeadphonesList moved = std::move(copy);
+    double move_seconds = seconds_since(start);
+    std::filesystem::remove(utf8_path(filename), ignored);
+
+    std::cout
+        << "Загрузка файла " << megabytes << " МБ, записей: " << moved.count() << "\n"
+        << "  из потока: " << stream_seconds * 1000 << " мс, " << megabytes / stream_seconds << " МБ/с\n"
+        << "  конвейером: " << pipelined_seconds * 1000 << " мс, " << megabytes / pipelined_seconds << " МБ/с\n"
+        << "  копия списка: " << clone_seconds * 1000 << " мс, перенос: " << move_seconds * 1e9 << " нс\n"
+        << std::flush;    return true;
+}
+
+bool StorageBenchmark::check_clone()
+{
+    auto list = make_list(false);
+    auto copy = list.clone();
+
+    bool shares_nodes = false;
+    auto it = list.chead();
+    for (auto copy_it = copy.chead(); *it && *copy_it; it++, copy_it++)
+    {
+        shares_nodes = shares_nodes || *it == *copy_it;
+    }
+    bool is_equal = list.count() == copy.count();
+
+    (*copy.head())->value().set_price("0");
+    copy.remove(copy.tail());
+    bool is_independent = (*list.head())->cvalue().get_price() == "100" && list.count() == m_record_count;
+
+    return report("копия не делит узлы с исходным списком", is_equal && !shares_nodes && is_independent);
+}
+
+bool StorageBenchmark::check_move()
+{
+    auto list = make_list(false);
+    HeadphonesList moved = std::move(list);
+    bool is_constructed = list.is_empty() && !*list.chead() && moved.count() == m_record_count;
+
+    HeadphonesList assigned = make_list(false);
+    assigned = std::move(moved);
+    bool is_assigned = moved.is_empty() && !*moved.chead() && assigned.count() == m_record_count;
+
+    return report("список после переноса пуст", is_constructed && is_assigned);
+}
+
+bool StorageBenchmark::check_destroy()
+{
+    std::vector<std::weak_ptr<const HeadphonesList::Node>> nodes;
+    std::size_t before = allocated_bytes;
+    {
+        auto list = make_list(true);
+        auto copy = list.clone();
+        for (const auto& node : list.snapshot())
+        {
+            nodes.push_back(node);
+        }
+        for (const auto& node : copy.snapshot())
+        {
+            nodes.push_back(node);
+        }
+
+        IntrusiveList<Headphones, CountingAllocator<Headphones>> counted;
+        for (std::size_t i = 0; i < m_record_count; i++)
+        {
+            counted.emplace_after(counted.tail(), "P", model_name(i), "100", 1.0, false, false, EqualizerMode::Normal);
+        }
+    }
+    bool is_freed = allocated_bytes == before
+        && std::all_of(nodes.begin(), nodes.end(), [](const auto& node) { return node.expired(); });
+
+    return report("узлы освобождаются вместе со списком", is_freed);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include <cstddef>
+
+// Compares the ways the program can hold records in memory: the node list
+// that everything is written against and the unrolled list, by how fast a
+// full scan goes and how many bytes each record costs beyond its strings;
+// HeadphonesList against the lighter policies of IntrusiveList; and times
+// loading a catalog file into a list.
+class StorageBenchmark {
+public:
+    StorageBenchmark(std::size_t record_count);
+
+    // Returns false if the catalog file could not be written or read back.
+    bool run();
+    // Checks that lists own their nodes: a clone shares nothing with its
+    // source, a moved-from list is empty and a destroyed list frees its
+    // nodes. Returns whether every check passed.
+    bool check();
+private:
+    std::size_t m_record_count;
+
+    HeadphonesList make_list(bool is_shuffled) const;
+    void run_scan();
+    void run_memory();
+    void run_policies();
+    bool run_load();
+    bool check_clone();
+    bool check_move();
+    bool check_destroy();
+};
@@ -1,33 +1,51 @@
 #include "TextMenu.hpp"
 #include "HeadphonesList.hpp"
+#include "HeadphonesSchema.hpp"
+#include "Autosave.hpp"
+#include "CatalogAggregate.hpp"
+#include "CatalogDelta.hpp"
+#include "CatalogExchange.hpp"
+#include "CatalogIndex.hpp"
+#include "CatalogMerge.hpp"
+#include "CatalogUpsert.hpp"
+#include "CatalogWorkspace.hpp"
+#include "UndoHistory.hpp"
+#include "PagedCatalog.hpp"
+#include "PartitionedCatalog.hpp"
+#include "PipelinedLoader.hpp"
+#include "SearchIndex.hpp"
+#include "Utf8.hpp"
 #include "fstream"
 #include "sstream"
 #include "cctype"
 #include "cassert"
 #include "cstdlib"
 
-#include <codecvt>
-#include <locale>
 #include <windows.h>
 #include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
 
-int get_input_digit(int max_inclusive)
+int get_input_number(int max_inclusive)
 {
     std::string buffer;
     while (true)
     {
         std::cout << "Пожалуйста введите число от 1 до " << max_inclusive << ": " << std::flush;
         std::getline(std::cin, buffer);
-        if (buffer.empty())
+        if (buffer.empty() || !std::isdigit((unsigned char)buffer[0]))
         {
             continue;
         }
-        char ch = buffer[0];
-        if (!std::isdigit(ch))
+        int num = 0;
+        for (std::size_t i = 0; i < buffer.size() && std::isdigit((unsigned char)buffer[i]) && num <= max_inclusive; i++)
         {
-            continue;
+            num = num * 10 + (buffer[i] - '0');
         }
-        int num = ch - '0';
         if (num == 0 || num > max_inclusive)
         {
             continue;
@@ -36,185 +54,184 @@ int get_input_digit(int max_inclusive)
     }
 }
 
-std::string слава_сатане()
+void append_utf16_as_utf8(const std::wstring& utf16, std::string& out)
+{
+    for (std::size_t i = 0; i < utf16.size(); i++)
+    {
+        std::uint32_t code_point = (std::uint16_t)utf16[i];
+        if (code_point >= 0xD800 && code_point <= 0xDBFF && i + 1 < utf16.size())
+        {
+            std::uint32_t low = (std::uint16_t)utf16[i + 1];
+            if (low >= 0xDC00 && low <= 0xDFFF)
+            {
+                code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+
+        // Unpaired surrogates are encoded as they are, so that the validator
+        // rejects them instead of them being silently replaced.
+        append_utf8(code_point, out);
+    }
+}
+
+// The console only hands out UTF-16, so it is read in chunks until the line
+// ends; redirected input already is a byte stream and is taken as it is.
+std::string read_raw_line()
 {
-    const DWORD length = 100;
-    wchar_t wmsg[length];
+    HANDLE input = GetStdHandle(STD_INPUT_HANDLE);
+    DWORD mode;
+    std::string line;
+    if (!GetConsoleMode(input, &mode))
+    {
+        std::getline(std::cin, line);
+        return line;
+    }
+
+    std::wstring wline;
+    wchar_t chunk[256];
     DWORD used;
-    if (!ReadConsole(
-            GetStdHandle(STD_INPUT_HANDLE),
-            wmsg,
-            length - 1,
-            &used,
-            nullptr
-        )
-    )
+    while (ReadConsoleW(input, chunk, sizeof(chunk) / sizeof(chunk[0]), &used, nullptr) && used != 0)
     {
-        return "INTERFACING [Impossible: Success] - I'm afraid there is truly noting we can do to make the utf-8 output work, sir.";
+        wline.append(chunk, used);
+        if (wline.back() == L'\n')
+        {
+            break;
+        }
     }
+    append_utf16_as_utf8(wline, line);
+    return line;
+}
 
-    std::wstring wstr(wmsg);
-    wstr.resize(used);
+std::string read_utf8_line()
+{
+    while (true)
+    {
+        std::string line = read_raw_line();
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+        {
+            line.pop_back();
+        }
 
-    wstr.erase(
-        std::remove_if(
-            wstr.begin(),
-            wstr.end(),
-            [](wchar_t c)
-            {
-                return c == L'\n' || c == L'\r';
-            }
-        ),
-        wstr.end()
-    );
-    std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
-    std::string str = converter.to_bytes(wstr);
+        auto offset = find_invalid_utf8(line);
+        if (!offset)
+        {
+            return line;
+        }
+        std::cout
+            << "Ошибка: некорректная последовательность UTF-8 в байте " << *offset + 1
+            << ". Повторите ввод: " << std::flush;
+    }
+}
 
-    return str;
+HeadphonesList::Node::node_ptr copy_node(const HeadphonesList::Node& node)
+{
+    auto copy = std::make_shared<HeadphonesList::Node>();
+    HeadphonesSchema::assign(copy->value(), node.cvalue());
+    return copy;
 }
 
 void generate_new_entry(HeadphonesList::Node& node)
 {
     auto& value = node.value();
-    std::string buffer;
-    double volume_tmp;
+    const int done_choice = (int)HeadphonesSchema::field_count + 1;
     while (true)
     {
         std::cout
             << "\n"
             << "[Это конструктор записи]\n"
             << value
-            << "Какое поле изменить:\n"
-            << "  1) Производитель.\n"
-            << "  2) Название модели.\n"
-            << "  3) Цена.\n"
-            << "  4) Громкость.\n"
-            << "  5) Шумоподавление (Переключить).\n"
-            << "  6) Микрофон (Переключить).\n"
-            << "  7) Режим эквалайзера.\n"
-            << "  8) Готово.\n"
-            << std::flush;
-        switch (get_input_digit(8))
-        {
-        case 1:
-            std::cout << "Введите название производителя: " << std::flush;
-            // std::getline(std::cin, buffer);
-            buffer = слава_сатане();
-            value.set_producer_name(buffer);
-            break;
-        case 2:
-            std::cout << "Введите название модели: " << std::flush;
-            // std::getline(std::cin, buffer);
-            buffer = слава_сатане();
-            value.set_model_name(buffer);
-            break;
-        case 3:
-            std::cout << "Введите цену: " << std::flush;
-            // std::getline(std::cin, buffer);
-            buffer = слава_сатане();
-            value.set_price(buffer);
-            break;
-        case 4:
-            std::cout << "Введите громкость: " << std::flush;
-            std::getline(std::cin, buffer);
-
-            try
-            {
-                volume_tmp = std::stod(buffer);
-            }
-            catch (std::invalid_argument& e)
-            {
-                std::cout << "Ошибка: громкость должна быть числом.\n";
-                break;
-            }
-            catch (std::out_of_range& e)
-            {
-                std::cout << "Ошибка: слишком большое (или слишком малое) число.\n";
-                break;
-            }
-            value.set_volume(volume_tmp);
-            break;
-        case 5:
-            value.toggle_noise_canceling();
-            break;
-        case 6:
-            value.toggle_microphone();
-            break;
-        case 7:
-            std::cout
-                << "Выберите режим эквалайзера:\n"
-                << "  1) " << equalizer_mode_to_string(EqualizerMode::Normal) << ".\n"
-                << "  2) " << equalizer_mode_to_string(EqualizerMode::Bass) << ".\n"
-                << "  3) " << equalizer_mode_to_string(EqualizerMode::Treble) << ".\n"
-                << "  4) " << equalizer_mode_to_string(EqualizerMode::Vocal) << ".\n"
-                << std::flush;
-            switch (get_input_digit(4))
+            << "Какое поле изменить:\n";
+        int choice = 1;
+        HeadphonesSchema::for_each_field(
+            [&](const auto& field)
             {
-            case 1:
-                value.set_equalizer_mode(EqualizerMode::Normal);
-                break;
-            case 2:
-                value.set_equalizer_mode(EqualizerMode::Bass);
-                break;
-            case 3:
-                value.set_equalizer_mode(EqualizerMode::Treble);
-                break;
-            case 4:
-                value.set_equalizer_mode(EqualizerMode::Vocal);
-                break;
-            default:
-                assert(false);
+                using Field = std::decay_t<decltype(field)>;
+                std::cout << "  " << choice++ << ") " << field.label;
+                if constexpr (std::is_same_v<typename Field::encoding, FlagEncoding>)
+                {
+                    std::cout << " (Переключить)";
+                }
+                std::cout << ".\n";
             }
-            break;
-        case 8:
+        );
+        std::cout << "  " << done_choice << ") Готово.\n" << std::flush;
+
+        choice = get_input_number(done_choice);
+        if (choice == done_choice)
+        {
             return;
-        default:
-            assert(false);
         }
+        HeadphonesSchema::visit_field(
+            (std::size_t)(choice - 1),
+            [&](const auto& field)
+            {
+                using Field = std::decay_t<decltype(field)>;
+                using Encoding = typename Field::encoding;
+                auto& field_value = Field::get(value);
+                if constexpr (std::is_same_v<Encoding, FlagEncoding>)
+                {
+                    field_value = !field_value;
+                }
+                else if constexpr (std::is_same_v<Encoding, EqualizerModeEncoding>)
+                {
+                    std::cout << "Выберите " << field.prompt << ":\n";
+                    for (std::size_t i = 0; i < Encoding::choices.size(); i++)
+                    {
+                        std::cout << "  " << i + 1 << ") ";
+                        Encoding::print(std::cout, Encoding::choices[i]);
+                        std::cout << ".\n";
+                    }
+                    std::cout << std::flush;
+                    field_value = Encoding::choices[get_input_number((int)Encoding::choices.size()) - 1];
+                }
+                else
+                {
+                    std::cout << "Введите " << field.prompt << ": " << std::flush;
+                    if (!Encoding::decode(read_utf8_line(), field_value))
+                    {
+                        std::cout << "Ошибка: значение должно быть числом, не слишком большим и не слишком малым.\n";
+                    }
+                }
+            }
+        );
     }
 }
 
-void load_from_file(HeadphonesList& list, const std::string& filename)
+bool load_from_file(HeadphonesList& list, const std::string& filename)
 {
-    std::ifstream file(filename, std::ios::in | std::ios::binary);
-    if (!file.is_open())
+    PipelinedLoader loader(filename);
+    if (!loader.is_open())
     {
         std::cout
             << "Ошибка: не получается открыть файл.\n"
             << "Проверьте, что файл \"" << filename << "\" существует в папке из которой запущена программа.\n"
             << std::flush;
-        return;
+        return false;
     }
 
-    auto result = HeadphonesList::deserialize(file);
+    auto result = loader.load();
     if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
     {
         auto error = std::get<HeadphonesList::DeserializeError>(result);
         std::cout
             << "Ошибка: \"" << error.message << "\".\n"
             << std::flush;
-        return;
+        return false;
     }
-    list = std::get<HeadphonesList>(result);
+    list = std::move(std::get<HeadphonesList>(result));
+    return true;
 }
 
 bool save_to_file(const HeadphonesList& list, const std::string& filename)
 {
-    std::ofstream file(filename, std::ios::out | std::ios::binary);
-    if (!file.is_open())
-    {
-        std::cout
-            << "Ошибка: не получается создать или переписать файл \"" << filename << "\" в текущей папке.\n"
-            << std::flush;
-        return false;
-    }
-
-    auto result = list.serialize(file);
+    auto result = save_snapshot_atomically(list.snapshot(), filename);
     if (std::holds_alternative<HeadphonesList::SerializeError>(result))
     {
         auto error = std::get<HeadphonesList::SerializeError>(result);
         std::cout
             << "Ошибка: \"" << error.message << "\".\n"
+            << "Файл \"" << filename << "\" остался без изменений.\n"
             << std::flush;
         return false;
     }
@@ -231,21 +248,15 @@ void display_list(const HeadphonesList& list)
     }
     std::cout << "Элементы списка по порядку:\n";
     std::size_t index = 1;
-    for (auto iter = list.chead();;iter++)
+    for (const auto& value : list)
     {
-        const auto& value = (*iter)->cvalue();
         std::cout << index << ") " << value;
-
-        if (iter == list.ctail())
-        {
-            break;
-        }
         index++;
     }
     std::cout << std::flush;
 }
 
-void edit_list(HeadphonesList& list)
+void edit_list(HeadphonesList& list, UndoHistory& history, SearchIndex& search_index, Autosave& autosave)
 {
     std::stringstream buffer_ss;
     std::string buffer;
@@ -259,11 +270,14 @@ void edit_list(HeadphonesList& list)
                 << "  2) Назад.\n"
                 << std::flush;
             HeadphonesList::Node::node_ptr node = std::make_shared<HeadphonesList::Node>();
-            switch (get_input_digit(2))
+            switch (get_input_number(2))
             {
             case 1:
                 generate_new_entry(*node);
                 list.insert_after(list.head(), node);
+                history.commit(history.current().insert(0, node));
+                search_index.insert(node);
+                autosave.notify(history.current());
                 break;
             case 2:
                 return;
@@ -281,7 +295,7 @@ void edit_list(HeadphonesList& list)
         std::uintptr_t index;
 
         auto node_iter = HeadphonesList::Iterator(nullptr);
-        switch (get_input_digit(2))
+        switch (get_input_number(2))
         {
         case 1:
             while (true)
@@ -317,6 +331,9 @@ void edit_list(HeadphonesList& list)
         }
 
         auto added_node = std::make_shared<HeadphonesList::Node>();
+        // Records may still be referenced by an autosave snapshot, so an edit
+        // replaces the node with an edited copy instead of changing it in place.
+        auto edited_node = copy_node(**node_iter);
         std::cout
             << "[Редактирование записи]\n"
             << (*node_iter)->value()
@@ -327,120 +344,1264 @@ void edit_list(HeadphonesList& list)
             << "  4) Удалить выбранную запись.\n"
             << "  5) Назад.\n"
             << std::flush;
-        switch (get_input_digit(5))
+        switch (get_input_number(5))
         {
         case 1:
-            generate_new_entry(**node_iter);
+            generate_new_entry(*edited_node);
+            list.insert_after(node_iter, edited_node);
+            list.remove(node_iter);
+            history.commit(history.current().set(index - 1, edited_node));
+            search_index.remove(node_iter->get());
+            search_index.insert(edited_node);
             break;
         case 2:
             generate_new_entry(*added_node);
             list.insert_before(node_iter, added_node);
+            history.commit(history.current().insert(index - 1, added_node));
+            search_index.insert(added_node);
             break;
         case 3:
             generate_new_entry(*added_node);
             list.insert_after(node_iter, added_node);
+            history.commit(history.current().insert(index, added_node));
+            search_index.insert(added_node);
             break;
         case 4:
             list.remove(node_iter);
+            history.commit(history.current().remove(index - 1));
+            search_index.remove(node_iter->get());
             break;
         case 5:
             continue;
         default:
             assert(false);
         }
+        autosave.notify(history.current());
     }
 }
 
-void display_info()
+void search_list(const HeadphonesList& list, SearchIndex& search_index)
 {
+    const std::size_t shown_limit = 10;
+    const std::size_t candidate_limit = 100000;
+
+    if (!search_index.is_built())
+    {
+        search_index.build(list);
+    }
+
     std::cout
-        << "Информация о программе:\n"
-        << "ФИО = \"Сигаев Иван Романович\"\n"
-        << "Курс = 2\n"
-        << "Группа = 6\n"
-        << "Дата компиляции = " << __DATE__ << "\n"
+        << "Поиск по производителю и названию модели без учёта регистра.\n"
+        << "Каждая введённая строка дописывается к запросу, \"<\" стирает последний символ,\n"
+        << "\"^\" переключает поиск подстроки и поиск по началу названия, пустая строка — выход.\n"
         << std::flush;
+
+    std::string query;
+    std::string buffer;
+    HeadphonesList::Snapshot candidates;
+    bool is_candidates_valid = false;
+    bool is_prefix_search = false;
+    while (true)
+    {
+        std::cout << (is_prefix_search ? "Начало названия: " : "Подстрока: ") << query << std::flush;
+        buffer = read_utf8_line();
+        if (buffer.empty())
+        {
+            return;
+        }
+
+        if (buffer == "^")
+        {
+            is_prefix_search = !is_prefix_search;
+            is_candidates_valid = false;
+        }
+        else if (buffer == "<")
+        {
+            // Drop one whole UTF-8 sequence, not just its last byte.
+            while (!query.empty() && ((unsigned char)query.back() & 0xC0) == 0x80)
+            {
+                query.pop_back();
+            }
+            if (!query.empty())
+            {
+                query.pop_back();
+            }
+            is_candidates_valid = false;
+        }
+        else
+        {
+            query += buffer;
+        }
+
+        if (query.empty())
+        {
+            is_candidates_valid = false;
+            continue;
+        }
+
+        // A longer query only narrows the previous matches, so refine them
+        // instead of querying the index again, unless they were truncated.
+        if (is_candidates_valid && !is_prefix_search && candidates.size() < candidate_limit)
+        {
+            candidates = search_index.refine(candidates, query);
+        }
+        else if (is_prefix_search)
+        {
+            candidates = search_index.find_prefix(query, candidate_limit);
+        }
+        else
+        {
+            candidates = search_index.find_substring(query, candidate_limit);
+        }
+        is_candidates_valid = true;
+
+        std::cout << "Найдено записей: " << candidates.size() << (candidates.size() >= candidate_limit ? "+" : "") << "\n";
+        for (std::size_t i = 0; i < candidates.size() && i < shown_limit; i++)
+        {
+            const auto& value = candidates[i]->cvalue();
+            std::cout << "  " << value.get_producer_name() << " " << value.get_model_name() << " — " << value.get_price() << "\n";
+        }
+        std::cout << std::flush;
+    }
 }
 
-void exit_session(const HeadphonesList& list, const std::string& filename)
+void undo_edit(HeadphonesList& list, UndoHistory& history, SearchIndex& search_index, Autosave& autosave)
 {
-    std::cout
-        << "Вы уверены, что хотите выйти?\n"
-        << "1) Да.\n"
-        << "2) Нет.\n"
-        << std::flush;
-    switch (get_input_digit(2))
+    if (!history.undo(list))
     {
-    case 1:
-        break;
-    case 2:
+        std::cout << "Нечего отменять.\n" << std::flush;
         return;
-    default:
-        assert(false);
     }
+    search_index.clear();
+    autosave.notify(history.current());
+    std::cout << "Последнее изменение отменено.\n" << std::flush;
+}
+
+void redo_edit(HeadphonesList& list, UndoHistory& history, SearchIndex& search_index, Autosave& autosave)
+{
+    if (!history.redo(list))
+    {
+        std::cout << "Нечего повторять.\n" << std::flush;
+        return;
+    }
+    search_index.clear();
+    autosave.notify(history.current());
+    std::cout << "Отменённое изменение повторено.\n" << std::flush;
+}
+
+bool choose_producer(const PartitionedCatalog& catalog, std::string& producer)
+{
+    auto producers = catalog.producers();
+    if (producers.empty())
+    {
+        std::cout << "Каталог пуст.\n" << std::flush;
+        return false;
+    }
+
+    std::cout << "Производители в каталоге:\n";
+    for (std::size_t i = 0; i < producers.size(); i++)
+    {
+        std::cout
+            << "  " << i + 1 << ") " << producers[i]
+            << " (записей: " << catalog.count(producers[i]) << ")\n";
+    }
+
+    std::stringstream buffer_ss;
+    std::string buffer;
+    std::size_t index;
+    while (true)
+    {
+        std::cout << "Введите номер производителя (число от 1 до " << producers.size() << " включительно): " << std::flush;
+        std::getline(std::cin, buffer);
+        buffer_ss.clear();
+        buffer_ss.str(buffer);
+        if (!(buffer_ss >> index) || index == 0 || index > producers.size())
+        {
+            std::cout << "Ошибка: номер производителя указан неверно.\n";
+            continue;
+        }
+        producer = producers[index - 1];
+        return true;
+    }
+}
 
+// Edits one record of a loaded partition. The partition is only marked
+// dirty, and written when the catalog is saved.
+void edit_partition(PartitionedCatalog& catalog, const std::string& producer, HeadphonesList& partition)
+{
+    if (partition.is_empty())
+    {
+        std::cout << "Раздел пуст.\n" << std::flush;
+        return;
+    }
+    std::cout << "Выберите запись раздела.\n" << std::flush;
+    auto node_iter = partition.index(get_input_number((int)partition.count()) - 1);
     std::cout
-        << "Хотите сохранить файл перед выходом?\n"
-        << "1) Да.\n"
-        << "2) Нет.\n"
+        << "[Редактирование записи]\n"
+        << (*node_iter)->value()
+        << "Выберите действие:\n"
+        << "  1) Редактировать выбранную запись.\n"
+        << "  2) Добавить запись после выбранной.\n"
+        << "  3) Удалить выбранную запись.\n"
+        << "  4) Назад.\n"
         << std::flush;
-    switch (get_input_digit(2))
+    switch (get_input_number(4))
     {
     case 1:
-        if (!save_to_file(list, filename))
-        {
-            return;
-        }
+    {
+        auto edited_node = copy_node(**node_iter);
+        generate_new_entry(*edited_node);
+        partition.insert_after(node_iter, edited_node);
+        partition.remove(node_iter);
         break;
+    }
     case 2:
+    {
+        auto added_node = std::make_shared<HeadphonesList::Node>();
+        added_node->value().set_producer_name(producer);
+        generate_new_entry(*added_node);
+        partition.insert_after(node_iter, added_node);
+        break;
+    }
+    case 3:
+        partition.remove(node_iter);
         break;
+    case 4:
+        return;
     default:
         assert(false);
     }
-
-    std::cout << "Пока-пока!" << std::endl;
-
-    std::exit(EXIT_SUCCESS);
+    catalog.mark_dirty(producer);
 }
 
-void TextMenu::session()
+void partitioned_catalog_menu(const HeadphonesList& list, PartitionedCatalog& catalog)
 {
-    const std::string save_filename = "headphones.bin";
-
-    HeadphonesList list {};
+    auto open_result = catalog.open();
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(open_result))
+    {
+        auto error = std::get<HeadphonesList::DeserializeError>(open_result);
+        std::cout
+            << "Ошибка: \"" << error.message << "\".\n"
+            << std::flush;
+        return;
+    }
 
+    std::string producer;
     while (true)
     {
         std::cout
             << "\n"
-            << "Выберите действие:\n"
-            << "  1) Загрузить из файла.\n"
-            << "  2) Сохранить в файл.\n"
-            << "  3) Показать список.\n"
-            << "  4) Редактировать список.\n"
-            << "  5) О программе.\n"
-            << "  6) Выход.\n"
+            << "Секционированный каталог \"" << catalog.directory() << "\" (записей: " << catalog.count() << "):\n"
+            << "  1) Сохранить текущий список в каталог.\n"
+            << "  2) Показать записи производителя.\n"
+            << "  3) Редактировать записи производителя.\n"
+            << "  4) Записать изменённые разделы.\n"
+            << "  5) Выгрузить просмотренные разделы из памяти.\n"
+            << "  6) Назад.\n"
             << std::flush;
-
-        switch (get_input_digit(6))
+        int choice = get_input_number(6);
+        switch (choice)
         {
         case 1:
-            load_from_file(list, save_filename);
+        {
+            auto result = catalog.assign(list);
+            if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+            {
+                auto error = std::get<HeadphonesList::SerializeError>(result);
+                std::cout
+                    << "Ошибка: \"" << error.message << "\".\n"
+                    << std::flush;
+            }
             break;
+        }
         case 2:
-            save_to_file(list, save_filename);
-            break;
         case 3:
-            display_list(list);
+        {
+            if (!choose_producer(catalog, producer))
+            {
+                break;
+            }
+            auto result = catalog.partition(producer);
+            if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+            {
+                auto error = std::get<HeadphonesList::DeserializeError>(result);
+                std::cout
+                    << "Ошибка: \"" << error.message << "\".\n"
+                    << std::flush;
+                break;
+            }
+            if (choice == 2)
+            {
+                display_list(*std::get<HeadphonesList*>(result));
+            }
+            else
+            {
+                edit_partition(catalog, producer, *std::get<HeadphonesList*>(result));
+            }
             break;
+        }
         case 4:
-            edit_list(list);
+        {
+            // Only partitions edited since they were loaded are rewritten.
+            auto result = catalog.save();
+            if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+            {
+                auto error = std::get<HeadphonesList::SerializeError>(result);
+                std::cout
+                    << "Ошибка: \"" << error.message << "\".\n"
+                    << std::flush;
+            }
             break;
+        }
         case 5:
-            display_info();
+            catalog.evict_clean();
             break;
         case 6:
-            exit_session(list, save_filename);
+            return;
+        default:
+            assert(false);
+        }
+    }
+}
+
+// Moves the records of imported onto the end of list.
+void exchange_menu(HeadphonesList& list, UndoHistory& history, SearchIndex& search_index, Autosave& autosave)
+{
+    while (true)
+    {
+        std::cout
+            << "\n"
+            << "Импорт и экспорт:\n"
+            << "  1) Добавить записи из CSV.\n"
+            << "  2) Добавить записи из JSON.\n"
+            << "  3) Выгрузить список в CSV.\n"
+            << "  4) Выгрузить список в JSON.\n"
+            << "  5) Обновить цены из CSV.\n"
+            << "  6) Обновить цены из JSON.\n"
+            << "  7) Назад.\n"
+            << std::flush;
+        int choice = get_input_number(7);
+        if (choice == 7)
+        {
+            return;
+        }
+
+        std::cout << "Введите имя файла: " << std::flush;
+        auto path = utf8_path(read_utf8_line());
+        ExchangeReport report;
+        if (choice == 1 || choice == 2 || choice == 5 || choice == 6)
+        {
+            std::ifstream file(path, std::ios::in | std::ios::binary);
+            if (!file.is_open())
+            {
+                std::cout << "Ошибка: не получается открыть файл.\n" << std::flush;
+                continue;
+            }
+            auto result = choice % 2 == 1 ? import_csv(file, report) : import_json(file, report);
+            if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+            {
+                auto error = std::get<HeadphonesList::DeserializeError>(result);
+                std::cout
+                    << "Ошибка: \"" << error.message << "\".\n"
+                    << "Список остался без изменений.\n"
+                    << std::flush;
+                continue;
+            }
+
+            // A bulk import is not undone record by record; the history
+            // starts over from the changed list.
+            if (choice >= 5)
+            {
+                auto upsert = upsert_prices(list, std::move(std::get<HeadphonesList>(result)));
+                history.reset(list);
+                search_index.clear();
+                autosave.notify(history.current());
+                std::cout
+                    << "Строк в файле: " << upsert.rows
+                    << ", цен изменено: " << upsert.updated
+                    << ", без изменений: " << upsert.unchanged
+                    << ", добавлено записей: " << upsert.inserted
+                    << ", повторов: " << upsert.duplicates
+                    << " за " << report.seconds + upsert.seconds << " с.\n"
+                    << std::flush;
+                continue;
+            }
+
+            list.append(std::move(std::get<HeadphonesList>(result)));
+            history.reset(list);
+            search_index.clear();
+            autosave.notify(history.current());
+            std::cout << "Добавлено записей: " << report.rows;
+        }
+        else
+        {
+            std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                std::cout << "Ошибка: не получается открыть файл.\n" << std::flush;
+                continue;
+            }
+            auto result = choice == 3 ? export_csv(file, list, report) : export_json(file, list, report);
+            if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+            {
+                auto error = std::get<HeadphonesList::SerializeError>(result);
+                std::cout
+                    << "Ошибка: \"" << error.message << "\".\n"
+                    << std::flush;
+                continue;
+            }
+            std::cout << "Выгружено записей: " << report.rows;
+        }
+        std::cout
+            << " за " << report.seconds << " с (" << (std::uint64_t)report.rows_per_second() << " записей/с).\n"
+            << std::flush;
+    }
+}
+
+MergePolicy choose_merge_policy()
+{
+    std::cout
+        << "Какую запись оставлять, если производитель и модель совпадают:\n"
+        << "  1) Из первого каталога.\n"
+        << "  2) Из последнего каталога.\n"
+        << "  3) С наименьшей ценой.\n"
+        << std::flush;
+    switch (get_input_number(3))
+    {
+    case 1:
+        return MergePolicy::KeepLeft;
+    case 2:
+        return MergePolicy::KeepNewest;
+    case 3:
+        return MergePolicy::KeepLowestPrice;
+    default:
+        assert(false);
+        return MergePolicy::KeepLeft;
+    }
+}
+
+void display_merge_report(const MergeReport& report)
+{
+    std::cout
+        << "Прочитано записей: " << report.rows_read
+        << ", дубликатов: " << report.duplicates
+        << ", записей в результате: " << report.rows_written
+        << " (" << report.seconds << " с).\n"
+        << std::flush;
+}
+
+void merge_menu(HeadphonesList& list, UndoHistory& history, SearchIndex& search_index, Autosave& autosave)
+{
+    while (true)
+    {
+        std::cout
+            << "\n"
+            << "Слияние каталогов:\n"
+            << "  1) Объединить текущий список с каталогом из файла.\n"
+            << "  2) Сохранить список, отсортированный по производителю и модели.\n"
+            << "  3) Слить отсортированные файлы каталогов в новый файл.\n"
+            << "  4) Назад.\n"
+            << std::flush;
+        switch (get_input_number(4))
+        {
+        case 1:
+        {
+            std::cout << "Введите имя файла каталога: " << std::flush;
+            std::ifstream file(utf8_path(read_utf8_line()), std::ios::in | std::ios::binary);
+            if (!file.is_open())
+            {
+                std::cout << "Ошибка: не получается открыть файл.\n" << std::flush;
+                break;
+            }
+            auto result = HeadphonesList::deserialize(file);
+            if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+            {
+                auto error = std::get<HeadphonesList::DeserializeError>(result);
+                std::cout
+                    << "Ошибка: \"" << error.message << "\".\n"
+                    << std::flush;
+                break;
+            }
+
+            auto& other = std::get<HeadphonesList>(result);
+            MergeReport report;
+            auto merged = merge_catalogs({&list, &other}, choose_merge_policy(), report);
+            list = std::move(merged);
+            history.reset(list);
+            search_index.clear();
+            autosave.notify(history.current());
+            display_merge_report(report);
+            break;
+        }
+        case 2:
+        {
+            std::cout << "Введите имя файла: " << std::flush;
+            auto filename = read_utf8_line();
+            auto snapshot = list.snapshot();
+            sort_by_key(snapshot);
+            auto result = save_snapshot_atomically(snapshot, filename);
+            if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+            {
+                auto error = std::get<HeadphonesList::SerializeError>(result);
+                std::cout
+                    << "Ошибка: \"" << error.message << "\".\n"
+                    << std::flush;
+            }
+            break;
+        }
+        case 3:
+        {
+            const int max_inputs = 64;
+            std::cout << "Сколько файлов слить?\n" << std::flush;
+            int input_count = get_input_number(max_inputs);
+            std::vector<std::ifstream> files;
+            files.reserve(input_count);
+            std::vector<std::istream*> inputs;
+            bool is_opened = true;
+            for (int i = 0; i < input_count && is_opened; i++)
+            {
+                std::cout << "Имя файла " << i + 1 << " (от старого к новому): " << std::flush;
+                files.emplace_back(utf8_path(read_utf8_line()), std::ios::in | std::ios::binary);
+                is_opened = files.back().is_open();
+                inputs.push_back(&files.back());
+            }
+            if (!is_opened)
+            {
+                std::cout << "Ошибка: не получается открыть файл.\n" << std::flush;
+                break;
+            }
+
+            auto policy = choose_merge_policy();
+            std::cout << "Имя файла результата: " << std::flush;
+            auto output_filename = read_utf8_line();
+            MergeReport report;
+            auto result = write_file_atomically(
+                output_filename,
+                [&](std::ostream& os) { return merge_sorted_catalogs(inputs, os, policy, report); }
+            );
+            if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+            {
+                auto error = std::get<HeadphonesList::SerializeError>(result);
+                std::cout
+                    << "Ошибка: \"" << error.message << "\".\n"
+                    << std::flush;
+                break;
+            }
+            display_merge_report(report);
+            break;
+        }
+        case 4:
+            return;
+        default:
+            assert(false);
+        }
+    }
+}
+
+void display_delta_report(const DeltaReport& report)
+{
+    std::cout
+        << "Записей перенесено: " << report.copied
+        << ", добавлено: " << report.inserted
+        << ", изменено: " << report.updated
+        << ", удалено: " << report.removed
+        << ", перемещённых блоков: " << report.moved
+        << ". Размер патча: " << report.patch_bytes << " байт"
+        << " (" << report.seconds << " с).\n"
+        << std::flush;
+}
+
+void delta_menu(HeadphonesList& list, UndoHistory& history, SearchIndex& search_index, Autosave& autosave)
+{
+    while (true)
+    {
+        std::cout
+            << "\n"
+            << "Разностные обновления каталога:\n"
+            << "  1) Составить патч между двумя файлами каталога.\n"
+            << "  2) Составить патч от файла каталога к текущему списку.\n"
+            << "  3) Применить патч к текущему списку.\n"
+            << "  4) Применить патч к файлу каталога.\n"
+            << "  5) Назад.\n"
+            << std::flush;
+        int choice = get_input_number(5);
+        if (choice == 5)
+        {
+            return;
+        }
+
+        DeltaReport report;
+        std::optional<std::string> error;
+        switch (choice)
+        {
+        case 1:
+        case 2:
+        {
+            std::cout << "Введите имя файла старой версии каталога: " << std::flush;
+            auto base_filename = read_utf8_line();
+            std::string target_filename;
+            if (choice == 1)
+            {
+                std::cout << "Введите имя файла новой версии каталога: " << std::flush;
+                target_filename = read_utf8_line();
+            }
+            std::cout << "Введите имя файла патча: " << std::flush;
+            auto patch_filename = read_utf8_line();
+
+            HeadphonesList::SerializeResult result;
+            if (choice == 1)
+            {
+                result = diff_catalog_files(base_filename, target_filename, patch_filename, report);
+            }
+            else
+            {
+                PipelinedLoader loader(base_filename);
+                auto loaded = loader.load();
+                if (std::holds_alternative<HeadphonesList::DeserializeError>(loaded))
+                {
+                    error = std::get<HeadphonesList::DeserializeError>(loaded).message;
+                    break;
+                }
+                const auto& base = std::get<HeadphonesList>(loaded);
+                result = write_file_atomically(
+                    patch_filename,
+                    [&](std::ostream& os) { return write_delta(base, list, os, report); }
+                );
+            }
+            if (std::holds_alternative<HeadphonesList::SerializeError>(result))
+            {
+                error = std::get<HeadphonesList::SerializeError>(result).message;
+            }
+            break;
+        }
+        case 3:
+        case 4:
+        {
+            std::string catalog_filename;
+            if (choice == 4)
+            {
+                std::cout << "Введите имя файла каталога: " << std::flush;
+                catalog_filename = read_utf8_line();
+            }
+            std::cout << "Введите имя файла патча: " << std::flush;
+            auto patch_filename = read_utf8_line();
+
+            DeltaApplyResult result;
+            if (choice == 4)
+            {
+                result = apply_delta_file(catalog_filename, patch_filename, report);
+            }
+            else
+            {
+                std::ifstream patch(utf8_path(patch_filename), std::ios::in | std::ios::binary);
+                if (!patch.is_open())
+                {
+                    error = "Не получается открыть файл патча.";
+                    break;
+                }
+                result = apply_delta(list, patch, report);
+                if (std::holds_alternative<std::monostate>(result))
+                {
+                    history.reset(list);
+                    search_index.clear();
+                    autosave.notify(history.current());
+                }
+            }
+            if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+            {
+                error = std::get<HeadphonesList::DeserializeError>(result).message;
+            }
+            break;
+        }
+        default:
+            assert(false);
+        }
+
+        if (error)
+        {
+            std::cout
+                << "Ошибка: \"" << *error << "\".\n"
+                << std::flush;
+            continue;
+        }
+        display_delta_report(report);
+    }
+}
+
+// Record numbers in a view can run past what get_input_number handles.
+std::uint64_t read_record_number(std::uint64_t max_inclusive)
+{
+    while (true)
+    {
+        std::cout << "Пожалуйста введите номер записи от 1 до " << max_inclusive << ": " << std::flush;
+        auto line = read_utf8_line();
+        std::uint64_t number = 0;
+        auto result = std::from_chars(line.data(), line.data() + line.size(), number);
+        if (result.ec == std::errc() && number >= 1 && number <= max_inclusive)
+        {
+            return number;
+        }
+    }
+}
+
+std::optional<double> read_price()
+{
+    while (true)
+    {
+        auto line = read_utf8_line();
+        if (line.empty())
+        {
+            return std::nullopt;
+        }
+        if (auto price = parse_price(line))
+        {
+            return price;
+        }
+        std::cout << "Пожалуйста введите число: " << std::flush;
+    }
+}
+
+void display_view_record(CatalogView& view, std::uint64_t index)
+{
+    auto result = view.read(index);
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+    {
+        std::cout
+            << index + 1 << ") Ошибка: \"" << std::get<HeadphonesList::DeserializeError>(result).message << "\".\n";
+        return;
+    }
+    std::cout << index + 1 << ") " << std::get<HeadphonesList::Node::node_ptr>(result)->cvalue();
+}
+
+void view_menu(const std::string& filename, Autosave& autosave)
+{
+    const std::uint64_t page_size = 20;
+
+    // The view reads the file on disk, so it should hold the latest edits.
+    autosave.flush();
+    CatalogView view(filename);
+    auto opened = view.open();
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(opened))
+    {
+        std::cout
+            << "Ошибка: \"" << std::get<HeadphonesList::DeserializeError>(opened).message << "\".\n"
+            << std::flush;
+        return;
+    }
+
+    while (true)
+    {
+        std::cout
+            << "\n"
+            << "Просмотр файла \"" << filename << "\" без загрузки, записей: " << view.count() << ".\n"
+            << "  1) Показать запись по номеру.\n"
+            << "  2) Показать страницу записей.\n"
+            << "  3) Найти запись по производителю и модели.\n"
+            << "  4) Найти записи в диапазоне цен.\n"
+            << "  5) Назад.\n"
+            << std::flush;
+        int choice = get_input_number(5);
+        if (choice == 5)
+        {
+            return;
+        }
+        if (view.count() == 0 && choice != 3 && choice != 4)
+        {
+            std::cout << "Каталог пуст.\n" << std::flush;
+            continue;
+        }
+
+        switch (choice)
+        {
+        case 1:
+            display_view_record(view, read_record_number(view.count()) - 1);
+            break;
+        case 2:
+        {
+            std::uint64_t first = read_record_number(view.count()) - 1;
+            for (std::uint64_t i = first; i < view.count() && i < first + page_size; i++)
+            {
+                display_view_record(view, i);
+            }
+            break;
+        }
+        case 3:
+        {
+            std::cout << "Введите название производителя: " << std::flush;
+            auto producer = read_utf8_line();
+            std::cout << "Введите название модели: " << std::flush;
+            auto model = read_utf8_line();
+            auto found = view.find(producer, model);
+            if (!found)
+            {
+                std::cout << "Ничего не найдено.\n";
+                break;
+            }
+            display_view_record(view, *found);
+            break;
+        }
+        case 4:
+        {
+            std::cout << "Введите наименьшую цену (пустая строка - без ограничения): " << std::flush;
+            double min_price = read_price().value_or(-std::numeric_limits<double>::infinity());
+            std::cout << "Введите наибольшую цену (пустая строка - без ограничения): " << std::flush;
+            double max_price = read_price().value_or(std::numeric_limits<double>::infinity());
+            auto found = view.find_by_price(min_price, max_price);
+            std::cout << "Найдено записей: " << found.size() << ".\n";
+            for (std::size_t i = 0; i < found.size() && i < page_size; i++)
+            {
+                display_view_record(view, found[i]);
+            }
+            if (found.size() > page_size)
+            {
+                std::cout << "Показаны первые " << page_size << ".\n";
+            }
+            break;
+        }
+        default:
+            assert(false);
+        }
+        std::cout << std::flush;
+    }
+}
+
+void display_aggregate_report(const AggregateReport& report)
+{
+    std::cout << "Записей: " << report.rows << " (" << report.seconds << " с).\n";
+    for (const auto& group : report.groups)
+    {
+        std::cout
+            << "\"" << group.key << "\": записей " << group.count
+            << ", средняя громкость " << group.average_volume();
+        if (group.priced_count > 0)
+        {
+            std::cout << ", цена от " << group.min_price << " до " << group.max_price;
+        }
+        std::cout << ".\n";
+    }
+    if (!report.top.empty())
+    {
+        std::cout << "Самые дорогие:\n";
+    }
+    for (std::size_t i = 0; i < report.top.size(); i++)
+    {
+        std::cout << i + 1 << ") " << report.top[i].record;
+    }
+    std::cout << std::flush;
+}
+
+void report_menu(const HeadphonesList& list)
+{
+    const std::size_t top_count = 20;
+
+    std::cout
+        << "\n"
+        << "Отчёт по каталогу:\n"
+        << "  1) По производителям, текущий список.\n"
+        << "  2) По режимам эквалайзера, текущий список.\n"
+        << "  3) По производителям, файл каталога без загрузки.\n"
+        << "  4) По режимам эквалайзера, файл каталога без загрузки.\n"
+        << "  5) Назад.\n"
+        << std::flush;
+    int choice = get_input_number(5);
+    if (choice == 5)
+    {
+        return;
+    }
+    auto group_key = choice % 2 == 1 ? GroupKey::Producer : GroupKey::EqualizerMode;
+    if (choice <= 2)
+    {
+        display_aggregate_report(aggregate(list, group_key, top_count));
+        return;
+    }
+
+    std::cout << "Введите имя файла каталога: " << std::flush;
+    std::ifstream file(utf8_path(read_utf8_line()), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Ошибка: не получается открыть файл.\n" << std::flush;
+        return;
+    }
+    auto result = aggregate_stream(file, group_key, top_count);
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+    {
+        std::cout
+            << "Ошибка: \"" << std::get<HeadphonesList::DeserializeError>(result).message << "\".\n"
+            << std::flush;
+        return;
+    }
+    display_aggregate_report(std::get<AggregateReport>(result));
+}
+
+void display_paged_record(PagedCatalog& catalog, std::uint64_t index)
+{
+    auto result = catalog.get(index);
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+    {
+        std::cout
+            << index + 1 << ") Ошибка: \"" << std::get<HeadphonesList::DeserializeError>(result).message << "\".\n";
+        return;
+    }
+    std::cout << index + 1 << ") " << std::get<Headphones>(result);
+}
+
+void display_paged_stats(const PagedCatalog::Stats& stats)
+{
+    const double mebibyte = 1 << 20;
+
+    std::cout
+        << "Обращений: " << stats.lookups << ", попаданий в кэш: " << stats.hit_rate() * 100 << "%.\n"
+        << "Подкачек: " << stats.page_ins
+        << ", в среднем " << stats.average_page_in_seconds() * 1e6 << " мкс.\n"
+        << "В памяти записей: " << stats.resident_records
+        << ", строк: " << stats.resident_bytes / mebibyte << " МиБ"
+        << " из " << stats.budget_bytes / mebibyte << " МиБ"
+        << ", служебных данных: " << stats.metadata_bytes / mebibyte << " МиБ.\n"
+        << std::flush;
+}
+
+void paged_menu()
+{
+    const std::uint64_t page_size = 20;
+    const std::string store_filename = "headphones_paged.tmp";
+
+    std::cout << "Введите имя файла каталога: " << std::flush;
+    std::ifstream file(utf8_path(read_utf8_line()), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Ошибка: не получается открыть файл.\n" << std::flush;
+        return;
+    }
+    std::cout << "Введите объём памяти под строки, МиБ: " << std::flush;
+    std::uint64_t budget_bytes = read_record_number(1 << 20) << 20;
+
+    PagedCatalog catalog(store_filename, budget_bytes);
+    auto loaded = catalog.load(file);
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(loaded))
+    {
+        std::cout
+            << "Ошибка: \"" << std::get<HeadphonesList::DeserializeError>(loaded).message << "\".\n"
+            << std::flush;
+        return;
+    }
+
+    while (true)
+    {
+        std::cout
+            << "\n"
+            << "Каталог с ограниченной памятью, записей: " << catalog.count() << ".\n"
+            << "  1) Показать запись по номеру.\n"
+            << "  2) Показать страницу записей.\n"
+            << "  3) Статистика кэша.\n"
+            << "  4) Изменить объём памяти.\n"
+            << "  5) Назад.\n"
+            << std::flush;
+        int choice = get_input_number(5);
+        if (choice == 5)
+        {
+            return;
+        }
+        if (catalog.count() == 0 && choice <= 2)
+        {
+            std::cout << "Каталог пуст.\n" << std::flush;
+            continue;
+        }
+
+        switch (choice)
+        {
+        case 1:
+            display_paged_record(catalog, read_record_number(catalog.count()) - 1);
+            break;
+        case 2:
+        {
+            std::uint64_t first = read_record_number(catalog.count()) - 1;
+            for (std::uint64_t i = first; i < catalog.count() && i < first + page_size; i++)
+            {
+                display_paged_record(catalog, i);
+            }
+            break;
+        }
+        case 3:
+            display_paged_stats(catalog.stats());
+            break;
+        case 4:
+            std::cout << "Введите объём памяти под строки, МиБ: " << std::flush;
+            catalog.set_budget(read_record_number(1 << 20) << 20);
+            break;
+        default:
+            assert(false);
+        }
+        std::cout << std::flush;
+    }
+}
+
+void display_workspace_matches(const CatalogWorkspace& workspace, const std::vector<WorkspaceMatch>& matches)
+{
+    std::cout << "Найдено записей: " << matches.size() << ".\n";
+    for (const auto& match : matches)
+    {
+        std::cout
+            << "\"" << workspace.catalog(match.catalog).filename << "\", "
+            << match.position + 1 << ") " << match.record;
+    }
+    std::cout << std::flush;
+}
+
+void workspace_menu(CatalogWorkspace& workspace)
+{
+    const std::size_t top_count = 20;
+    const std::size_t max_matches = 20;
+
+    while (true)
+    {
+        std::cout
+            << "\n"
+            << "Рабочее пространство, каталогов: " << workspace.size()
+            << ", записей: " << workspace.count() << ".\n"
+            << "  1) Загрузить файлы каталогов.\n"
+            << "  2) Показать каталоги.\n"
+            << "  3) Найти записи по производителю и модели.\n"
+            << "  4) Найти записи в диапазоне цен.\n"
+            << "  5) Отчёт по производителям.\n"
+            << "  6) Закрыть все каталоги.\n"
+            << "  7) Назад.\n"
+            << std::flush;
+
+        switch (get_input_number(7))
+        {
+        case 1:
+        {
+            std::vector<std::string> filenames;
+            std::cout << "Введите имена файлов по одному в строке, пустая строка - конец списка:\n" << std::flush;
+            for (auto line = read_utf8_line(); !line.empty(); line = read_utf8_line())
+            {
+                filenames.push_back(std::move(line));
+            }
+            auto report = workspace.load(filenames);
+            for (const auto& error : report.errors)
+            {
+                std::cout << "Ошибка в файле \"" << error.filename << "\": \"" << error.message << "\".\n";
+            }
+            std::cout
+                << "Загружено файлов: " << report.loaded << ", записей: " << report.records
+                << " за " << report.seconds << " с (самый долгий файл " << report.longest_seconds << " с).\n";
+            break;
+        }
+        case 2:
+            for (std::size_t i = 0; i < workspace.size(); i++)
+            {
+                const auto& catalog = workspace.catalog(i);
+                std::cout
+                    << i + 1 << ") \"" << catalog.filename << "\": записей " << catalog.list.count()
+                    << ", загружен за " << catalog.load_seconds << " с.\n";
+            }
+            break;
+        case 3:
+        {
+            std::cout << "Введите название производителя: " << std::flush;
+            auto producer = read_utf8_line();
+            std::cout << "Введите название модели: " << std::flush;
+            auto model = read_utf8_line();
+            display_workspace_matches(workspace, workspace.find(producer, model));
+            break;
+        }
+        case 4:
+        {
+            std::cout << "Введите наименьшую цену (пустая строка - без ограничения): " << std::flush;
+            double min_price = read_price().value_or(-std::numeric_limits<double>::infinity());
+            std::cout << "Введите наибольшую цену (пустая строка - без ограничения): " << std::flush;
+            double max_price = read_price().value_or(std::numeric_limits<double>::infinity());
+            display_workspace_matches(workspace, workspace.find_by_price(min_price, max_price, max_matches));
+            break;
+        }
+        case 5:
+            display_aggregate_report(workspace.aggregate(GroupKey::Producer, top_count));
+            break;
+        case 6:
+            workspace.clear();
+            break;
+        case 7:
+            return;
+        default:
+            assert(false);
+        }
+        std::cout << std::flush;
+    }
+}
+
+void display_info()
+{
+    std::cout
+        << "Информация о программе:\n"
+        << "ФИО = \"Сигаев Иван Романович\"\n"
+        << "Курс = 2\n"
+        << "Группа = 6\n"
+        << "Дата компиляции = " << __DATE__ << "\n"
+        << std::flush;
+}
+
+void autosave_menu(Autosave& autosave)
+{
+    const int max_interval_seconds = 3600;
+
+    auto interval = std::chrono::duration_cast<std::chrono::seconds>(autosave.interval());
+    std::cout
+        << "Изменения сохраняются не чаще раза в " << interval.count() << " с.\n"
+        << "Новый интервал автосохранения в секундах.\n"
+        << std::flush;
+    autosave.set_interval(std::chrono::seconds(get_input_number(max_interval_seconds)));
+}
+
+void exit_session(const HeadphonesList& list, const std::string& filename, Autosave& autosave)
+{
+    std::cout
+        << "Вы уверены, что хотите выйти?\n"
+        << "1) Да.\n"
+        << "2) Нет.\n"
+        << std::flush;
+    switch (get_input_number(2))
+    {
+    case 1:
+        break;
+    case 2:
+        return;
+    default:
+        assert(false);
+    }
+
+    std::cout
+        << "Хотите сохранить файл перед выходом?\n"
+        << "1) Да.\n"
+        << "2) Нет.\n"
+        << std::flush;
+    switch (get_input_number(2))
+    {
+    case 1:
+        autosave.cancel();
+        if (!save_to_file(list, filename))
+        {
+            return;
+        }
+        break;
+    case 2:
+        autosave.cancel();
+        break;
+    default:
+        assert(false);
+    }
+
+    std::cout << "Пока-пока!" << std::endl;
+
+    std::exit(EXIT_SUCCESS);
+}
+
+void TextMenu::session()
+{
+    const std::string save_filename = "headphones.bin";
+    const auto default_autosave_interval = std::chrono::seconds(5);
+    const std::size_t max_undo_steps = 10000;
+    const std::string catalog_directory = "headphones_catalog";
+
+    HeadphonesList list {};
+    UndoHistory history(max_undo_steps);
+    SearchIndex search_index {};
+    Autosave autosave(save_filename, default_autosave_interval);
+    PartitionedCatalog catalog(catalog_directory);
+    CatalogWorkspace workspace {};
+
+    while (true)
+    {
+        if (auto error = autosave.take_error())
+        {
+            std::cout
+                << "Ошибка автосохранения: \"" << *error << "\".\n"
+                << std::flush;
+        }
+
+        std::cout
+            << "\n"
+            << "Выберите действие:\n"
+            << "  1) Загрузить из файла.\n"
+            << "  2) Сохранить в файл.\n"
+            << "  3) Показать список.\n"
+            << "  4) Редактировать список.\n"
+            << "  5) Поиск.\n"
+            << "  6) Отменить последнее изменение.\n"
+            << "  7) Повторить отменённое изменение.\n"
+            << "  8) Секционированный каталог.\n"
+            << "  9) Импорт и экспорт CSV/JSON.\n"
+            << "  10) Слияние каталогов.\n"
+            << "  11) Разностные обновления каталога.\n"
+            << "  12) Просмотр файла без загрузки.\n"
+            << "  13) Отчёт по каталогу.\n"
+            << "  14) Каталог с ограниченной памятью.\n"
+            << "  15) Рабочее пространство каталогов.\n"
+            << "  16) Интервал автосохранения.\n"
+            << "  17) О программе.\n"
+            << "  18) Выход.\n"
+            << std::flush;
+
+        switch (get_input_number(18))
+        {
+        case 1:
+            autosave.cancel();
+            if (load_from_file(list, save_filename))
+            {
+                history.reset(list);
+                search_index.clear();
+            }
+            break;
+        case 2:
+            autosave.cancel();
+            save_to_file(list, save_filename);
+            break;
+        case 3:
+            display_list(list);
+            break;
+        case 4:
+            edit_list(list, history, search_index, autosave);
+            break;
+        case 5:
+            search_list(list, search_index);
+            break;
+        case 6:
+            undo_edit(list, history, search_index, autosave);
+            break;
+        case 7:
+            redo_edit(list, history, search_index, autosave);
+            break;
+        case 8:
+            partitioned_catalog_menu(list, catalog);
+            break;
+        case 9:
+            exchange_menu(list, history, search_index, autosave);
+            break;
+        case 10:
+            merge_menu(list, history, search_index, autosave);
+            break;
+        case 11:
+            delta_menu(list, history, search_index, autosave);
+            break;
+        case 12:
+            view_menu(save_filename, autosave);
+            break;
+        case 13:
+            report_menu(list);
+            break;
+        case 14:
+            paged_menu();
+            break;
+        case 15:
+            workspace_menu(workspace);
+            break;
+        case 16:
+            autosave_menu(autosave);
+            break;
+        case 17:
+            display_info();
+            break;
+        case 18:
+            exit_session(list, save_filename, autosave);
             break;
         default:
             assert(false);
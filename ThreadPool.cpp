@@ -0,0 +1,207 @@
+#include "ThreadPool.hpp"
+#include <utility>
+#include <windows.h>
+
+namespace
+{
+    // The pool the current thread works for, if any, and its queue there.
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local std::size_t current_queue = 0;
+
+    std::size_t core_count()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+ThreadPool::ThreadPool(
+    std::size_t thread_count,
+    bool pin_threads
+) :
+    m_queues(),
+    m_workers(),
+    m_queued(0),
+    m_sleeping(0),
+    m_sleep_mutex(),
+    m_wake(),
+    m_is_stopping(false)
+{
+    thread_count = std::max<std::size_t>(thread_count, 1);
+    for (std::size_t i = 0; i < thread_count; i++)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 0; i + 1 < thread_count; i++)
+    {
+        m_workers.emplace_back(&ThreadPool::work, this, i, pin_threads);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_is_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+std::size_t ThreadPool::thread_count() const
+{
+    return m_queues.size();
+}
+
+std::size_t ThreadPool::thread_index() const
+{
+    return current_pool == this ? current_queue : m_queues.size() - 1;
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool(core_count(), false);
+    return pool;
+}
+
+ThreadPool::TaskGroup::TaskGroup(
+    ThreadPool& pool
+) :
+    m_pool(pool),
+    m_pending(0)
+{}
+
+ThreadPool::TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+void ThreadPool::TaskGroup::spawn(Task task)
+{
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    m_pool.push(
+        [this, &pool = m_pool, task = std::move(task)]()
+        {
+            task();
+            // Once the count is zero the group may be gone, so only the pool
+            // is touched past this point.
+            if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                std::lock_guard<std::mutex> lock(pool.m_sleep_mutex);
+                pool.m_wake.notify_all();
+            }
+        }
+    );
+}
+
+void ThreadPool::TaskGroup::wait()
+{
+    while (m_pending.load(std::memory_order_acquire) != 0)
+    {
+        if (m_pool.run_one())
+        {
+            continue;
+        }
+        // Nothing left to steal: the tasks of the group are running on other
+        // threads. Sleeps like an idle worker until one more task is queued
+        // or the last task of the group is done.
+        std::unique_lock<std::mutex> lock(m_pool.m_sleep_mutex);
+        m_pool.m_sleeping.fetch_add(1);
+        m_pool.m_wake.wait(
+            lock,
+            [this]() { return m_pending.load(std::memory_order_acquire) == 0 || m_pool.m_queued.load() != 0; }
+        );
+        m_pool.m_sleeping.fetch_sub(1);
+    }
+}
+
+void ThreadPool::push(Task task)
+{
+    auto& queue = *m_queues[thread_index()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    // A worker counts itself as sleeping before it checks m_queued for the
+    // last time, so either it sees this task or this sees it.
+    m_queued.fetch_add(1);
+    if (m_sleeping.load() != 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_wake.notify_one();
+    }
+}
+
+bool ThreadPool::run_one()
+{
+    Task task;
+    if (!pop(task))
+    {
+        return false;
+    }
+    task();
+    return true;
+}
+
+bool ThreadPool::pop(Task& task)
+{
+    if (m_queued.load(std::memory_order_relaxed) == 0)
+    {
+        return false;
+    }
+
+    std::size_t own = thread_index();
+    {
+        auto& queue = *m_queues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < m_queues.size(); i++)
+    {
+        auto& queue = *m_queues[(own + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(std::size_t index, bool pin_thread)
+{
+    current_pool = this;
+    current_queue = index;
+    if (pin_thread)
+    {
+        std::size_t core = (index + 1) % std::min<std::size_t>(core_count(), sizeof(DWORD_PTR) * 8);
+        SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core);
+    }
+
+    while (true)
+    {
+        if (run_one())
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_sleeping.fetch_add(1);
+        m_wake.wait(lock, [this]() { return m_is_stopping || m_queued.load() != 0; });
+        m_sleeping.fetch_sub(1);
+        if (m_is_stopping && m_queued.load() == 0)
+        {
+            return;
+        }
+    }
+}
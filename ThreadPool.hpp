@@ -0,0 +1,116 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work-stealing pool shared by everything that wants more than one core.
+// Every worker has a deque of its own: it pushes and pops tasks at the back,
+// while idle workers steal from the front, where the oldest and usually the
+// largest pieces of work are. Threads outside the pool hand their tasks in
+// through one more deque.
+//
+// A thread that waits for tasks runs queued tasks in the meantime, and sleeps
+// once there are none to take, so tasks may spawn and wait for tasks of their
+// own, and a pool of one thread, which starts no workers at all, runs
+// everything on the waiting thread. Tasks must not throw.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // thread_count counts the threads that run tasks, the waiting thread
+    // included, so the pool starts thread_count - 1 workers. With pin_threads
+    // worker i is kept on core i + 1, leaving core 0 to the waiting thread.
+    ThreadPool(std::size_t thread_count, bool pin_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t thread_count() const;
+    // Which of the thread_count threads the caller is: workers are numbered
+    // from 0, and any thread outside the pool is thread_count - 1.
+    std::size_t thread_index() const;
+
+    // The pool used by the loaders, the serializer, sorting, search and
+    // aggregation, with one unpinned thread per core.
+    static ThreadPool& shared();
+
+    // Tasks that are waited for together.
+    class TaskGroup {
+    public:
+        TaskGroup(ThreadPool& pool);
+        // Waits for the tasks that are still running.
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void spawn(Task task);
+        void wait();
+    private:
+        ThreadPool& m_pool;
+        std::atomic<std::size_t> m_pending;
+    };
+
+    // Calls body(first, last) on pieces of [begin, end) of at most grain
+    // indexes each and returns once all of them are done. The range is halved
+    // until the pieces are small enough, so that a thread that runs out of
+    // work steals half of what another one has left.
+    template <class Body>
+    void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, const Body& body)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        grain = std::max<std::size_t>(grain, 1);
+        if (end - begin <= grain)
+        {
+            body(begin, end);
+            return;
+        }
+        TaskGroup group(*this);
+        split(group, begin, end, grain, body);
+        group.wait();
+    }
+private:
+    class Queue {
+    public:
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // One queue per worker, then the queue of outside threads.
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<std::size_t> m_queued;
+    std::atomic<std::size_t> m_sleeping;
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    bool m_is_stopping;
+
+    void push(Task task);
+    // Runs one queued task, if there is any, and returns whether it did.
+    bool run_one();
+    bool pop(Task& task);
+    void work(std::size_t index, bool pin_thread);
+
+    template <class Body>
+    void split(TaskGroup& group, std::size_t begin, std::size_t end, std::size_t grain, const Body& body)
+    {
+        while (end - begin > grain)
+        {
+            std::size_t middle = begin + (end - begin) / 2;
+            group.spawn([this, &group, middle, end, grain, &body]() { split(group, middle, end, grain, body); });
+            end = middle;
+        }
+        body(begin, end);
+    }
+};
@@ -0,0 +1,156 @@
+#include "ThreadPoolBenchmark.hpp"
+#include "Stopwatch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Every 16th item, all of them in the first quarter, costs 64 times as
+    // much as the rest, so equal parts get very unequal work.
+    std::uint64_t item_cost(std::size_t item, std::size_t item_count)
+    {
+        const std::uint64_t light = 2000;
+        return item < item_count / 4 && item % 16 == 0 ? light * 64 : light;
+    }
+
+    std::uint64_t burn(std::uint64_t iterations, std::uint64_t seed)
+    {
+        for (std::uint64_t i = 0; i < iterations; i++)
+        {
+            seed ^= seed >> 33;
+            seed *= 0xFF51AFD7ED558CCDull;
+        }
+        return seed;
+    }
+
+    // The slowest thread against the average, 1 being a perfect split.
+    double imbalance(const std::vector<double>& busy_seconds)
+    {
+        double total = 0.0;
+        double longest = 0.0;
+        for (auto seconds : busy_seconds)
+        {
+            total += seconds;
+            longest = std::max(longest, seconds);
+        }
+        return total > 0.0 ? longest * busy_seconds.size() / total : 1.0;
+    }
+}
+
+ThreadPoolBenchmark::ThreadPoolBenchmark(
+    std::size_t thread_count,
+    bool pin_threads
+) :
+    m_pool(thread_count, pin_threads)
+{}
+
+void ThreadPoolBenchmark::run()
+{
+    std::cout << "Потоков в пуле: " << m_pool.thread_count() << "\n" << std::flush;
+    run_spawn(1000000);
+    run_parallel_for(1000000);
+    run_thread_start(1000);
+    run_skewed(4096);
+}
+
+void ThreadPoolBenchmark::run_spawn(std::size_t task_count)
+{
+    std::atomic<std::size_t> done(0);
+    auto start = Clock::now();
+    ThreadPool::TaskGroup group(m_pool);
+    for (std::size_t i = 0; i < task_count; i++)
+    {
+        group.spawn([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    group.wait();
+    double seconds = seconds_since(start);
+    std::cout
+        << "Пустых задач из одного потока: " << done.load()
+        << ", нс на задачу: " << (std::uint64_t)(seconds * 1e9 / task_count) << "\n"
+        << std::flush;
+}
+
+void ThreadPoolBenchmark::run_parallel_for(std::size_t index_count)
+{
+    std::atomic<std::size_t> done(0);
+    auto start = Clock::now();
+    m_pool.parallel_for(0, index_count, 1, [&done](std::size_t first, std::size_t last)
+    {
+        done.fetch_add(last - first, std::memory_order_relaxed);
+    });
+    double seconds = seconds_since(start);
+    std::cout
+        << "parallel_for по одному индексу: " << done.load()
+        << ", нс на индекс: " << (std::uint64_t)(seconds * 1e9 / index_count) << "\n"
+        << std::flush;
+}
+
+void ThreadPoolBenchmark::run_thread_start(std::size_t thread_count)
+{
+    std::atomic<std::size_t> done(0);
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < thread_count; i++)
+    {
+        std::thread thread([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+        thread.join();
+    }
+    double seconds = seconds_since(start);
+    std::cout
+        << "Для сравнения, отдельный поток на задачу: " << done.load()
+        << ", нс на задачу: " << (std::uint64_t)(seconds * 1e9 / thread_count) << "\n"
+        << std::flush;
+}
+
+void ThreadPoolBenchmark::run_skewed(std::size_t item_count)
+{
+    std::size_t thread_count = m_pool.thread_count();
+    std::atomic<std::uint64_t> sink(0);
+    auto run_items = [&](std::size_t first, std::size_t last, double& busy_seconds)
+    {
+        auto start = Clock::now();
+        std::uint64_t seed = first;
+        for (auto item = first; item < last; item++)
+        {
+            seed = burn(item_cost(item, item_count), seed + item);
+        }
+        sink.fetch_add(seed, std::memory_order_relaxed);
+        busy_seconds += seconds_since(start);
+    };
+
+    // Equal parts, a thread each, the way the program used to split work.
+    std::vector<double> static_busy(thread_count, 0.0);
+    auto static_start = Clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t part = 1; part < thread_count; part++)
+    {
+        threads.emplace_back([&, part]()
+        {
+            run_items(item_count * part / thread_count, item_count * (part + 1) / thread_count, static_busy[part]);
+        });
+    }
+    run_items(0, item_count / thread_count, static_busy[0]);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    double static_seconds = seconds_since(static_start);
+
+    std::vector<double> pool_busy(thread_count, 0.0);
+    auto pool_start = Clock::now();
+    m_pool.parallel_for(0, item_count, 1, [&](std::size_t first, std::size_t last)
+    {
+        run_items(first, last, pool_busy[m_pool.thread_index()]);
+    });
+    double pool_seconds = seconds_since(pool_start);
+
+    std::cout
+        << "Неравномерная нагрузка, " << item_count << " задач:\n"
+        << "  равные части: " << (std::uint64_t)(static_seconds * 1000) << " мс"
+        << ", перекос: " << imbalance(static_busy) << "\n"
+        << "  пул: " << (std::uint64_t)(pool_seconds * 1000) << " мс"
+        << ", перекос: " << imbalance(pool_busy) << "\n"
+        << std::flush;
+}
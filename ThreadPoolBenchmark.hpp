@@ -0,0 +1,21 @@
+#pragma once
+#include "ThreadPool.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Measures what a task costs on a ThreadPool, against starting a thread for
+// it, and how evenly the pool spreads work whose cost is skewed, against
+// splitting it among threads in equal parts up front.
+class ThreadPoolBenchmark {
+public:
+    ThreadPoolBenchmark(std::size_t thread_count, bool pin_threads);
+
+    void run();
+private:
+    ThreadPool m_pool;
+
+    void run_spawn(std::size_t task_count);
+    void run_parallel_for(std::size_t index_count);
+    void run_thread_start(std::size_t thread_count);
+    void run_skewed(std::size_t item_count);
+};
@@ -0,0 +1,79 @@
+#include "UndoHistory.hpp"
+#include <utility>
+
+UndoHistory::UndoHistory(
+    std::size_t max_steps
+) :
+    m_max_steps(max_steps),
+    m_current(),
+    m_undo(),
+    m_redo()
+{}
+
+void UndoHistory::reset(const HeadphonesList& list)
+{
+    m_current = PersistentList::from_list(list);
+    m_undo.clear();
+    m_redo.clear();
+}
+
+const PersistentList& UndoHistory::current() const
+{
+    return m_current;
+}
+
+void UndoHistory::commit(PersistentList version)
+{
+    m_undo.push_back(std::move(m_current));
+    if (m_undo.size() > m_max_steps)
+    {
+        m_undo.pop_front();
+    }
+    m_current = std::move(version);
+    m_redo.clear();
+}
+
+bool UndoHistory::can_undo() const
+{
+    return !m_undo.empty();
+}
+
+bool UndoHistory::can_redo() const
+{
+    return !m_redo.empty();
+}
+
+bool UndoHistory::undo(HeadphonesList& list)
+{
+    if (!can_undo())
+    {
+        return false;
+    }
+    m_redo.push_back(std::move(m_current));
+    m_current = std::move(m_undo.back());
+    m_undo.pop_back();
+    restore(list);
+    return true;
+}
+
+bool UndoHistory::redo(HeadphonesList& list)
+{
+    if (!can_redo())
+    {
+        return false;
+    }
+    m_undo.push_back(std::move(m_current));
+    m_current = std::move(m_redo.back());
+    m_redo.pop_back();
+    restore(list);
+    return true;
+}
+
+void UndoHistory::restore(HeadphonesList& list) const
+{
+    list.clear();
+    for (const auto& node : m_current.snapshot())
+    {
+        list.insert_after(list.tail(), std::const_pointer_cast<HeadphonesList::Node>(node));
+    }
+}
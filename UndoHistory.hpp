@@ -0,0 +1,27 @@
+#pragma once
+#include "HeadphonesList.hpp"
+#include "PersistentList.hpp"
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+class UndoHistory {
+public:
+    UndoHistory(std::size_t max_steps);
+
+    void reset(const HeadphonesList& list);
+    const PersistentList& current() const;
+    void commit(PersistentList version);
+
+    bool can_undo() const;
+    bool can_redo() const;
+    bool undo(HeadphonesList& list);
+    bool redo(HeadphonesList& list);
+private:
+    std::size_t m_max_steps;
+    PersistentList m_current;
+    std::deque<PersistentList> m_undo;
+    std::vector<PersistentList> m_redo;
+
+    void restore(HeadphonesList& list) const;
+};
@@ -0,0 +1,450 @@
+#include "UnrolledHeadphonesList.hpp"
+#include "HeadphonesSchema.hpp"
+#include <algorithm>
+
+UnrolledHeadphonesList::Iterator::Iterator(
+    std::nullptr_t
+) :
+    m_chunk(nullptr),
+    m_slot(0)
+{}
+UnrolledHeadphonesList::Iterator::Iterator(
+    Chunk* chunk,
+    std::size_t slot
+) :
+    m_chunk(chunk),
+    m_slot(slot)
+{}
+UnrolledHeadphonesList::Iterator::reference UnrolledHeadphonesList::Iterator::operator*() const
+{
+    return m_chunk->records[m_slot];
+}
+UnrolledHeadphonesList::Iterator::pointer UnrolledHeadphonesList::Iterator::operator->() const
+{
+    return &m_chunk->records[m_slot];
+}
+UnrolledHeadphonesList::Iterator::operator bool() const
+{
+    return m_chunk != nullptr;
+}
+UnrolledHeadphonesList::Iterator& UnrolledHeadphonesList::Iterator::operator++()
+{
+    if (++m_slot == m_chunk->size)
+    {
+        m_chunk = m_chunk->next.get();
+        m_slot = 0;
+    }
+    return *this;
+}
+UnrolledHeadphonesList::Iterator UnrolledHeadphonesList::Iterator::operator++(int)
+{
+    UnrolledHeadphonesList::Iterator result = *this;
+    ++(*this);
+    return result;
+}
+UnrolledHeadphonesList::Iterator& UnrolledHeadphonesList::Iterator::operator--()
+{
+    if (m_slot == 0)
+    {
+        m_chunk = m_chunk->prev;
+        m_slot = m_chunk ? m_chunk->size - 1 : 0;
+    }
+    else
+    {
+        m_slot--;
+    }
+    return *this;
+}
+UnrolledHeadphonesList::Iterator UnrolledHeadphonesList::Iterator::operator--(int)
+{
+    UnrolledHeadphonesList::Iterator result = *this;
+    --(*this);
+    return result;
+}
+bool operator== (const UnrolledHeadphonesList::Iterator& a, const UnrolledHeadphonesList::Iterator& b)
+{
+    return a.m_chunk == b.m_chunk && a.m_slot == b.m_slot;
+}
+bool operator!= (const UnrolledHeadphonesList::Iterator& a, const UnrolledHeadphonesList::Iterator& b)
+{
+    return !(a == b);
+}
+void swap(UnrolledHeadphonesList::Iterator& a, UnrolledHeadphonesList::Iterator& b)
+{
+    std::swap(a.m_chunk, b.m_chunk);
+    std::swap(a.m_slot, b.m_slot);
+}
+
+UnrolledHeadphonesList::ConstIterator::ConstIterator(
+    std::nullptr_t
+) :
+    m_chunk(nullptr),
+    m_slot(0)
+{}
+UnrolledHeadphonesList::ConstIterator::ConstIterator(
+    const Chunk* chunk,
+    std::size_t slot
+) :
+    m_chunk(chunk),
+    m_slot(slot)
+{}
+UnrolledHeadphonesList::ConstIterator::ConstIterator(
+    UnrolledHeadphonesList::Iterator iter
+) :
+    m_chunk(iter.m_chunk),
+    m_slot(iter.m_slot)
+{}
+UnrolledHeadphonesList::ConstIterator::reference UnrolledHeadphonesList::ConstIterator::operator*() const
+{
+    return m_chunk->records[m_slot];
+}
+UnrolledHeadphonesList::ConstIterator::pointer UnrolledHeadphonesList::ConstIterator::operator->() const
+{
+    return &m_chunk->records[m_slot];
+}
+UnrolledHeadphonesList::ConstIterator::operator bool() const
+{
+    return m_chunk != nullptr;
+}
+UnrolledHeadphonesList::ConstIterator& UnrolledHeadphonesList::ConstIterator::operator++()
+{
+    if (++m_slot == m_chunk->size)
+    {
+        m_chunk = m_chunk->next.get();
+        m_slot = 0;
+    }
+    return *this;
+}
+UnrolledHeadphonesList::ConstIterator UnrolledHeadphonesList::ConstIterator::operator++(int)
+{
+    UnrolledHeadphonesList::ConstIterator result = *this;
+    ++(*this);
+    return result;
+}
+UnrolledHeadphonesList::ConstIterator& UnrolledHeadphonesList::ConstIterator::operator--()
+{
+    if (m_slot == 0)
+    {
+        m_chunk = m_chunk->prev;
+        m_slot = m_chunk ? m_chunk->size - 1 : 0;
+    }
+    else
+    {
+        m_slot--;
+    }
+    return *this;
+}
+UnrolledHeadphonesList::ConstIterator UnrolledHeadphonesList::ConstIterator::operator--(int)
+{
+    UnrolledHeadphonesList::ConstIterator result = *this;
+    --(*this);
+    return result;
+}
+bool operator== (const UnrolledHeadphonesList::ConstIterator& a, const UnrolledHeadphonesList::ConstIterator& b)
+{
+    return a.m_chunk == b.m_chunk && a.m_slot == b.m_slot;
+}
+bool operator!= (const UnrolledHeadphonesList::ConstIterator& a, const UnrolledHeadphonesList::ConstIterator& b)
+{
+    return !(a == b);
+}
+void swap(UnrolledHeadphonesList::ConstIterator& a, UnrolledHeadphonesList::ConstIterator& b)
+{
+    std::swap(a.m_chunk, b.m_chunk);
+    std::swap(a.m_slot, b.m_slot);
+}
+
+UnrolledHeadphonesList::Chunk::Chunk() :
+    records(),
+    size(0),
+    next(nullptr),
+    prev(nullptr)
+{}
+
+UnrolledHeadphonesList::UnrolledHeadphonesList() :
+    m_head(nullptr),
+    m_tail(nullptr),
+    m_count(0),
+    m_chunk_count(0)
+{}
+UnrolledHeadphonesList::~UnrolledHeadphonesList()
+{
+    clear();
+}
+UnrolledHeadphonesList::UnrolledHeadphonesList(
+    UnrolledHeadphonesList&& list
+) :
+    m_head(std::move(list.m_head)),
+    m_tail(list.m_tail),
+    m_count(list.m_count),
+    m_chunk_count(list.m_chunk_count)
+{
+    list.m_tail = nullptr;
+    list.m_count = 0;
+    list.m_chunk_count = 0;
+}
+UnrolledHeadphonesList& UnrolledHeadphonesList::operator=(UnrolledHeadphonesList&& list)
+{
+    if (&list != this)
+    {
+        clear();
+        m_head = std::move(list.m_head);
+        m_tail = list.m_tail;
+        m_count = list.m_count;
+        m_chunk_count = list.m_chunk_count;
+        list.m_tail = nullptr;
+        list.m_count = 0;
+        list.m_chunk_count = 0;
+    }
+    return *this;
+}
+
+UnrolledHeadphonesList UnrolledHeadphonesList::from_list(const HeadphonesList& list)
+{
+    UnrolledHeadphonesList unrolled;
+    for (auto it = list.chead(); *it; it++)
+    {
+        HeadphonesSchema::assign(*unrolled.make_room(Iterator(nullptr)), (*it)->cvalue());
+    }
+    return unrolled;
+}
+HeadphonesList UnrolledHeadphonesList::to_list() const
+{
+    HeadphonesList list {};
+    list.insert_range(HeadphonesList::Iterator(nullptr), chead(), ConstIterator(nullptr));
+    return list;
+}
+
+UnrolledHeadphonesList::Iterator UnrolledHeadphonesList::head()
+{
+    return Iterator(m_head.get(), 0);
+}
+UnrolledHeadphonesList::Iterator UnrolledHeadphonesList::tail()
+{
+    return m_tail ? Iterator(m_tail, m_tail->size - 1) : Iterator(nullptr);
+}
+UnrolledHeadphonesList::ConstIterator UnrolledHeadphonesList::chead() const
+{
+    return ConstIterator(m_head.get(), 0);
+}
+UnrolledHeadphonesList::ConstIterator UnrolledHeadphonesList::ctail() const
+{
+    return m_tail ? ConstIterator(m_tail, m_tail->size - 1) : ConstIterator(nullptr);
+}
+std::uintptr_t UnrolledHeadphonesList::count() const
+{
+    return m_count;
+}
+std::uintptr_t UnrolledHeadphonesList::chunk_count() const
+{
+    return m_chunk_count;
+}
+std::size_t UnrolledHeadphonesList::memory_usage() const
+{
+    return (std::size_t)m_chunk_count * sizeof(Chunk);
+}
+bool UnrolledHeadphonesList::is_empty() const
+{
+    return count() == 0;
+}
+bool UnrolledHeadphonesList::is_not_empty() const
+{
+    return !is_empty();
+}
+
+UnrolledHeadphonesList::Iterator UnrolledHeadphonesList::index(std::uintptr_t index)
+{
+    if (index >= count())
+    {
+        return Iterator(nullptr);
+    }
+
+    Chunk* chunk = m_head.get();
+    while (index >= chunk->size)
+    {
+        index -= chunk->size;
+        chunk = chunk->next.get();
+    }
+    return Iterator(chunk, (std::size_t)index);
+}
+
+UnrolledHeadphonesList::Iterator UnrolledHeadphonesList::remove(Iterator it)
+{
+    Chunk* chunk = it.m_chunk;
+    std::size_t slot = it.m_slot;
+    if (!chunk)
+    {
+        return it;
+    }
+
+    std::move(chunk->records + slot + 1, chunk->records + chunk->size, chunk->records + slot);
+    chunk->size--;
+    // Let go of the strings of the record that was shifted out.
+    chunk->records[chunk->size] = Headphones();
+    m_count--;
+
+    if (chunk->size == 0)
+    {
+        Chunk* next = chunk->next.get();
+        remove_chunk(chunk);
+        return Iterator(next, 0);
+    }
+
+    Chunk* next = chunk->next.get();
+    if (chunk->size < chunk_capacity / 4 && next && chunk->size + next->size <= chunk_capacity)
+    {
+        std::move(next->records, next->records + next->size, chunk->records + chunk->size);
+        chunk->size += next->size;
+        remove_chunk(next);
+    }
+    else if (slot == chunk->size)
+    {
+        return Iterator(chunk->next.get(), 0);
+    }
+    return Iterator(chunk, slot);
+}
+
+void UnrolledHeadphonesList::clear()
+{
+    // Chunk by chunk, so a long list is not torn down recursively.
+    while (m_head)
+    {
+        m_head = std::move(m_head->next);
+    }
+
+    m_tail = nullptr;
+    m_count = 0;
+    m_chunk_count = 0;
+}
+
+HeadphonesList::SerializeResult UnrolledHeadphonesList::serialize(std::ostream& os) const
+{
+    const std::size_t block_size = 1 << 20;
+    auto io_err = "Ошибка ввода-вывода при записи файла";
+
+    std::string block;
+    block.reserve(block_size + 4096);
+    try
+    {
+        for (const Chunk* chunk = m_head.get(); chunk; chunk = chunk->next.get())
+        {
+            for (std::size_t i = 0; i < chunk->size; i++)
+            {
+                HeadphonesList::serialize_record(block, chunk->records[i]);
+            }
+            if (block.size() >= block_size)
+            {
+                if (!os.write(block.data(), block.size()))
+                {
+                    return HeadphonesList::SerializeError(io_err);
+                }
+                block.clear();
+            }
+        }
+        block += HeadphonesList::end_symbol;
+        if (!os.write(block.data(), block.size()))
+        {
+            return HeadphonesList::SerializeError(io_err);
+        }
+        return std::monostate();
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        return HeadphonesList::SerializeError(io_err);
+    }
+}
+
+UnrolledHeadphonesList::DeserializeResult UnrolledHeadphonesList::deserialize(std::istream& is)
+{
+    UnrolledHeadphonesList list;
+    while (true)
+    {
+        auto result = HeadphonesList::deserialize_record(is);
+        if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+        {
+            return std::get<HeadphonesList::DeserializeError>(result);
+        }
+        auto& node = std::get<HeadphonesList::Node::node_ptr>(result);
+        if (!node)
+        {
+            return DeserializeResult(std::move(list));
+        }
+        *list.make_room(Iterator(nullptr)) = std::move(node->value());
+    }
+}
+
+UnrolledHeadphonesList::Iterator UnrolledHeadphonesList::make_room(Iterator it)
+{
+    Chunk* chunk = it.m_chunk;
+    std::size_t slot = it.m_slot;
+    if (!chunk)
+    {
+        // Appending fills chunks to the brim instead of splitting them, so a
+        // list built front to back is as dense as it gets.
+        chunk = m_tail;
+        if (!chunk || chunk->size == chunk_capacity)
+        {
+            chunk = insert_chunk_after(m_tail);
+        }
+        slot = chunk->size;
+    }
+    else if (chunk->size == chunk_capacity)
+    {
+        split(chunk);
+        if (slot > chunk->size)
+        {
+            slot -= chunk->size;
+            chunk = chunk->next.get();
+        }
+    }
+
+    std::move_backward(chunk->records + slot, chunk->records + chunk->size, chunk->records + chunk->size + 1);
+    chunk->size++;
+    m_count++;
+    return Iterator(chunk, slot);
+}
+
+UnrolledHeadphonesList::Chunk* UnrolledHeadphonesList::insert_chunk_after(Chunk* chunk)
+{
+    std::unique_ptr<Chunk>& owner = chunk ? chunk->next : m_head;
+    auto inserted = std::make_unique<Chunk>();
+    inserted->prev = chunk;
+    inserted->next = std::move(owner);
+    if (inserted->next)
+    {
+        inserted->next->prev = inserted.get();
+    }
+    else
+    {
+        m_tail = inserted.get();
+    }
+    owner = std::move(inserted);
+    m_chunk_count++;
+    return owner.get();
+}
+
+void UnrolledHeadphonesList::remove_chunk(Chunk* chunk)
+{
+    Chunk* prev = chunk->prev;
+    std::unique_ptr<Chunk>& owner = prev ? prev->next : m_head;
+    std::unique_ptr<Chunk> removed = std::move(owner);
+    owner = std::move(removed->next);
+    if (owner)
+    {
+        owner->prev = prev;
+    }
+    else
+    {
+        m_tail = prev;
+    }
+    m_chunk_count--;
+}
+
+void UnrolledHeadphonesList::split(Chunk* chunk)
+{
+    Chunk* upper = insert_chunk_after(chunk);
+    std::size_t half = chunk->size / 2;
+    std::move(chunk->records + half, chunk->records + chunk->size, upper->records);
+    upper->size = chunk->size - half;
+    chunk->size = half;
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include "Headphones.hpp"
+#include "HeadphonesList.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <variant>
+
+// The records of a HeadphonesList stored as an unrolled list: each chunk holds
+// up to chunk_capacity records side by side, so a full scan takes one cache
+// miss per chunk rather than one per record, and the list pointers are paid
+// for once per chunk. A full chunk is split in half to make room; a chunk that
+// falls under a quarter full takes in its successor when both fit in one.
+//
+// Records live inside the chunks and move when their neighbours do, so an
+// iterator is a (chunk, slot) pair: inserting or removing invalidates the
+// iterators into the chunks involved. A null iterator marks the end, as in
+// HeadphonesList, and converts to false.
+class UnrolledHeadphonesList {
+    class Chunk;
+public:
+    static constexpr std::size_t chunk_capacity = 16;
+
+    class Iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = Headphones;
+        using pointer           = value_type*;
+        using reference         = value_type&;
+
+        Iterator(std::nullptr_t);
+
+        reference operator*() const;
+        pointer operator->() const;
+        explicit operator bool() const;
+        Iterator& operator++();
+        Iterator operator++(int);
+        Iterator& operator--();
+        Iterator operator--(int);
+        friend bool operator== (const Iterator& a, const Iterator& b);
+        friend bool operator!= (const Iterator& a, const Iterator& b);
+
+        friend void swap(Iterator& a, Iterator& b);
+    private:
+        friend class UnrolledHeadphonesList;
+
+        Chunk* m_chunk;
+        std::size_t m_slot;
+
+        Iterator(Chunk* chunk, std::size_t slot);
+    };
+
+    class ConstIterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = const Headphones;
+        using pointer           = value_type*;
+        using reference         = value_type&;
+
+        ConstIterator(std::nullptr_t);
+        ConstIterator(Iterator iter);
+
+        reference operator*() const;
+        pointer operator->() const;
+        explicit operator bool() const;
+        ConstIterator& operator++();
+        ConstIterator operator++(int);
+        ConstIterator& operator--();
+        ConstIterator operator--(int);
+        friend bool operator== (const ConstIterator& a, const ConstIterator& b);
+        friend bool operator!= (const ConstIterator& a, const ConstIterator& b);
+
+        friend void swap(ConstIterator& a, ConstIterator& b);
+    private:
+        friend class UnrolledHeadphonesList;
+
+        const Chunk* m_chunk;
+        std::size_t m_slot;
+
+        ConstIterator(const Chunk* chunk, std::size_t slot);
+    };
+
+    UnrolledHeadphonesList();
+    ~UnrolledHeadphonesList();
+
+    UnrolledHeadphonesList(const UnrolledHeadphonesList& list) = delete;
+    UnrolledHeadphonesList& operator=(const UnrolledHeadphonesList& list) = delete;
+    UnrolledHeadphonesList(UnrolledHeadphonesList&& list);
+    UnrolledHeadphonesList& operator=(UnrolledHeadphonesList&& list);
+
+    // Copies the records of list, filling every chunk.
+    static UnrolledHeadphonesList from_list(const HeadphonesList& list);
+    HeadphonesList to_list() const;
+
+    Iterator head();
+    Iterator tail();
+
+    ConstIterator chead() const;
+    ConstIterator ctail() const;
+    std::uintptr_t count() const;
+    std::uintptr_t chunk_count() const;
+    // Bytes held by the chunks, not counting what the strings allocate.
+    std::size_t memory_usage() const;
+    bool is_empty() const;
+    bool is_not_empty() const;
+
+    // Skips whole chunks, so this is O(count / chunk_capacity).
+    Iterator index(std::uintptr_t index);
+    template<class UnaryPredicate>
+    Iterator find_if(Iterator first_inclusive, Iterator last_inclusive, UnaryPredicate p)
+    {
+        for (Iterator it = first_inclusive; it; it++) {
+            if (p(&*it))
+            {
+                return it;
+            }
+            if (it == last_inclusive)
+            {
+                break;
+            }
+        }
+
+        return Iterator(nullptr);
+    }
+    // Both return an iterator to the new record.
+    template<typename... Args>
+    Iterator emplace_before(Iterator it, Args&&... args)
+    {
+        Iterator slot = make_room(it);
+        *slot = Headphones(std::forward<Args>(args)...);
+        return slot;
+    }
+    template<typename... Args>
+    Iterator emplace_after(Iterator it, Args&&... args)
+    {
+        return emplace_before(it ? std::next(it) : head(), std::forward<Args>(args)...);
+    }
+    template<typename... Args>
+    Iterator emplace_back(Args&&... args)
+    {
+        return emplace_before(Iterator(nullptr), std::forward<Args>(args)...);
+    }
+    // Returns an iterator to the record that followed the removed one.
+    Iterator remove(Iterator it);
+    void clear();
+
+    using DeserializeResult = std::variant<UnrolledHeadphonesList, HeadphonesList::DeserializeError>;
+
+    HeadphonesList::SerializeResult serialize(std::ostream& os) const;
+    static DeserializeResult deserialize(std::istream& is);
+private:
+    class Chunk {
+    public:
+        Headphones records[chunk_capacity];
+        std::size_t size;
+        std::unique_ptr<Chunk> next;
+        Chunk* prev;
+
+        Chunk();
+    };
+
+    std::unique_ptr<Chunk> m_head;
+    Chunk* m_tail;
+    std::uintptr_t m_count;
+    std::uintptr_t m_chunk_count;
+
+    // Opens a slot in front of it, splitting its chunk if full, and returns
+    // the slot. The record there is left moved-from for the caller to fill.
+    Iterator make_room(Iterator it);
+    // Links a new empty chunk after chunk, or at the front if chunk is null.
+    Chunk* insert_chunk_after(Chunk* chunk);
+    void remove_chunk(Chunk* chunk);
+    void split(Chunk* chunk);
+};
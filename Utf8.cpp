@@ -0,0 +1,274 @@
+#include "Utf8.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HEADPHONES_HAS_SSSE3_VALIDATOR 1
+#define HEADPHONES_SSSE3_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HEADPHONES_HAS_SSSE3_VALIDATOR 1
+#define HEADPHONES_SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+
+namespace
+{
+    std::optional<std::size_t> find_invalid_utf8_scalar(const unsigned char* data, std::size_t size)
+    {
+        std::size_t i = 0;
+        while (i < size)
+        {
+            unsigned char lead = data[i];
+            if (lead < 0x80)
+            {
+                i++;
+                continue;
+            }
+
+            std::size_t length;
+            std::uint32_t code_point;
+            std::uint32_t min_code_point;
+            if ((lead & 0xE0) == 0xC0)
+            {
+                length = 2;
+                code_point = lead & 0x1F;
+                min_code_point = 0x80;
+            }
+            else if ((lead & 0xF0) == 0xE0)
+            {
+                length = 3;
+                code_point = lead & 0x0F;
+                min_code_point = 0x800;
+            }
+            else if ((lead & 0xF8) == 0xF0)
+            {
+                length = 4;
+                code_point = lead & 0x07;
+                min_code_point = 0x10000;
+            }
+            else
+            {
+                return i;
+            }
+
+            if (size - i < length)
+            {
+                return i;
+            }
+            for (std::size_t k = 1; k < length; k++)
+            {
+                if ((data[i + k] & 0xC0) != 0x80)
+                {
+                    return i;
+                }
+                code_point = (code_point << 6) | (data[i + k] & 0x3F);
+            }
+            if (code_point < min_code_point
+                || code_point > 0x10FFFF
+                || (code_point >= 0xD800 && code_point <= 0xDFFF))
+            {
+                return i;
+            }
+            i += length;
+        }
+        return std::nullopt;
+    }
+
+#ifdef HEADPHONES_HAS_SSSE3_VALIDATOR
+    class Ssse3ValidatorState {
+    public:
+        __m128i error;
+        __m128i prev_input;
+        __m128i prev_incomplete;
+    };
+
+    // The lookup-table validator of Keiser and Lemire, "Validating UTF-8 In
+    // Less Than One Instruction Per Byte" (2021). Three nibble lookups over each
+    // byte and its predecessor flag every two-byte error pattern; the remaining
+    // checks make sure continuation bytes appear exactly where a 3- or 4-byte
+    // lead demands them.
+    HEADPHONES_SSSE3_TARGET
+    inline void check_block_ssse3(Ssse3ValidatorState& state, __m128i input)
+    {
+        const std::uint8_t too_short = 1 << 0;
+        const std::uint8_t too_long = 1 << 1;
+        const std::uint8_t overlong_3 = 1 << 2;
+        const std::uint8_t too_large = 1 << 3;
+        const std::uint8_t surrogate = 1 << 4;
+        const std::uint8_t overlong_2 = 1 << 5;
+        const std::uint8_t too_large_1000 = 1 << 6;
+        const std::uint8_t overlong_4 = 1 << 6;
+        const std::uint8_t two_conts = 1 << 7;
+        const std::uint8_t carry = too_short | too_long | two_conts;
+
+        if (_mm_movemask_epi8(input) == 0)
+        {
+            state.error = _mm_or_si128(state.error, state.prev_incomplete);
+            state.prev_input = input;
+            state.prev_incomplete = _mm_setzero_si128();
+            return;
+        }
+
+        const __m128i byte_1_high_table = _mm_setr_epi8(
+            too_long, too_long, too_long, too_long,
+            too_long, too_long, too_long, too_long,
+            (char)two_conts, (char)two_conts, (char)two_conts, (char)two_conts,
+            too_short | overlong_2,
+            too_short,
+            too_short | overlong_3 | surrogate,
+            too_short | too_large | too_large_1000 | overlong_4
+        );
+        const __m128i byte_1_low_table = _mm_setr_epi8(
+            (char)(carry | overlong_3 | overlong_2 | overlong_4),
+            (char)(carry | overlong_2),
+            (char)carry,
+            (char)carry,
+            (char)(carry | too_large),
+            (char)(carry | too_large | too_large_1000),
+            (char)(carry | too_large | too_large_1000),
+            (char)(carry | too_large | too_large_1000),
+            (char)(carry | too_large | too_large_1000),
+            (char)(carry | too_large | too_large_1000),
+            (char)(carry | too_large | too_large_1000),
+            (char)(carry | too_large | too_large_1000),
+            (char)(carry | too_large | too_large_1000),
+            (char)(carry | too_large | too_large_1000 | surrogate),
+            (char)(carry | too_large | too_large_1000),
+            (char)(carry | too_large | too_large_1000)
+        );
+        const __m128i byte_2_high_table = _mm_setr_epi8(
+            too_short, too_short, too_short, too_short,
+            too_short, too_short, too_short, too_short,
+            (char)(too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4),
+            (char)(too_long | overlong_2 | two_conts | overlong_3 | too_large),
+            (char)(too_long | overlong_2 | two_conts | surrogate | too_large),
+            (char)(too_long | overlong_2 | two_conts | surrogate | too_large),
+            too_short, too_short, too_short, too_short
+        );
+        // A lead byte in one of the last three positions needs more bytes than
+        // the block has left.
+        const __m128i incomplete_max = _mm_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1)
+        );
+        const __m128i low_nibble_mask = _mm_set1_epi8(0x0F);
+
+        __m128i prev1 = _mm_alignr_epi8(input, state.prev_input, 15);
+        __m128i byte_1_high = _mm_shuffle_epi8(
+            byte_1_high_table,
+            _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble_mask)
+        );
+        __m128i byte_1_low = _mm_shuffle_epi8(
+            byte_1_low_table,
+            _mm_and_si128(prev1, low_nibble_mask)
+        );
+        __m128i byte_2_high = _mm_shuffle_epi8(
+            byte_2_high_table,
+            _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble_mask)
+        );
+        __m128i special_cases = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+        __m128i prev2 = _mm_alignr_epi8(input, state.prev_input, 14);
+        __m128i prev3 = _mm_alignr_epi8(input, state.prev_input, 13);
+        __m128i is_third_byte = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80)));
+        __m128i is_fourth_byte = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)));
+        __m128i must_be_continuation = _mm_and_si128(
+            _mm_or_si128(is_third_byte, is_fourth_byte),
+            _mm_set1_epi8((char)0x80)
+        );
+
+        state.error = _mm_or_si128(state.error, _mm_xor_si128(must_be_continuation, special_cases));
+        state.prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+        state.prev_input = input;
+    }
+
+    HEADPHONES_SSSE3_TARGET
+    bool is_valid_utf8_ssse3(const char* data, std::size_t size)
+    {
+        Ssse3ValidatorState state {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+
+        std::size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            check_block_ssse3(state, _mm_loadu_si128((const __m128i*)(data + i)));
+        }
+        if (i < size)
+        {
+            // Zero padding is ASCII, so a truncated sequence at the very end
+            // is reported as too short.
+            char tail[16] = {};
+            std::memcpy(tail, data + i, size - i);
+            check_block_ssse3(state, _mm_loadu_si128((const __m128i*)tail));
+        }
+        __m128i error = _mm_or_si128(state.error, state.prev_incomplete);
+
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+    }
+
+    bool cpu_has_ssse3()
+    {
+#if defined(_MSC_VER)
+        int registers[4];
+        __cpuid(registers, 1);
+        return (registers[2] & (1 << 9)) != 0;
+#else
+        return __builtin_cpu_supports("ssse3");
+#endif
+    }
+#endif
+}
+
+bool is_valid_utf8(const char* data, std::size_t size)
+{
+#ifdef HEADPHONES_HAS_SSSE3_VALIDATOR
+    static const bool has_ssse3 = cpu_has_ssse3();
+    if (has_ssse3)
+    {
+        return is_valid_utf8_ssse3(data, size);
+    }
+#endif
+    return !find_invalid_utf8_scalar((const unsigned char*)data, size);
+}
+
+std::optional<std::size_t> find_invalid_utf8(const std::string& string)
+{
+    // Well-formed input is the common case; only locate the error once the
+    // fast check has found that there is one.
+    if (is_valid_utf8(string.data(), string.size()))
+    {
+        return std::nullopt;
+    }
+    return find_invalid_utf8_scalar((const unsigned char*)string.data(), string.size());
+}
+
+void append_utf8(char32_t code_point, std::string& out)
+{
+    if (code_point < 0x80)
+    {
+        out += (char)code_point;
+    }
+    else if (code_point < 0x800)
+    {
+        out += (char)(0xC0 | (code_point >> 6));
+        out += (char)(0x80 | (code_point & 0x3F));
+    }
+    else if (code_point < 0x10000)
+    {
+        out += (char)(0xE0 | (code_point >> 12));
+        out += (char)(0x80 | ((code_point >> 6) & 0x3F));
+        out += (char)(0x80 | (code_point & 0x3F));
+    }
+    else
+    {
+        out += (char)(0xF0 | (code_point >> 18));
+        out += (char)(0x80 | ((code_point >> 12) & 0x3F));
+        out += (char)(0x80 | ((code_point >> 6) & 0x3F));
+        out += (char)(0x80 | (code_point & 0x3F));
+    }
+}
+
+std::filesystem::path utf8_path(const std::string& filename)
+{
+    return std::filesystem::u8path(filename);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+// Checks well-formedness as defined by RFC 3629: no overlong forms, no
+// surrogates, nothing above U+10FFFF and no truncated sequences. Uses a
+// 16-bytes-at-a-time SSSE3 validator when the CPU has it.
+bool is_valid_utf8(const char* data, std::size_t size);
+
+// Byte offset of the first ill-formed sequence, or nullopt if there is none.
+std::optional<std::size_t> find_invalid_utf8(const std::string& string);
+
+// Appends the UTF-8 form of a code point. Surrogates are encoded like any other
+// value, which leaves them for the validator to reject.
+void append_utf8(char32_t code_point, std::string& out);
+
+// The path named by a UTF-8 filename. Filenames are UTF-8 throughout the
+// program, while Windows reads a narrow path in the ANSI code page, so every
+// file is opened, measured and removed through this.
+std::filesystem::path utf8_path(const std::string& filename);
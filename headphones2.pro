@@ -3,13 +3,71 @@ CONFIG += console c++17
 CONFIG -= app_bundle
 CONFIG -= qt
 
+LIBS += -lws2_32
+
 SOURCES += \
+        Autosave.cpp \
+        CatalogAggregate.cpp \
+        CatalogDelta.cpp \
+        CatalogExchange.cpp \
+        CatalogIndex.cpp \
+        CatalogMerge.cpp \
+        CatalogWorkspace.cpp \
+        CatalogProtocol.cpp \
+        CatalogServer.cpp \
+        CatalogUpsert.cpp \
+        ConcurrentHeadphonesList.cpp \
+        ConcurrentListBenchmark.cpp \
         HeadphoneList.cpp \
         Headphones.cpp \
+        KeyFilter.cpp \
+        LoadGenerator.cpp \
         Main.cpp \
-        TextMenu.cpp
+        PagedCatalog.cpp \
+        PartitionedCatalog.cpp \
+        PersistentList.cpp \
+        PositionIndex.cpp \
+        PipelinedLoader.cpp \
+        SearchIndex.cpp \
+        StorageBenchmark.cpp \
+        TextMenu.cpp \
+        ThreadPool.cpp \
+        ThreadPoolBenchmark.cpp \
+        UnrolledHeadphonesList.cpp \
+        UndoHistory.cpp \
+        Utf8.cpp
 
 HEADERS += \
+    Autosave.hpp \
+    CatalogAggregate.hpp \
+    CatalogDelta.hpp \
+    CatalogExchange.hpp \
+    CatalogIndex.hpp \
+    CatalogMerge.hpp \
+    CatalogWorkspace.hpp \
+    CatalogProtocol.hpp \
+    CatalogServer.hpp \
+    CatalogUpsert.hpp \
+    ConcurrentHeadphonesList.hpp \
+    ConcurrentListBenchmark.hpp \
     Headphones.hpp \
     HeadphonesList.hpp \
-    TextMenu.hpp
+    HeadphonesSchema.hpp \
+    IntrusiveList.hpp \
+    KeyFilter.hpp \
+    KeyTable.hpp \
+    LoadGenerator.hpp \
+    PagedCatalog.hpp \
+    PartitionedCatalog.hpp \
+    PersistentList.hpp \
+    PositionIndex.hpp \
+    PipelinedLoader.hpp \
+    SearchIndex.hpp \
+    Stopwatch.hpp \
+    StorageBenchmark.hpp \
+    TextMenu.hpp \
+    ThreadPool.hpp \
+    ThreadPoolBenchmark.hpp \
+    UnrolledHeadphonesList.hpp \
+    UndoHistory.hpp \
+    Utf8.hpp
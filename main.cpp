@@ -1,5 +1,15 @@
 #include "TextMenu.hpp"
+#include "CatalogProtocol.hpp"
+#include "CatalogServer.hpp"
+#include "LoadGenerator.hpp"
+#include "StorageBenchmark.hpp"
+#include "ConcurrentListBenchmark.hpp"
+#include "ThreadPoolBenchmark.hpp"
+#include <algorithm>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
 #include <windows.h>
 #include <locale>
 #include <clocale>
@@ -51,10 +61,196 @@ void try_set_locale() {
     std::cerr << "Warning: Could not set UTF-8 locale, utf-8 may not work correctly.\n";
 }
 
-int main()
+std::uint16_t parse_port(const std::string& string)
+{
+    try
+    {
+        int port = std::stoi(string);
+        return port > 0 && port <= 65535 ? (std::uint16_t)port : 0;
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+int run_server(std::uint16_t tcp_port)
+{
+    if (!startup_sockets())
+    {
+        std::cerr << "Error: failed to initialize Winsock." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    CatalogServer server("headphones.bin");
+    auto result = server.load();
+    if (std::holds_alternative<HeadphonesList::DeserializeError>(result))
+    {
+        std::cout
+            << "Предупреждение: \"" << std::get<HeadphonesList::DeserializeError>(result).message << "\".\n"
+            << "Сервер запущен с пустым списком.\n"
+            << std::flush;
+    }
+    if (!server.listen_unix(catalog_socket_path))
+    {
+        std::cerr << "Error: failed to listen on " << catalog_socket_path << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (tcp_port != 0 && !server.listen_tcp(tcp_port))
+    {
+        std::cerr << "Error: failed to listen on 127.0.0.1:" << tcp_port << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Сервер каталога слушает " << catalog_socket_path;
+    if (tcp_port != 0)
+    {
+        std::cout << " и 127.0.0.1:" << tcp_port;
+    }
+    std::cout << ".\n" << std::flush;
+    if (!server.run())
+    {
+        std::cerr << "Error: polling sockets failed with code " << WSAGetLastError() << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int run_load_test(std::uint16_t tcp_port)
+{
+    if (!startup_sockets())
+    {
+        std::cerr << "Error: failed to initialize Winsock." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    LoadGenerator generator(catalog_socket_path, tcp_port);
+    generator.run({1, 10, 100, 1000}, std::chrono::seconds(3));
+    return EXIT_SUCCESS;
+}
+
+int run_pool_benchmark(const std::vector<std::string>& args)
+{
+    std::size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    if (args.size() > 1)
+    {
+        try
+        {
+            thread_count = std::max(1, std::stoi(args[1]));
+        }
+        catch (...)
+        {
+            std::cerr << "Error: bad thread count." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    bool pin_threads = args.size() > 2 && args[2] == "pin";
+
+    ThreadPoolBenchmark benchmark(thread_count, pin_threads);
+    benchmark.run();
+    return EXIT_SUCCESS;
+}
+
+int run_list_benchmark(const std::vector<std::string>& args)
+{
+    std::size_t record_count = 10000;
+    if (args.size() > 1)
+    {
+        try
+        {
+            record_count = std::max(1, std::stoi(args[1]));
+        }
+        catch (...)
+        {
+            std::cerr << "Error: bad record count." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    ConcurrentListBenchmark benchmark(record_count, std::chrono::milliseconds(500));
+    if (!benchmark.run())
+    {
+        std::cerr << "Error: the concurrent list lost consistency." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int run_storage_benchmark(const std::vector<std::string>& args)
+{
+    std::size_t record_count = 1000000;
+    if (args.size() > 1)
+    {
+        try
+        {
+            record_count = std::max(1, std::stoi(args[1]));
+        }
+        catch (...)
+        {
+            std::cerr << "Error: bad record count." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    StorageBenchmark benchmark(record_count);
+    if (!benchmark.run())
+    {
+        std::cerr << "Error: the storage benchmark failed to write or load its catalog file." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int run_storage_check()
+{
+    StorageBenchmark benchmark(1000);
+    if (!benchmark.check())
+    {
+        std::cerr << "Error: a list ownership check failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
 {
     try_set_locale();
 
+    // headphones2 --serve [tcp-port]      serve headphones.bin to other processes
+    // headphones2 --load-test [tcp-port]  benchmark a running server
+    // headphones2 --pool-bench [threads] [pin]
+    //                                     benchmark the thread pool
+    // headphones2 --list-bench [records]  stress and benchmark the concurrent list
+    // headphones2 --storage-bench [records]
+    //                                     compare the in-memory list layouts
+    // headphones2 --storage-check         check that lists own their nodes
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::uint16_t tcp_port = args.size() > 1 ? parse_port(args[1]) : 0;
+    if (!args.empty() && args[0] == "--serve")
+    {
+        return run_server(tcp_port);
+    }
+    if (!args.empty() && args[0] == "--load-test")
+    {
+        return run_load_test(tcp_port);
+    }
+    if (!args.empty() && args[0] == "--pool-bench")
+    {
+        return run_pool_benchmark(args);
+    }
+    if (!args.empty() && args[0] == "--list-bench")
+    {
+        return run_list_benchmark(args);
+    }
+    if (!args.empty() && args[0] == "--storage-bench")
+    {
+        return run_storage_benchmark(args);
+    }
+    if (!args.empty() && args[0] == "--storage-check")
+    {
+        return run_storage_check();
+    }
+
     TextMenu::session();
     return 0;
 }